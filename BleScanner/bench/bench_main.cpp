@@ -0,0 +1,1310 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+// Headless benchmark: runs the scan → connect → request → notify → decrypt pipeline
+// of BleManager against the simulated STM32 peripheral and prints throughput/latency.
+
+#include "advert_ingest.h"
+#include "aes_gcm_simd.h"
+#include "alloc_counter.h"
+#include "ble_manager.h"
+#include "chacha20_simd.h"
+#include "chachapoly_fused.h"
+#include "ciphertext_log.h"
+#include "crc32c.h"
+#include "constants.h"
+#include "cpu_features.h"
+#include "crypto.h"
+#include "poly1305_simd.h"
+#include "sim_transport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mbedtls/ccm.h>
+#include <mbedtls/chachapoly.h>
+#include <mbedtls/poly1305.h>
+
+#if BLE_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace {
+
+struct BenchOptions {
+    std::vector<uint8_t> requests;
+    uint32_t  bytes     = 20000;
+    uint32_t  wordSize  = 244;
+    double    delayMs   = 0.0;
+    uint32_t  window    = 4;
+    double    timeoutS  = 30.0;
+    bool      verbose   = false;
+    bool      adaptive  = false;
+    bool      sequenceIds = false;
+    std::string timeline;           ///< CSV prefix for the per-request timeline, empty = none
+    std::string latencyCsv;         ///< CSV prefix for the per-request latency breakdown, empty = none
+    std::string trajectory;         ///< CSV prefix for the pacing trajectory, empty = none
+    std::string spacing;            ///< CSV prefix for the send spacing histogram, empty = none
+    uint32_t  devices   = 0;        ///< > 0: drive that many simulated boards at once
+    uint32_t  slow      = 0;        ///< of those, how many are slow
+    double    slowRate  = 4000.0;   ///< service rate of a slow board, B/s
+    uint32_t  connects  = 4;        ///< parallel connection setups
+    uint64_t  advertFlood = 0;      ///< > 0: only run the advert ingestion flood with that many adverts
+    uint32_t  floodDevices = 5000;  ///< distinct bystander addresses in the flood
+    bool      cryptoBench = false;  ///< only run the host decrypt micro-benchmark
+    bool      chachaBench = false;  ///< only run the ChaCha20 kernel self-test and benchmark
+    bool      polyBench = false;    ///< only run the Poly1305 kernel self-test and benchmark
+    bool      aeadBench = false;    ///< only run the fused ChaCha20-Poly1305 self-test and benchmark
+    bool      gcmBench = false;     ///< only run the AES-GCM kernel self-test and benchmark
+    bool      mbBench = false;      ///< only run the multi-buffer ChaCha20 / AES-GCM benchmark
+    bool      crcBench = false;     ///< only run the CRC32C kernel self-test and benchmark
+    bool      batchDecrypt = false; ///< sessions decrypt on their decrypt thread in batches
+    bool      keystreamCache = false; ///< sessions decrypt from a precomputed keystream
+    DecryptMode decryptMode = DecryptMode::Full;    ///< single-device runs: what onData does per packet
+    uint32_t  workers   = 0;        ///< > 0: shared decrypt pool with that many workers
+    uint64_t  replay    = 0;        ///< > 0: only run the decrypt pool replay with that many packets
+    SimConfig sim{};
+};
+
+void printUsage() {
+    std::printf(
+        "Usage: BleBench [options]\n"
+        "  --request <code|all>  request type 0x01-0x08 (see cipher_suites.h), 0x00 = plaintext + CRC32C baseline (default all)\n"
+        "  --bytes <n>           bytes requested per run (default 20000)\n"
+        "  --word <n>            word (chunk) size in bytes (default 244)\n"
+        "  --delay <ms>          inter-chunk delay (default 0)\n"
+        "  --window <n>          requests in flight (default 4)\n"
+        "  --latency <us>        simulated one-way link latency (default 3750)\n"
+        "  --mcu-ns-per-byte <n> simulated MCU cipher cost per byte (default 120)\n"
+        "  --service-changed <n> simulate a service-changed indication every n requests\n"
+        "  --service-rate <B/s>  simulated sustained response rate of MCU + link (default unlimited)\n"
+        "  --mcu-queue <n>       requests the simulated MCU buffers, more are dropped (default unlimited)\n"
+        "  --adaptive            AIMD pacing instead of the fixed delay\n"
+        "  --seq                 extended request frames with sequence IDs echoed by the peripheral\n"
+        "  --reorder <n>         simulated peripheral holds back every n-th response (see --reorder-delay)\n"
+        "  --reorder-delay <us>  how long a held back response waits (default 20000)\n"
+        "  --timeline <prefix>   write the per-request timeline to <prefix>_0xNN.csv\n"
+        "  --latency-csv <prefix> write the per-request latency breakdown (needs --seq) to <prefix>_0xNN.csv\n"
+        "  --trajectory <prefix> write the pacing trajectory to <prefix>_0xNN.csv\n"
+        "  --spacing <prefix>    write the send spacing histogram to <prefix>_0xNN.csv\n"
+        "  --decrypt-mode <m>    full, verify (tag only, no plaintext) or lazy (keep ciphertext, decrypt at the end)\n"
+        "  --devices <n>         drive n simulated boards at once (one session each)\n"
+        "  --slow <n>            make the first n boards slow (see --slow-rate)\n"
+        "  --slow-rate <B/s>     service rate of a slow board (default 4000)\n"
+        "  --connects <n>        connections set up in parallel (default 4)\n"
+        "  --bystanders <n>      simulated non-connectable advertisers around the bench\n"
+        "  --advert-flood <n>    feed n synthetic adverts through the ingestion path and report adverts/s\n"
+        "  --flood-devices <n>   distinct addresses in the flood (default 5000)\n"
+        "  --batch               with --devices: decrypt what accumulated since the last wakeup in one batch\n"
+        "  --keystream-cache     with --devices: each session caches a ring slot's worth of keystream\n"
+        "  --workers <n>         with --devices: shared pool of n decrypt workers; with --replay: up to n (default cores)\n"
+        "  --replay <n>          push n pre-encrypted packets of --devices streams (default 4) through the decrypt pool\n"
+        "  --crypto-bench        time host decrypt per packet size, split into per-packet and per-byte cost\n"
+        "  --chacha-bench        check the ChaCha20 kernels against mbedTLS and print cycles/byte per packet size\n"
+        "  --poly-bench          check the Poly1305 kernels against mbedTLS and print cycles/byte per message size\n"
+        "  --aead-bench          check the fused ChaCha20-Poly1305 decrypt and compare it with the two-pass paths\n"
+        "  --gcm-bench           check the AES-GCM kernels against mbedTLS and print cycles/byte per packet size\n"
+        "  --crc-bench           check the CRC32C kernels of the plaintext baseline and print cycles/byte\n"
+        "  --mb-bench            ChaCha20 / AES-GCM packets/s, one packet at a time vs batches, per size mix\n"
+        "  --timeout <s>         give up after this many seconds (default 30)\n"
+        "  --verbose             print BleManager log\n");
+}
+
+bool parseArgs(int argc, char** argv, BenchOptions& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* { return (i + 1 < argc) ? argv[++i] : nullptr; };
+        const char* v = nullptr;
+        if (a == "--verbose")  { opt.verbose = true; continue; }
+        if (a == "--adaptive") { opt.adaptive = true; continue; }
+        if (a == "--seq")      { opt.sequenceIds = true; continue; }
+        if (a == "--crypto-bench") { opt.cryptoBench = true; continue; }
+        if (a == "--chacha-bench") { opt.chachaBench = true; continue; }
+        if (a == "--poly-bench")   { opt.polyBench = true; continue; }
+        if (a == "--aead-bench")   { opt.aeadBench = true; continue; }
+        if (a == "--gcm-bench")    { opt.gcmBench = true; continue; }
+        if (a == "--mb-bench")     { opt.mbBench = true; continue; }
+        if (a == "--crc-bench")    { opt.crcBench = true; continue; }
+        if (a == "--batch")    { opt.batchDecrypt = true; continue; }
+        if (a == "--keystream-cache") { opt.keystreamCache = true; continue; }
+        if (a == "--help" || a == "-h") return false;
+        if (!(v = next())) return false;
+
+        if (a == "--request") {
+            if (std::strcmp(v, "all") == 0) {
+                opt.requests.clear();
+            } else {
+                opt.requests.push_back(static_cast<uint8_t>(std::strtoul(v, nullptr, 0)));
+            }
+        }
+        else if (a == "--bytes")           opt.bytes = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else if (a == "--word")            opt.wordSize = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else if (a == "--delay")           opt.delayMs = std::atof(v);
+        else if (a == "--window")          opt.window = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else if (a == "--latency")         opt.sim.linkLatencyUs = std::atof(v);
+        else if (a == "--mcu-ns-per-byte") opt.sim.cipherNsPerByte = std::atof(v);
+        else if (a == "--service-changed") opt.sim.serviceChangedEvery = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else if (a == "--service-rate")    opt.sim.serviceBytesPerSec = std::atof(v);
+        else if (a == "--mcu-queue")       opt.sim.mcuQueueDepth = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else if (a == "--trajectory")      opt.trajectory = v;
+        else if (a == "--timeline")        opt.timeline = v;
+        else if (a == "--latency-csv")     opt.latencyCsv = v;
+        else if (a == "--reorder")         opt.sim.reorderEvery = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else if (a == "--reorder-delay")   opt.sim.reorderDelayUs = std::atof(v);
+        else if (a == "--spacing")         opt.spacing = v;
+        else if (a == "--devices")         opt.devices = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else if (a == "--slow")            opt.slow = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else if (a == "--slow-rate")       opt.slowRate = std::atof(v);
+        else if (a == "--connects")        opt.connects = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else if (a == "--bystanders")      opt.sim.bystanders = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else if (a == "--advert-flood")    opt.advertFlood = std::strtoull(v, nullptr, 0);
+        else if (a == "--flood-devices")   opt.floodDevices = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else if (a == "--workers")         opt.workers = static_cast<uint32_t>(std::strtoul(v, nullptr, 0));
+        else if (a == "--replay")          opt.replay = std::strtoull(v, nullptr, 0);
+        else if (a == "--timeout")         opt.timeoutS = std::atof(v);
+        else if (a == "--decrypt-mode") {
+            if      (std::strcmp(v, "full") == 0)   opt.decryptMode = DecryptMode::Full;
+            else if (std::strcmp(v, "verify") == 0) opt.decryptMode = DecryptMode::VerifyOnly;
+            else if (std::strcmp(v, "lazy") == 0)   opt.decryptMode = DecryptMode::Lazy;
+            else return false;
+        }
+        else return false;
+    }
+    if (opt.requests.empty()) {
+        for (auto const& r : AppConstants::REQUEST_LIST) opt.requests.push_back(r.code);
+    }
+    if (opt.wordSize == 0) opt.wordSize = 1;
+    return true;
+}
+
+const char* requestName(uint8_t code) {
+    for (auto const& r : AppConstants::REQUEST_LIST) {
+        if (r.code == code) return r.name;
+    }
+    return "unknown";
+}
+
+/// Heap allocations of the FE44 handler (ring copy, decrypt, callbacks) over a run
+void printAllocations(const SessionStats& st) {
+    if (!AllocCounter::active() || st.packets == 0) return;
+    const uint64_t steadyPackets = (st.packets > DeviceSession::kWarmupPackets) ? st.packets - DeviceSession::kWarmupPackets : 0;
+    std::printf("%-18s allocations %llu in %llu packets, %llu in %llu steady-state packets (%.3f/packet)%s\n", "",
+                static_cast<unsigned long long>(st.handlerAllocations), static_cast<unsigned long long>(st.packets),
+                static_cast<unsigned long long>(st.steadyAllocations), static_cast<unsigned long long>(steadyPackets),
+                steadyPackets ? static_cast<double>(st.steadyAllocations) / steadyPackets : 0.0,
+                st.oversized ? "  (oversized notifications dropped)" : "");
+}
+
+/// Exact per-request RTT percentiles and reorder/loss counters from the request timeline
+void printRequests(const BleManager& ble, const BenchOptions& opt, const PipelineStats& pipe, uint8_t requestType) {
+    std::vector<double> rtts;
+    for (auto const& r : ble.requestTimeline()) {
+        if (r.outcome == RequestOutcome::Completed) rtts.push_back(r.rttMs());
+    }
+    std::sort(rtts.begin(), rtts.end());
+    auto pct = [&](double p) { return rtts.empty() ? 0.0 : rtts[static_cast<size_t>(p * (rtts.size() - 1))]; };
+    std::printf("%-18s requests %llu/%llu  RTT p50 %.3f p99 %.3f max %.3f ms  reordered %llu  lost %llu  timed out %llu  late %llu (recovered %llu)  stray %llu",
+                "", static_cast<unsigned long long>(pipe.requestsCompleted), static_cast<unsigned long long>(pipe.requestsSent),
+                pct(0.5), pct(0.99), rtts.empty() ? 0.0 : rtts.back(),
+                static_cast<unsigned long long>(pipe.reordered), static_cast<unsigned long long>(pipe.requestsLost),
+                static_cast<unsigned long long>(pipe.requestsTimedOut), static_cast<unsigned long long>(pipe.lateResponses),
+                static_cast<unsigned long long>(pipe.requestsRecovered), static_cast<unsigned long long>(pipe.strayResponses));
+    if (!opt.timeline.empty()) {
+        char path[256];
+        std::snprintf(path, sizeof(path), "%s_0x%02X.csv", opt.timeline.c_str(), requestType);
+        std::printf("  → %s%s", path, ble.writeRequestTimeline(path) ? "" : " (write failed)");
+    }
+    std::printf("\n");
+}
+
+/// Clock sync result and the mean split of the request RTT into its stages
+void printLatency(const BleManager& ble, const BenchOptions& opt, uint8_t requestType) {
+    auto sum = ble.latencySummary();
+    if (sum.clock.samples == 0) {
+        std::printf("%-18s latency no clock sync replies\n", "");
+        return;
+    }
+    std::printf("%-18s clock offset %.1f µs  drift %s  min delay %.1f µs  ±%.1f µs  (%u/%u samples)\n", "",
+                sum.clock.offsetUs, describeDrift(sum.clock).c_str(), sum.clock.minDelayUs, sum.clock.residualUs,
+                sum.clock.used, sum.clock.samples);
+    std::printf("%-18s latency µs mean (p99):", "");
+    for (int p = 0; p < LatencyBreakdown::PartCount; ++p) {
+        std::printf("%s %s %.1f (%.1f)", p ? "," : "", LatencyBreakdown::partName(p), sum.meanUs[p], sum.p99Us[p]);
+    }
+    if (!opt.latencyCsv.empty()) {
+        char path[256];
+        std::snprintf(path, sizeof(path), "%s_0x%02X.csv", opt.latencyCsv.c_str(), requestType);
+        std::printf("  → %s%s", path, ble.writeLatencyBreakdown(path) ? "" : " (write failed)");
+    }
+    std::printf("\n");
+}
+
+/// Totals of one runPipeline(), for the comparison with the plaintext baseline
+struct RunSummary {
+    uint8_t requestType = 0;
+    double  elapsedMs   = 0.0;
+    double  mcuMs       = 0.0;
+    double  hostMs      = 0.0;
+    bool    intact      = false;
+};
+
+/// One end-to-end run (scan, connect, transfer, disconnect) against the simulated peripheral
+RunSummary runPipeline(BleManager& ble, const BenchOptions& opt, uint8_t requestType) {
+    using clock = std::chrono::steady_clock;
+
+    std::mutex mutex;
+    std::vector<double> rtts;
+    std::vector<uint8_t> plaintext;
+    double   hostDecryptMs = 0.0;
+    double   mcuCipherMs   = 0.0;
+    int      failures      = 0;
+    clock::time_point connectedAt{}, lastDataAt{};
+    std::atomic<bool> connected{ false };
+
+    CryptoEngine crypto;
+    crypto.init(requestType);
+    CiphertextLog lazyLog;                  // DecryptMode::Lazy
+    lazyLog.reset(requestType);
+    // the session clamps the word size, so that many packets at most (twice, for refills)
+    const uint32_t word = std::clamp<uint32_t>(opt.wordSize, 1, AppConstants::maxWordSize(requestType));
+    lazyLog.reserve(2 * static_cast<size_t>(opt.bytes) + PacketRing::SLOT_BYTES, 2 * (opt.bytes / word + 1));
+    uint64_t received = 0;                  // plaintext bytes, decrypted or not
+
+    ble.onLog([&](const std::string& msg) {
+        if (opt.verbose) std::printf("  [log] %s\n", msg.c_str());
+    });
+    ble.onStateChanged([&](AppState st) {
+        if (st == AppState::Connected) {
+            std::lock_guard<std::mutex> lock(mutex);
+            connectedAt = clock::now();
+            connected = true;
+        }
+    });
+    ble.onCipherTime([&](double ms, int) {
+        std::lock_guard<std::mutex> lock(mutex);
+        mcuCipherMs += ms;
+    });
+    // sized up front, so the collection doesn't show up in the handler's allocation count
+    rtts.reserve(opt.bytes / std::max<uint32_t>(opt.wordSize, 1) + 64);
+    plaintext.reserve(opt.bytes + PacketRing::SLOT_BYTES);
+    std::vector<uint32_t> packetLengths;     // to check packets one by one when they may be reordered
+    packetLengths.reserve(rtts.capacity());
+    ble.onData([&](const PacketView& packet) {
+        std::lock_guard<std::mutex> lock(mutex);
+        lastDataAt = clock::now();
+        rtts.push_back(packet.rttMs);
+        uint8_t plain[PacketRing::SLOT_BYTES];
+        DecryptResult res;
+        switch (opt.decryptMode) {
+          case DecryptMode::Full:       res = crypto.decrypt(packet.data, plain); break;
+          case DecryptMode::VerifyOnly: res = crypto.verify(packet.data); break;
+          case DecryptMode::Lazy:
+            lazyLog.append(packet.data);
+            res = { DecryptStatus::Ok, crypto.packetPlainLength(packet.data.size()) };
+            break;
+        }
+        hostDecryptMs += std::chrono::duration<double, std::milli>(clock::now() - lastDataAt).count();
+        if (!res) {
+            ++failures;
+            return;
+        }
+        received += res.length;
+        if (opt.decryptMode == DecryptMode::Full) plaintext.insert(plaintext.end(), plain, plain + res.length);
+        packetLengths.push_back(static_cast<uint32_t>(res.length));
+    });
+
+    ble.startScan(AppConstants::DEVICE_LIST[0].second, requestType,
+                  opt.bytes, opt.wordSize, opt.delayMs, opt.window, opt.adaptive, opt.sequenceIds);
+
+    const auto deadline = clock::now() + std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(opt.timeoutS));
+    while (clock::now() < deadline) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (received >= opt.bytes) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ble.stopScan();
+    auto sessions = ble.sessionStats();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // the lazy run's plaintext is asked for now, once
+    double lazyMs = 0.0;
+    if (opt.decryptMode == DecryptMode::Lazy) {
+        auto r = lazyLog.decryptPending(crypto, [&](std::span<const uint8_t> plain) {
+            plaintext.insert(plaintext.end(), plain.begin(), plain.end());
+        });
+        lazyMs = r.ms;
+        failures += static_cast<int>(r.failed);
+    }
+    // everything requested arrived, once, and nothing failed
+    bool intact = (failures == 0) && received == opt.bytes;
+    if (opt.decryptMode == DecryptMode::VerifyOnly) {
+        // tags only, nothing to compare
+    } else if (opt.sim.reorderEvery == 0) {
+        std::vector<uint8_t> expected(plaintext.size());
+        SimPeripheral::fillPlaintext(expected, 0);
+        intact = intact && (plaintext == expected);
+    } else {
+        size_t at = 0;
+        for (uint32_t len : packetLengths) {
+            intact = intact && SimPeripheral::isPlaintext(std::span<const uint8_t>(plaintext).subspan(at, len));
+            at += len;
+        }
+    }
+
+    // no data, no lastDataAt: elapsed and speed stay 0
+    double elapsedMs = connected && received > 0
+        ? std::chrono::duration<double, std::milli>(lastDataAt - connectedAt).count()
+        : 0.0;
+    double speedBps = (elapsedMs > 0) ? received / (elapsedMs / 1000.0) : 0.0;
+
+    double rttAvg = 0.0, rttMin = 0.0, rttMax = 0.0;
+    if (!rtts.empty()) {
+        for (double r : rtts) rttAvg += r;
+        rttAvg /= rtts.size();
+        rttMin = *std::min_element(rtts.begin(), rtts.end());
+        rttMax = *std::max_element(rtts.begin(), rtts.end());
+    }
+
+    std::printf("%-18s %6zu/%-6u B  %9.2f ms  %9.2f kB/s  RTT avg %7.3f min %7.3f max %7.3f ms  "
+                "MCU %8.3f ms  host %7.3f ms  %s\n",
+                requestName(requestType), static_cast<size_t>(received), opt.bytes, elapsedMs, speedBps / 1024.0,
+                rttAvg, rttMin, rttMax, mcuCipherMs, hostDecryptMs,
+                intact ? "ok" : received != opt.bytes ? "INCOMPLETE" : "CORRUPT");
+    if (opt.decryptMode != DecryptMode::Full) {
+        std::printf("%-18s %s: host %.3f µs per notification", "", decryptModeName(opt.decryptMode),
+                    rtts.empty() ? 0.0 : 1000.0 * hostDecryptMs / rtts.size());
+        if (opt.decryptMode == DecryptMode::Lazy) std::printf(", %.3f ms to decrypt the log at the end", lazyMs);
+        std::printf("\n");
+    }
+
+    auto pipe = ble.pipelineStats();
+    std::printf("%-18s window %u  depth avg %.2f max %u  stall %.2f ms  request RTT %.3f ms  %.2f kB/s  timed out %llu  dropped %llu\n",
+                "", pipe.window, pipe.avgDepth, pipe.maxDepth, pipe.stallMs, pipe.avgRttMs,
+                pipe.bytesPerSecond() / 1024.0, static_cast<unsigned long long>(pipe.requestsTimedOut),
+                static_cast<unsigned long long>(pipe.requestsDropped));
+
+    if (!sessions.empty()) printAllocations(sessions.front());
+    if (opt.sequenceIds || !opt.timeline.empty()) printRequests(ble, opt, pipe, requestType);
+    if (opt.sequenceIds) printLatency(ble, opt, requestType);
+
+    auto spacing = ble.pacer().stats();
+    if (spacing.gaps > 0) {
+        std::printf("%-18s spacing requested %.1f µs  actual %.1f µs (min %.1f max %.1f)  jitter %.1f µs  drift %.1f µs  late %llu/%llu",
+                    "", spacing.requestedUs, spacing.meanUs, spacing.minUs, spacing.maxUs, spacing.jitterUs,
+                    spacing.driftUs, static_cast<unsigned long long>(spacing.lateGaps),
+                    static_cast<unsigned long long>(spacing.gaps));
+        if (!opt.spacing.empty()) {
+            char path[256];
+            std::snprintf(path, sizeof(path), "%s_0x%02X.csv", opt.spacing.c_str(), requestType);
+            std::printf("  → %s%s", path, ble.pacer().writeCsv(path) ? "" : " (write failed)");
+        }
+        std::printf("\n");
+    }
+
+    if (opt.adaptive) {
+        auto traj = ble.pacing().trajectory();
+        size_t backoffs = 0;
+        double peak = 0.0;
+        for (auto const& p : traj) {
+            if (p.event == PacingEvent::DecreaseLoss || p.event == PacingEvent::DecreaseRtt) ++backoffs;
+            peak = std::max(peak, p.rateBps);
+        }
+        std::printf("%-18s pacing converged %.2f kB/s  peak %.2f kB/s  %zu rate changes  %zu backoffs",
+                    "", ble.pacing().convergedRateBps() / 1024.0, peak / 1024.0, traj.size() - 1, backoffs);
+        if (!opt.trajectory.empty()) {
+            char path[256];
+            std::snprintf(path, sizeof(path), "%s_0x%02X.csv", opt.trajectory.c_str(), requestType);
+            std::printf("  → %s%s", path, ble.pacing().writeCsv(path) ? "" : " (write failed)");
+        }
+        std::printf("\n");
+    }
+    return { requestType, elapsedMs, mcuCipherMs, hostDecryptMs, intact };
+}
+
+/// What each cipher adds to the link-only cost of the plaintext (0x00) run
+void printBaseline(const std::vector<RunSummary>& runs) {
+    auto base = std::find_if(runs.begin(), runs.end(), [](const RunSummary& r) { return r.requestType == 0x00; });
+    if (base == runs.end() || runs.size() < 2 || !base->intact || base->elapsedMs <= 0) return;
+    std::printf("Crypto cost over the plaintext baseline (%.2f ms, MCU %.3f ms, host %.3f ms):\n",
+                base->elapsedMs, base->mcuMs, base->hostMs);
+    for (auto const& r : runs) {
+        if (r.requestType == 0x00) continue;
+        std::printf("  %-18s transfer %+9.2f ms (%+6.1f %%)  MCU %+9.3f ms  host %+8.3f ms%s\n",
+                    requestName(r.requestType), r.elapsedMs - base->elapsedMs,
+                    100.0 * (r.elapsedMs - base->elapsedMs) / base->elapsedMs, r.mcuMs - base->mcuMs,
+                    r.hostMs - base->hostMs, r.intact ? "" : "  (CORRUPT)");
+    }
+}
+
+/// Simulated rack of boards with consecutive addresses
+std::vector<std::pair<std::string, uint64_t>> makeRack(uint32_t count) {
+    std::vector<std::pair<std::string, uint64_t>> rack;
+    for (uint32_t i = 0; i < count; ++i) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "STM32 rack #%02u", i + 1);
+        rack.emplace_back(name, 0x0080E1000000ull + i);
+    }
+    return rack;
+}
+
+/// All boards of the rack at once, one session each; prints per-device and aggregate numbers
+void runSessions(BleManager& ble, SimTransport& sim, const BenchOptions& opt, uint8_t requestType,
+                 const std::vector<std::pair<std::string, uint64_t>>& rack) {
+    using clock = std::chrono::steady_clock;
+
+    std::mutex mutex;
+    std::map<uint64_t, uint64_t> offsets;      // plaintext received per device
+    uint64_t corrupt = 0;
+
+    for (uint32_t i = 0; i < opt.slow && i < rack.size(); ++i) {
+        SimConfig slow = opt.sim;
+        slow.serviceBytesPerSec = opt.slowRate;
+        sim.setDeviceConfig(rack[i].second, slow);
+    }
+
+    ble.onLog([&](const std::string& msg) {
+        if (opt.verbose) std::printf("  [log] %s\n", msg.c_str());
+    });
+    ble.onStateChanged(nullptr);
+    ble.onCipherTime(nullptr);
+    ble.onData(nullptr);
+    // every key is present before the run, lookups in the handler don't insert
+    for (auto const& d : rack) offsets[d.second] = 0;
+    ble.onDeviceData([&](uint64_t address, std::span<const uint8_t> plain, double) {
+        if (opt.sim.reorderEvery) {         // stream order isn't kept, check each packet on its own
+            if (!SimPeripheral::isPlaintext(plain)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++corrupt;
+            }
+            return;
+        }
+        thread_local std::vector<uint8_t> expected(PacketRing::SLOT_BYTES);
+        expected.resize(plain.size());
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t& offset = offsets[address];
+        SimPeripheral::fillPlaintext(expected, offset);
+        if (!std::equal(plain.begin(), plain.end(), expected.begin())) ++corrupt;
+        offset += plain.size();
+    });
+
+    SessionConfig cfg;
+    cfg.requestType       = requestType;
+    cfg.bytesToRequest    = opt.bytes;
+    cfg.wordSize          = opt.wordSize;
+    cfg.interChunkDelayMs = opt.delayMs;
+    cfg.window            = opt.window;
+    cfg.adaptivePacing    = opt.adaptive;
+    cfg.sequenceIds       = opt.sequenceIds;
+    cfg.decrypt           = true;
+    cfg.batchDecrypt      = opt.batchDecrypt;
+    cfg.keystreamCache    = opt.keystreamCache;
+    ble.setDecryptWorkers(opt.workers);
+
+    std::vector<uint64_t> addresses;
+    for (auto const& d : rack) addresses.push_back(d.second);
+    ble.setMaxConcurrentConnects(opt.connects);
+    ble.startSessions(addresses, cfg);
+
+    // wait for the fast boards; slow ones are reported with what they managed
+    const auto deadline = clock::now() + std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(opt.timeoutS));
+    while (clock::now() < deadline) {
+        auto sessions = ble.sessionStats();
+        size_t finished = 0;
+        for (auto const& st : sessions) {
+            if (st.state == SessionState::Done || st.state == SessionState::Failed) ++finished;
+        }
+        if (finished == sessions.size()) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    auto sessions = ble.sessionStats();
+    auto agg = ble.aggregateStats();
+    ble.stopScan();
+
+    std::printf("%-18s %u devices (%u slow), %u done, %u failed\n",
+                requestName(requestType), agg.devices, opt.slow, agg.done, agg.failed);
+    // large racks: the slow boards and a couple of fast ones are enough to see the spread
+    const size_t shown = (opt.verbose || sessions.size() <= 8) ? sessions.size() : std::min<size_t>(sessions.size(), opt.slow + 2);
+    for (size_t i = 0; i < shown; ++i) {
+        auto const& st = sessions[i];
+        std::printf("  %012llX %-12s %6llu B  %9.2f kB/s  connect %7.2f ms  RTT %7.3f ms  MCU %8.3f ms  host %7.3f ms\n",
+                    static_cast<unsigned long long>(st.address), sessionStateName(st.state),
+                    static_cast<unsigned long long>(st.plaintextBytes), st.bytesPerSecond() / 1024.0,
+                    st.connectMs, st.pipeline.avgRttMs, st.mcuCipherMs, st.hostDecryptMs);
+    }
+    if (shown < sessions.size()) std::printf("  … %zu more\n", sessions.size() - shown);
+    std::printf("  aggregate %.2f kB/s over %.2f ms (sum of devices %.2f kB/s), %llu packets, %llu decrypt failures, %s\n",
+                agg.bytesPerSecond() / 1024.0, agg.elapsedMs, agg.sumDeviceBytesPerSecond / 1024.0,
+                static_cast<unsigned long long>(agg.packets),
+                static_cast<unsigned long long>(agg.decryptFailures),
+                (corrupt == 0 && agg.decryptFailures == 0) ? "ok" : "CORRUPT");
+    if (opt.batchDecrypt) {
+        uint64_t batches = 0, overruns = 0, packets = 0;
+        uint32_t maxBatch = 0;
+        for (auto const& st : sessions) {
+            batches  += st.batches;
+            packets  += st.packets;
+            overruns += st.ringOverruns;
+            maxBatch  = std::max(maxBatch, st.maxBatch);
+        }
+        std::printf("  %llu decrypt batches, %.2f packets avg, %u max, %llu ring overruns\n",
+                    static_cast<unsigned long long>(batches), batches ? static_cast<double>(packets) / batches : 0.0,
+                    maxBatch, static_cast<unsigned long long>(overruns));
+    }
+    if (opt.keystreamCache) {
+        uint64_t hits = 0, misses = 0;
+        size_t footprint = 0;
+        for (auto const& st : sessions) {
+            hits      += st.keystreamCache.hits;
+            misses    += st.keystreamCache.misses;
+            footprint += st.keystreamCache.footprint;
+        }
+        std::printf("  keystream cache: %zu B per session, %zu kB total, %.1f %% hits (%llu / %llu)\n",
+                    sessions.empty() ? size_t{ 0 } : sessions.front().keystreamCache.footprint, footprint / 1024,
+                    100.0 * (hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0),
+                    static_cast<unsigned long long>(hits), static_cast<unsigned long long>(hits + misses));
+    }
+    if (opt.workers > 0) {
+        auto pool = ble.decryptPoolStats();
+        std::printf("  decrypt pool: %u workers, %llu/%llu delivered in order, %llu held back, %llu submit stalls, busy %.2f ms, per worker",
+                    pool.workers, static_cast<unsigned long long>(pool.delivered), static_cast<unsigned long long>(pool.submitted),
+                    static_cast<unsigned long long>(pool.heldBack), static_cast<unsigned long long>(pool.submitStalls), pool.busyMs);
+        for (uint64_t n : pool.perWorker) std::printf(" %llu", static_cast<unsigned long long>(n));
+        std::printf("\n");
+    }
+    if (AllocCounter::active()) {
+        std::printf("  %llu heap allocations in FE44 handlers after warm-up\n",
+                    static_cast<unsigned long long>(agg.steadyAllocations));
+    }
+}
+
+/// Synthetic advert flood: a lab full of bystanders plus a rack of allow-listed boards,
+/// fed through AdvertIngest and through the old format-and-log-every-advert path
+void runAdvertFlood(const BenchOptions& opt) {
+    using clock = std::chrono::steady_clock;
+    constexpr uint32_t kAllowed = 32;
+
+    std::mt19937_64 rng(opt.sim.seed);
+    std::vector<uint64_t> allowList;
+    for (uint32_t i = 0; i < kAllowed; ++i) allowList.push_back(0x0080E1000000ull + i);
+    std::vector<uint64_t> pool(allowList);
+    for (uint32_t i = 0; i < opt.floodDevices; ++i) pool.push_back((rng() & 0xFFFFFFFFFFFFull) | 1);
+
+    // pre-generated advert stream, so the loop measures ingestion only
+    std::vector<BleAdvertisement> stream(1u << 16);
+    std::uniform_int_distribution<size_t> pick(0, pool.size() - 1);
+    std::uniform_int_distribution<int> rssi(-95, -40);
+    for (auto& adv : stream) {
+        adv.address = pool[pick(rng)];
+        adv.rssi    = static_cast<int16_t>(rssi(rng));
+    }
+
+    AdvertIngest ingest;
+    uint32_t summaries = 0;
+    ingest.onSummary([&](const std::string& line) {
+        ++summaries;
+        if (opt.verbose) std::printf("  [log] %s\n", line.c_str());
+    });
+    ingest.reset(allowList, AppConstants::ADVERT_SUMMARY_MS);
+
+    uint64_t allowed = 0;
+    auto t0 = clock::now();
+    for (uint64_t i = 0; i < opt.advertFlood; ++i) {
+        allowed += ingest.ingest(stream[i & (stream.size() - 1)]);
+    }
+    double s = std::chrono::duration<double>(clock::now() - t0).count();
+    auto st = ingest.stats();
+    std::printf("Advert flood: %llu adverts from %zu addresses in %.3f s → %.2f M adverts/s (%.1f ns each)\n",
+                static_cast<unsigned long long>(st.adverts), pool.size(), s, st.adverts / s / 1e6, s * 1e9 / st.adverts);
+    std::printf("  %llu allow-listed, %zu devices tracked, %llu untracked (table full), %u summary lines\n",
+                static_cast<unsigned long long>(allowed), st.devices,
+                static_cast<unsigned long long>(st.untracked), summaries);
+
+    // previous watcher handler: one formatted line per advert into a console-sized buffer
+    const uint64_t legacyCount = std::min<uint64_t>(opt.advertFlood, 1000000);
+    std::vector<std::string> console;
+    console.reserve(4096);
+    t0 = clock::now();
+    for (uint64_t i = 0; i < legacyCount; ++i) {
+        auto const& adv = stream[i & (stream.size() - 1)];
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "Advertisement %016llX RSSI %d",
+                      static_cast<unsigned long long>(adv.address), adv.rssi);
+        if (console.size() == 4096) console.clear();
+        console.emplace_back(buf);
+    }
+    s = std::chrono::duration<double>(clock::now() - t0).count();
+    std::printf("  per-advert log line: %.2f M adverts/s (%.1f ns each)\n", legacyCount / s / 1e6, s * 1e9 / legacyCount);
+}
+
+//––– Crypto micro-benchmark –––//
+
+/// Previous per-packet path: a fresh, freshly keyed mbedTLS context for every packet
+void decryptWithFreshContext(uint8_t requestType, std::span<const uint8_t> packet, std::vector<uint8_t>& out) {
+    constexpr size_t kTag = 16;
+    switch (requestType) {
+      case 0x00: {
+        // no context to set up; the table kernel stands in for a library CRC
+        out.assign(packet.begin(), packet.end() - AppConstants::CRC_BYTES);
+        volatile uint32_t crc = Crc32c::compute(Crc32c::Kernel::Scalar, out.data(), out.size());
+        (void)crc;
+        break;
+      }
+      case 0x01:
+        out.resize(packet.size());
+        mbedtls_chacha20_crypt(AppConstants::KEY.data(), AppConstants::NONCE.data(), 1,
+                               packet.size(), packet.data(), out.data());
+        break;
+      case 0x02: {
+        mbedtls_chachapoly_context ctx;
+        mbedtls_chachapoly_init(&ctx);
+        mbedtls_chachapoly_setkey(&ctx, AppConstants::KEY.data());
+        out.resize(packet.size() - kTag);
+        mbedtls_chachapoly_auth_decrypt(&ctx, out.size(), AppConstants::NONCE.data(), nullptr, 0,
+                                        packet.data(), packet.data() + kTag, out.data());
+        mbedtls_chachapoly_free(&ctx);
+        break;
+      }
+      case 0x04:
+      case 0x05:
+        // no mbedTLS ChaCha12/8: state setup plus the portable kernel
+        out.resize(packet.size());
+        ChaCha20::xorStream(ChaCha20::Kernel::Scalar,
+                            ChaCha20::makeState(AppConstants::KEY.data(), AppConstants::NONCE.data(), 1,
+                                                requestType == 0x04 ? 12 : 8),
+                            packet.data(), out.data(), packet.size());
+        break;
+      case 0x06: {
+        uint8_t subkey[32];
+        uint8_t nonce[12] = {};
+        ChaCha20::hchacha20(AppConstants::KEY.data(), AppConstants::XNONCE.data(), subkey);
+        std::memcpy(nonce + 4, AppConstants::XNONCE.data() + 16, 8);
+        mbedtls_chachapoly_context ctx;
+        mbedtls_chachapoly_init(&ctx);
+        mbedtls_chachapoly_setkey(&ctx, subkey);
+        out.resize(packet.size() - kTag);
+        mbedtls_chachapoly_auth_decrypt(&ctx, out.size(), nonce, nullptr, 0,
+                                        packet.data(), packet.data() + kTag, out.data());
+        mbedtls_chachapoly_free(&ctx);
+        break;
+      }
+      case 0x08: {
+        mbedtls_ccm_context ctx;
+        mbedtls_ccm_init(&ctx);
+        mbedtls_ccm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, AppConstants::KEY.data(),
+                           (unsigned)AppConstants::KEY.size() * 8);
+        out.resize(packet.size() - kTag);
+        mbedtls_ccm_auth_decrypt(&ctx, out.size(), AppConstants::NONCE.data(), AppConstants::NONCE.size(),
+                                 nullptr, 0, packet.data(), out.data(), packet.data() + out.size(), kTag);
+        mbedtls_ccm_free(&ctx);
+        break;
+      }
+      case 0x03:
+      case 0x07: {
+        mbedtls_gcm_context ctx;
+        mbedtls_gcm_init(&ctx);
+        mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, AppConstants::KEY.data(), requestType == 0x07 ? 128 : 256);
+        out.resize(packet.size() - kTag);
+        mbedtls_gcm_auth_decrypt(&ctx, out.size(), AppConstants::NONCE.data(), AppConstants::NONCE.size(),
+                                 nullptr, 0, packet.data() + out.size(), kTag, packet.data(), out.data());
+        mbedtls_gcm_free(&ctx);
+        break;
+      }
+      default:
+        break;
+    }
+}
+
+/// Least-squares fit ns = fixed + perByte · bytes over the measured packet sizes
+struct CostFit {
+    double fixedNs   = 0.0;
+    double perByteNs = 0.0;
+};
+
+CostFit fitCost(const std::vector<size_t>& sizes, const std::vector<double>& ns) {
+    double n = static_cast<double>(sizes.size()), sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        const double x = static_cast<double>(sizes[i]);
+        sx += x; sy += ns[i]; sxx += x * x; sxy += x * ns[i];
+    }
+    CostFit fit;
+    fit.perByteNs = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    fit.fixedNs   = (sy - fit.perByteNs * sx) / n;
+    return fit;
+}
+
+/// ns per packet of `decrypt`, over enough packets to take ~50 ms
+template <typename Decrypt>
+double timePerPacket(Decrypt&& decrypt) {
+    using clock = std::chrono::steady_clock;
+    uint64_t packets = 0;
+    auto t0 = clock::now();
+    double elapsed = 0.0;
+    do {
+        for (int i = 0; i < 256; ++i) decrypt();
+        packets += 256;
+        elapsed = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+    } while (elapsed < 50e6);
+    return elapsed / packets;
+}
+
+/// Host decrypt cost per packet size through the span API (bound by init(), and as
+/// decrypt<Suite>() without any dispatch), in batches, through the allocating vector
+/// API, with a fresh context per packet, from the keystream cache, tag only and as a lazy copy;
+/// the fit separates per-packet setup from per-byte work. Ends with the span and batch costs of
+/// every requested suite side by side.
+void runCryptoBench(const BenchOptions& opt) {
+    const std::vector<size_t> sizes = { 16, 64, 128, 244, 512, 1024, 4096 };
+    auto header = [&]() {
+        std::printf("%-18s %-12s", "", "");
+        for (size_t n : sizes) std::printf(" %8zu", n);
+        std::printf("   fixed ns/packet  ns/B\n");
+    };
+    std::printf("Host decrypt, ns per packet (plaintext bytes):\n");
+    header();
+
+    struct MatrixRow {
+        uint8_t             req;
+        std::vector<double> span, batch;
+    };
+    std::vector<MatrixRow> matrix;
+
+    for (uint8_t req : opt.requests) {
+        CryptoEngine engine, cached;
+        engine.init(req);
+        cached.init(req);
+        cached.setKeystreamCache(true, sizes.back());
+        std::vector<uint8_t> out(sizes.back()), freshOut;
+        std::vector<double> span, statics, batch, vector, fresh, cache, verify, lazy;
+        CiphertextLog log;
+        constexpr size_t kBatch = 64;
+        std::vector<uint8_t> batchOut(kBatch * sizes.back());
+        std::vector<BatchPacket> packets(kBatch);
+        for (size_t n : sizes) {
+            std::vector<uint8_t> plain(n);
+            for (size_t i = 0; i < n; ++i) plain[i] = static_cast<uint8_t>(i * 7 + 1);
+            const auto packet = SimPeripheral::encryptResponse(req, plain);
+            span.push_back(timePerPacket([&]() { engine.decrypt(packet, out); }));
+            CipherSuites::visit(req, [&](auto suite) {
+                using Suite = decltype(suite);
+                statics.push_back(timePerPacket([&]() { engine.decrypt<Suite>(packet, out); }));
+            });
+            for (size_t i = 0; i < kBatch; ++i) {
+                packets[i].in  = packet;
+                packets[i].out = std::span<uint8_t>(batchOut.data() + i * sizes.back(), sizes.back());
+            }
+            batch.push_back(timePerPacket([&]() { engine.decryptBatch(packets); }) / kBatch);
+            double ms = 0.0;
+            vector.push_back(timePerPacket([&]() { auto p = engine.decrypt(packet, ms); (void)p; }));
+            fresh.push_back(timePerPacket([&]() { decryptWithFreshContext(req, packet, freshOut); }));
+            cache.push_back(timePerPacket([&]() { cached.decrypt(packet, out); }));
+            verify.push_back(timePerPacket([&]() { engine.verify(packet); }));
+            // the log restarts now and then, the cost is the copy
+            size_t logged = 0;
+            log.reset(req);
+            log.reserve(1024 * packet.size(), 1024);
+            lazy.push_back(timePerPacket([&]() {
+                if (++logged == 1024) { log.reset(req); logged = 0; }
+                log.append(packet);
+            }));
+            if (!std::equal(plain.begin(), plain.end(), out.begin()))
+                std::printf("%s: keystream cache mismatch at %zu B\n", requestName(req), n);
+
+            // in place: the plaintext ends up at the start of the packet's own buffer
+            auto inPlace = packet;
+            DecryptResult r = engine.decrypt(inPlace, inPlace);
+            if (!r || !std::equal(plain.begin(), plain.end(), inPlace.begin()))
+                std::printf("%s: in-place decrypt mismatch at %zu B (%s)\n", requestName(req), n, decryptStatusName(r.status));
+            if (findSuite(req)->tagBytes > 0) {
+                auto forged = packet;
+                forged[forged.size() / 2] ^= 0x01;
+                if (engine.decrypt(forged, out).status != DecryptStatus::TagMismatch ||
+                    engine.verify(forged).status != DecryptStatus::TagMismatch)
+                    std::printf("%s: forged packet not rejected at %zu B\n", requestName(req), n);
+            }
+        }
+        auto row = [&](const char* label, const std::vector<double>& ns) {
+            auto fit = fitCost(sizes, ns);
+            std::printf("%-18s %-12s", label, "");
+            for (double v : ns) std::printf(" %8.0f", v);
+            std::printf("   %15.0f  %5.2f\n", fit.fixedNs, fit.perByteNs);
+        };
+        auto c = engine.counters(req);
+        std::printf("%s  (%llu packets, %llu tag failures, %llu errors)\n", requestName(req),
+                    static_cast<unsigned long long>(c.packets), static_cast<unsigned long long>(c.tagFailures),
+                    static_cast<unsigned long long>(c.errors));
+        row("  span", span);
+        row("  static suite", statics);
+        row("  batch of 64", batch);
+        row("  vector", vector);
+        row("  fresh context", fresh);
+        row("  keystream cache", cache);
+        row("  verify only", verify);
+        row("  lazy (copy)", lazy);
+        auto ks = cached.keystreamCacheStats();
+        std::printf("%-18s %-12s %zu B of keystream, %zu B footprint, %.1f %% hits%s\n", "  ", "", ks.bytes,
+                    ks.footprint, 100.0 * ks.hitRate(), ks.hits + ks.misses == 0 ? " (not used by this suite)"
+                    : (req == 0x03 && !ks.gcmCached) ? " (no AES-NI: GCM not cached)" : "");
+        matrix.push_back({ req, span, batch });
+    }
+
+    // the whole matrix in one place, a suite per line: span decrypt, then a batch of 64
+    if (matrix.size() < 2) return;
+    for (int pass = 0; pass < 2; ++pass) {
+        std::printf("\nSuite matrix, %s, ns per packet (plaintext bytes):\n", pass ? "batch of 64" : "span decrypt");
+        header();
+        for (auto const& m : matrix) {
+            const auto& ns = pass ? m.batch : m.span;
+            auto fit = fitCost(sizes, ns);
+            std::printf("%-31s", requestName(m.req));
+            for (double v : ns) std::printf(" %8.0f", v);
+            std::printf("   %15.0f  %5.2f\n", fit.fixedNs, fit.perByteNs);
+        }
+    }
+}
+
+//––– ChaCha20 kernels –––//
+
+/// Time stamp counter ticks per ns, measured once against steady_clock (0 off x86)
+double tscPerNs() {
+#if BLE_X86
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    const uint64_t c0 = __rdtsc();
+    while (clock::now() - t0 < std::chrono::milliseconds(100)) {}
+    const uint64_t c1 = __rdtsc();
+    return (c1 - c0) / std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+#else
+    return 0.0;
+#endif
+}
+
+const std::vector<size_t> kKernelSizes = { 20, 64, 244, 512, 1024, 4096, 16384, 50000 };
+
+/// Header of a cycles/byte table over kKernelSizes
+void printKernelHeader(double tsc) {
+    std::printf("cycles/byte (GB/s)%s\n%-10s", tsc > 0 ? "" : " - no TSC, ns/byte instead", "");
+    for (size_t n : kKernelSizes) std::printf(" %15zu", n);
+    std::printf("\n");
+}
+
+/// One row: run(n) timed for every size
+template <typename Run>
+void printKernelRow(const char* label, double tsc, Run&& run) {
+    std::printf("%-10s", label);
+    for (size_t n : kKernelSizes) {
+        const double ns = timePerPacket([&]() { run(n); });
+        std::printf("   %5.2f (%5.2f)", (tsc > 0 ? ns * tsc : ns) / n, n / ns);
+    }
+    std::printf("\n");
+}
+
+/// Self-test of every kernel against mbedTLS, then the keystream cost per packet size for
+/// each kernel and mbedtls_chacha20_crypt(); cycles are TSC ticks (the nominal clock)
+bool runChaChaBench() {
+    const bool ok = ChaCha20::selfTest();
+    std::printf("ChaCha20 self-test (RFC 8439 vectors, kernels vs mbedTLS): %s, best kernel %s\n",
+                ok ? "ok" : "FAILED", ChaCha20::kernelName(ChaCha20::bestKernel()));
+    if (!ok) return false;
+
+    const double tsc = tscPerNs();
+    printKernelHeader(tsc);
+    std::vector<uint8_t> in(kKernelSizes.back()), out(kKernelSizes.back());
+    for (size_t i = 0; i < in.size(); ++i) in[i] = static_cast<uint8_t>(i * 7 + 1);
+    const ChaCha20::State st = ChaCha20::makeState(AppConstants::KEY.data(), AppConstants::NONCE.data(), 1);
+    printKernelRow("mbedTLS", tsc, [&](size_t n) {
+        mbedtls_chacha20_crypt(AppConstants::KEY.data(), AppConstants::NONCE.data(), 1, n, in.data(), out.data());
+    });
+    for (auto k : { ChaCha20::Kernel::Scalar, ChaCha20::Kernel::Sse2, ChaCha20::Kernel::Avx2 }) {
+        if (!ChaCha20::kernelSupported(k)) continue;
+        printKernelRow(ChaCha20::kernelName(k), tsc, [&](size_t n) {
+            ChaCha20::xorStream(k, st, in.data(), out.data(), n);
+        });
+    }
+    return true;
+}
+
+/// Same for Poly1305: self-test, then the MAC cost per message size for each kernel and
+/// mbedtls_poly1305_mac()
+/// CRC32C of the plaintext baseline: self-test, then the table and SSE4.2 kernels
+bool runCrcBench() {
+    const bool ok = Crc32c::selfTest();
+    std::printf("CRC32C self-test (RFC 3720 vectors, kernels vs table): %s, best kernel %s\n",
+                ok ? "ok" : "FAILED", Crc32c::kernelName(Crc32c::bestKernel()));
+    if (!ok) return false;
+
+    const double tsc = tscPerNs();
+    printKernelHeader(tsc);
+    std::vector<uint8_t> msg(kKernelSizes.back());
+    for (size_t i = 0; i < msg.size(); ++i) msg[i] = static_cast<uint8_t>(i * 7 + 1);
+    volatile uint32_t sink = 0;
+    for (auto k : { Crc32c::Kernel::Scalar, Crc32c::Kernel::Sse42 }) {
+        if (!Crc32c::kernelSupported(k)) continue;
+        printKernelRow(Crc32c::kernelName(k), tsc, [&](size_t n) { sink = Crc32c::compute(k, msg.data(), n); });
+    }
+    return true;
+}
+
+bool runPolyBench() {
+    const bool ok = Poly1305::selfTest();
+    std::printf("Poly1305 self-test (RFC 8439 vectors, kernels vs mbedTLS): %s, best kernel %s\n",
+                ok ? "ok" : "FAILED", Poly1305::kernelName(Poly1305::bestKernel()));
+    if (!ok) return false;
+
+    const double tsc = tscPerNs();
+    printKernelHeader(tsc);
+    std::vector<uint8_t> msg(kKernelSizes.back());
+    for (size_t i = 0; i < msg.size(); ++i) msg[i] = static_cast<uint8_t>(i * 7 + 1);
+    const uint8_t* key = AppConstants::KEY.data();
+    uint8_t tag[16];
+    printKernelRow("mbedTLS", tsc, [&](size_t n) { mbedtls_poly1305_mac(key, msg.data(), n, tag); });
+    for (auto k : { Poly1305::Kernel::Scalar, Poly1305::Kernel::Avx2 }) {
+        if (!Poly1305::kernelSupported(k)) continue;
+        printKernelRow(Poly1305::kernelName(k), tsc, [&](size_t n) {
+            Poly1305::Mac mac(k, key);
+            mac.update(msg.data(), n);
+            mac.finish(tag);
+        });
+    }
+    return true;
+}
+
+/// ChaCha20-Poly1305 decrypt of tag-first packets: mbedTLS (MAC pass, then cipher pass),
+/// the same two passes on the project kernels, and the fused path at several tile sizes
+bool runAeadBench() {
+    const bool ok = ChaChaPoly::selfTest();
+    std::printf("ChaCha20-Poly1305 fused decrypt self-test (vs mbedTLS, in place, forged tags): %s\n",
+                ok ? "ok" : "FAILED");
+    if (!ok) return false;
+
+    const double tsc = tscPerNs();
+    printKernelHeader(tsc);
+    std::map<size_t, std::vector<uint8_t>> packets;
+    std::vector<uint8_t> out(kKernelSizes.back());
+    mbedtls_chachapoly_context ctx;
+    mbedtls_chachapoly_init(&ctx);
+    mbedtls_chachapoly_setkey(&ctx, AppConstants::KEY.data());
+    for (size_t n : kKernelSizes) {
+        std::vector<uint8_t> plain(n);
+        for (size_t i = 0; i < n; ++i) plain[i] = static_cast<uint8_t>(i * 7 + 1);
+        packets[n] = SimPeripheral::encryptResponse(0x02, plain);
+    }
+    const uint8_t* nonce = AppConstants::NONCE.data();
+    printKernelRow("mbedTLS", tsc, [&](size_t n) {
+        const auto& p = packets[n];
+        mbedtls_chachapoly_auth_decrypt(&ctx, n, nonce, nullptr, 0, p.data(), p.data() + 16, out.data());
+    });
+    const ChaCha20::State st = ChaCha20::makeState(AppConstants::KEY.data(), nonce, 0);
+    auto fusedRow = [&](const char* label, size_t tile) {
+        printKernelRow(label, tsc, [&](size_t n) {
+            const auto& p = packets[n];
+            ChaChaPoly::decrypt(st, p.data(), p.data() + 16, n, out.data(), tile);
+        });
+    };
+    fusedRow("2-pass", 0);
+    fusedRow("tile 1k", 1024);
+    fusedRow("tile 4k", 4096);
+    fusedRow("tile 16k", 16384);
+    mbedtls_chachapoly_free(&ctx);
+    return true;
+}
+
+/// AES-256-GCM decrypt of ct||tag packets: self-test, then each kernel (Scalar = mbedTLS)
+bool runGcmBench() {
+    const bool ok = AesGcm::selfTest();
+    std::printf("AES-GCM self-test (NIST vectors, kernels vs mbedTLS, in place, forged tags): %s, best kernel %s\n",
+                ok ? "ok" : "FAILED", AesGcm::kernelName(AesGcm::bestKernel()));
+    if (!ok) return false;
+
+    const double tsc = tscPerNs();
+    printKernelHeader(tsc);
+    std::map<size_t, std::vector<uint8_t>> packets;
+    for (size_t n : kKernelSizes) {
+        std::vector<uint8_t> plain(n);
+        for (size_t i = 0; i < n; ++i) plain[i] = static_cast<uint8_t>(i * 7 + 1);
+        packets[n] = SimPeripheral::encryptResponse(0x03, plain);
+    }
+    AesGcm::Key key;
+    key.setKey(AppConstants::KEY.data());
+    std::vector<uint8_t> out(kKernelSizes.back());
+    for (auto k : { AesGcm::Kernel::Scalar, AesGcm::Kernel::AesNi, AesGcm::Kernel::Vaes }) {
+        if (!AesGcm::kernelSupported(k)) continue;
+        printKernelRow(AesGcm::kernelName(k), tsc, [&](size_t n) {
+            const auto& p = packets[n];
+            AesGcm::decrypt(k, key, AppConstants::NONCE.data(), p.data(), n, p.data() + n, out.data());
+        });
+    }
+    return true;
+}
+
+/// Packets/s of ChaCha20 (0x01) and AES-GCM (0x03) over notification-size mixes: each packet on
+/// its own through the kernel vs the kernel's batch entry (ChaCha20::xorStreams(),
+/// AesGcm::decryptBatch()), and CryptoEngine::decrypt() per packet vs decryptBatch() in batches
+/// of 64 like the session decrypt thread
+bool runMultiBufferBench(const BenchOptions& opt) {
+    const bool chachaOk = ChaCha20::selfTest(), gcmOk = AesGcm::selfTest();
+    std::printf("ChaCha20 self-test (kernels and multi-buffer vs mbedTLS): %s, best kernel %s\n",
+                chachaOk ? "ok" : "FAILED", ChaCha20::kernelName(ChaCha20::bestKernel()));
+    std::printf("AES-GCM self-test (kernels and batches vs mbedTLS): %s, best kernel %s\n",
+                gcmOk ? "ok" : "FAILED", AesGcm::kernelName(AesGcm::bestKernel()));
+    if (!chachaOk || !gcmOk) return false;
+
+    struct Mix {
+        const char* label;
+        size_t (*size)(uint32_t r);     ///< packet size from a random number
+    };
+    const Mix mixes[] = {
+        { "20 B",             [](uint32_t)   -> size_t { return 20; } },
+        { "64 B",             [](uint32_t)   -> size_t { return 64; } },
+        { "244 B (MTU word)", [](uint32_t)   -> size_t { return 244; } },
+        { "uniform 20-500 B", [](uint32_t r) -> size_t { return 20 + r % 481; } },
+        // mostly full 244 B words, short last words of a transfer, some 500 B words
+        { "notification mix", [](uint32_t r) -> size_t { const uint32_t p = r % 100;
+                                                         return p < 80 ? 244 : p < 95 ? 20 + (r >> 8) % 45 : 500; } },
+    };
+    constexpr size_t kPackets = 1024, kBatch = 64, kSlot = 512;
+    const ChaCha20::State st = ChaCha20::makeState(AppConstants::KEY.data(), AppConstants::NONCE.data(), 1);
+    AesGcm::Key gcmKey;
+    gcmKey.setKey(AppConstants::KEY.data());
+
+    for (uint8_t req : opt.requests) {
+        if (req != 0x01 && req != 0x03) continue;
+        std::printf("%s, packets/s\n%-18s %12s %12s %8s   %12s %12s %8s\n", requestName(req), "",
+                    "kernel", "kernel batch", "", "decrypt", "decryptBatch", "");
+        CryptoEngine engine;
+        engine.init(req);
+        uint32_t seed = 0x9e3779b9;
+        for (const Mix& mix : mixes) {
+            std::vector<std::vector<uint8_t>> plain(kPackets), packets(kPackets);
+            std::vector<uint8_t> out(kPackets * kSlot);
+            std::vector<ChaCha20::Stream> streams(kPackets);
+            std::vector<AesGcm::Packet> gcm(kPackets);
+            std::vector<BatchPacket> batch(kPackets);
+            for (size_t i = 0; i < kPackets; ++i) {
+                seed = seed * 1664525 + 1013904223;
+                plain[i].resize(mix.size(seed >> 4));
+                for (size_t b = 0; b < plain[i].size(); ++b) plain[i][b] = static_cast<uint8_t>(b * 7 + i);
+                packets[i] = SimPeripheral::encryptResponse(req, plain[i]);
+                uint8_t* slot = out.data() + i * kSlot;
+                const size_t n = plain[i].size();
+                streams[i] = { &st, packets[i].data(), slot, n };
+                gcm[i] = { AppConstants::NONCE.data(), packets[i].data(), n, packets[i].data() + n, slot };
+                batch[i].in  = packets[i];
+                batch[i].out = std::span<uint8_t>(slot, kSlot);
+            }
+
+            double single = 0.0, multi = 0.0;
+            if (req == 0x01) {
+                single = timePerPacket([&]() {
+                    for (auto const& s : streams) ChaCha20::xorStream(*s.st, s.in, s.out, s.len);
+                });
+                multi = timePerPacket([&]() { ChaCha20::xorStreams(streams.data(), kPackets); });
+            } else {
+                single = timePerPacket([&]() {
+                    for (auto& p : gcm) p.ok = AesGcm::decrypt(gcmKey, p.iv, p.ct, p.len, p.tag, p.out);
+                });
+                multi = timePerPacket([&]() { AesGcm::decryptBatch(gcmKey, gcm.data(), kPackets); });
+            }
+            const double perPacket = timePerPacket([&]() {
+                for (auto& p : batch) engine.decrypt(p.in, p.out);
+            });
+            const double batched = timePerPacket([&]() {
+                for (size_t i = 0; i < kPackets; i += kBatch) engine.decryptBatch(std::span(batch).subspan(i, kBatch));
+            });
+
+            bool same = true;
+            for (size_t i = 0; i < kPackets && same; ++i) {
+                same = batch[i].result && std::equal(plain[i].begin(), plain[i].end(), out.begin() + i * kSlot);
+            }
+            // timePerPacket() timed whole passes over kPackets
+            std::printf("%-18s %12.0f %12.0f %7.2fx   %12.0f %12.0f %7.2fx%s\n", mix.label,
+                        kPackets * 1e9 / single, kPackets * 1e9 / multi, single / multi,
+                        kPackets * 1e9 / perPacket, kPackets * 1e9 / batched, perPacket / batched,
+                        same ? "" : "  MISMATCH");
+            if (!same) return false;
+        }
+    }
+    return true;
+}
+
+//––– Decrypt pool replay –––//
+
+/// Pre-encrypted packets of several streams pushed through a DecryptPool by one submitter
+/// thread per stream (like one notification thread per link), for 1, 2, 4 … workers;
+/// every stream checks that its plaintext comes back complete and in order
+void runReplay(const BenchOptions& opt) {
+    using clock = std::chrono::steady_clock;
+    const uint32_t streams = opt.devices ? opt.devices : 4;
+    const uint32_t maxWorkers = opt.workers ? opt.workers : std::max(1u, std::thread::hardware_concurrency());
+    const uint64_t perStream = std::max<uint64_t>(opt.replay / streams, 1);
+    constexpr uint32_t kDistinct = 256;
+    std::printf("Decrypt pool replay: %u streams × %llu packets of %u B, up to %u workers (%u cores)\n",
+                streams, static_cast<unsigned long long>(perStream), opt.wordSize, maxWorkers,
+                std::thread::hardware_concurrency());
+
+    for (uint8_t req : opt.requests) {
+        // packet i carries i % kDistinct in its first plaintext bytes
+        std::vector<std::vector<uint8_t>> packets(kDistinct);
+        std::vector<uint8_t> plain(std::max<uint32_t>(opt.wordSize, 4));
+        for (uint32_t i = 0; i < kDistinct; ++i) {
+            for (size_t b = 0; b < plain.size(); ++b) plain[b] = static_cast<uint8_t>(b * 13 + i);
+            std::memcpy(plain.data(), &i, sizeof(i));
+            packets[i] = SimPeripheral::encryptResponse(req, plain);
+        }
+
+        // single thread, no pool: the reference the speedups are measured against
+        CryptoEngine engine;
+        engine.init(req);
+        std::array<uint8_t, PacketRing::SLOT_BYTES> out{};
+        const uint64_t total = perStream * streams;
+        auto t0 = clock::now();
+        for (uint64_t i = 0; i < total; ++i) engine.decrypt(packets[i % kDistinct], out);
+        const double inlineS = std::chrono::duration<double>(clock::now() - t0).count();
+        std::printf("%-18s inline      %9.0f packets/s  %8.2f MB/s\n", requestName(req),
+                    total / inlineS, total * plain.size() / inlineS / 1e6);
+
+        std::vector<uint32_t> counts;
+        for (uint32_t w = 1; w < maxWorkers; w *= 2) counts.push_back(w);
+        counts.push_back(maxWorkers);
+        for (uint32_t w : counts) {
+            DecryptPool pool(w);
+            std::atomic<uint64_t> misordered{ 0 }, failed{ 0 };
+            std::vector<uint64_t> expected(streams, 0);
+            std::vector<DecryptPool::Stream*> handles;
+            for (uint32_t st = 0; st < streams; ++st) {
+                handles.push_back(pool.openStream(st, req, [&, st](const DecryptedPacket& p) {
+                    uint32_t tag = 0;
+                    if (!p.result || p.plain.size() < sizeof(tag)) { ++failed; return; }
+                    std::memcpy(&tag, p.plain.data(), sizeof(tag));
+                    if (p.seq != expected[st]++ || tag != p.seq % kDistinct) ++misordered;
+                }));
+            }
+            t0 = clock::now();
+            std::vector<std::thread> submitters;
+            for (uint32_t st = 0; st < streams; ++st) {
+                submitters.emplace_back([&, st]() {
+                    for (uint64_t i = 0; i < perStream; ++i) pool.submit(handles[st], i, packets[i % kDistinct], 0.0);
+                });
+            }
+            for (auto& t : submitters) t.join();
+            for (auto* h : handles) pool.drain(h);
+            const double s = std::chrono::duration<double>(clock::now() - t0).count();
+            auto ps = pool.stats();
+            std::printf("%-18s %2u workers  %9.0f packets/s  %8.2f MB/s  %5.2fx inline  held back %llu  stalls %llu  %s\n", "",
+                        w, total / s, total * plain.size() / s / 1e6, inlineS / s,
+                        static_cast<unsigned long long>(ps.heldBack), static_cast<unsigned long long>(ps.submitStalls),
+                        (misordered == 0 && failed == 0 && ps.delivered == total) ? "in order" : "OUT OF ORDER");
+            for (auto* h : handles) pool.closeStream(h);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    if (!parseArgs(argc, argv, opt)) {
+        printUsage();
+        return 1;
+    }
+    if (opt.advertFlood > 0) {
+        runAdvertFlood(opt);
+        return 0;
+    }
+    if (opt.replay > 0) {
+        runReplay(opt);
+        return 0;
+    }
+    if (opt.cryptoBench) {
+        runCryptoBench(opt);
+        return 0;
+    }
+    if (opt.chachaBench) {
+        return runChaChaBench() ? 0 : 1;
+    }
+    if (opt.polyBench) {
+        return runPolyBench() ? 0 : 1;
+    }
+    if (opt.aeadBench) {
+        return runAeadBench() ? 0 : 1;
+    }
+    if (opt.gcmBench) {
+        return runGcmBench() ? 0 : 1;
+    }
+    if (opt.mbBench) {
+        return runMultiBufferBench(opt) ? 0 : 1;
+    }
+    if (opt.crcBench) {
+        return runCrcBench() ? 0 : 1;
+    }
+
+    char pacing[48] = "adaptive pacing";
+    if (!opt.adaptive) std::snprintf(pacing, sizeof(pacing), "delay %.2f ms", opt.delayMs);
+    std::printf("Simulated P2P pipeline: %u B in %u B words, %s, window %u, link latency %.0f µs\n",
+                opt.bytes, opt.wordSize, pacing, opt.window, opt.sim.linkLatencyUs);
+    if (opt.sim.serviceBytesPerSec > 0 || opt.sim.mcuQueueDepth > 0) {
+        std::printf("Simulated MCU: service rate %.0f B/s, queue depth %u\n",
+                    opt.sim.serviceBytesPerSec, opt.sim.mcuQueueDepth);
+    }
+    if (opt.devices > 0) {
+        auto rack = makeRack(opt.devices);
+        auto transport = std::make_unique<SimTransport>(opt.sim, rack);
+        SimTransport& sim = *transport;
+        BleManager ble(std::move(transport));
+        for (uint8_t req : opt.requests) {
+            runSessions(ble, sim, opt, req, rack);
+        }
+        return 0;
+    }
+
+    // One transport for all runs, so reconnects reuse the GATT handle cache
+    BleManager ble(std::make_unique<SimTransport>(opt.sim));
+    std::vector<RunSummary> runs;
+    for (uint8_t req : opt.requests) {
+        runs.push_back(runPipeline(ble, opt, req));
+    }
+    printBaseline(runs);
+
+    auto st = ble.gattCacheStats();
+    std::printf("GATT cache: %u uncached / %u cached discoveries (%.2f / %.2f ms total), connect saved %.2f ms, "
+                "%llu chunk lookups avoided (~%.2f ms)\n",
+                st.uncachedDiscoveries, st.cachedDiscoveries, st.uncachedDiscoveryMs, st.cachedDiscoveryMs,
+                st.connectSavedMs(), static_cast<unsigned long long>(st.chunkLookupsAvoided), st.chunkSavedMs());
+    return 0;
+}
+
+//––– Allocation counting –––//
+// Replaces the global allocator for BleBench only, so the FE44 handlers can show that
+// steady-state packets don't touch the heap (AllocCounter stays inactive in the app).
+
+void* operator new(std::size_t size) {
+    AllocCounter::record();
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
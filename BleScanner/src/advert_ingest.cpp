@@ -0,0 +1,149 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "advert_ingest.h"
+#include <cstdio>
+
+namespace {
+    /// splitmix64 finalizer, spreads vendor-prefixed addresses over the table
+    inline uint64_t mix(uint64_t x) {
+        x ^= x >> 30; x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27; x *= 0x94D049BB133111EBull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    inline int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+//––– AdvertTable –––//
+
+AdvertTable::AdvertTable(size_t capacity) {
+    size_t slots = 16;
+    while (slots < capacity) slots <<= 1;
+    _slots.resize(slots);
+    _mask  = slots - 1;
+    _limit = slots / 2;
+}
+
+size_t AdvertTable::slotFor(uint64_t address) const {
+    size_t i = static_cast<size_t>(mix(address)) & _mask;
+    while (_slots[i].address != 0 && _slots[i].address != address) {
+        i = (i + 1) & _mask;
+    }
+    return i;
+}
+
+AdvertEntry* AdvertTable::upsert(uint64_t address) {
+    if (address == 0) return nullptr;
+    size_t i = slotFor(address);
+    AdvertEntry& e = _slots[i];
+    if (e.address == address) return &e;
+    if (_size >= _limit) return nullptr;
+    e = AdvertEntry{};
+    e.address = address;
+    ++_size;
+    return &e;
+}
+
+const AdvertEntry* AdvertTable::find(uint64_t address) const {
+    if (address == 0) return nullptr;
+    const AdvertEntry& e = _slots[slotFor(address)];
+    return (e.address == address) ? &e : nullptr;
+}
+
+void AdvertTable::clear() {
+    std::fill(_slots.begin(), _slots.end(), AdvertEntry{});
+    _size = 0;
+}
+
+//––– AdvertIngest –––//
+
+AdvertIngest::AdvertIngest(size_t capacity)
+    : _table(capacity) {
+}
+
+void AdvertIngest::reset(const std::vector<uint64_t>& allowList, double summaryIntervalMs) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _table.clear();
+    _stats = AdvertStats{};
+    _allowList = allowList;
+    for (uint64_t address : allowList) {
+        if (auto e = _table.upsert(address)) e->allowed = true;
+    }
+    _intervalNs = static_cast<int64_t>(summaryIntervalMs * 1e6);
+    _lastSummaryNs = nowNs();
+    _advertsAtSummary = 0;
+}
+
+bool AdvertIngest::ingest(const BleAdvertisement& adv) {
+    const int64_t now = nowNs();
+    std::string summary;
+    bool allowed = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_stats.adverts;
+        if (AdvertEntry* e = _table.upsert(adv.address)) {
+            e->rssiEwma = (e->count == 0) ? adv.rssi : e->rssiEwma + (adv.rssi - e->rssiEwma) / 8.0f;
+            e->lastSeenNs = now;
+            ++e->count;
+            allowed = e->allowed;
+            if (allowed) ++_stats.allowed;
+        } else {
+            ++_stats.untracked;
+        }
+        if (_intervalNs > 0 && now - _lastSummaryNs >= _intervalNs && _summaryCb) {
+            summary = summaryLocked(now);
+        }
+    }
+    if (!summary.empty()) _summaryCb(summary);
+    return allowed;
+}
+
+std::string AdvertIngest::summaryLocked(int64_t now) {
+    const double seconds = (now - _lastSummaryNs) / 1e9;
+    const uint64_t adverts = _stats.adverts - _advertsAtSummary;
+    _lastSummaryNs = now;
+    _advertsAtSummary = _stats.adverts;
+    ++_stats.summaries;
+
+    size_t allowedSeen = 0;
+    for (uint64_t address : _allowList) {
+        auto e = _table.find(address);
+        if (e && e->count) ++allowedSeen;
+    }
+
+    char buf[256];
+    int n = std::snprintf(buf, sizeof(buf), "Adverts: %llu in %.1f s (%.0f/s), %zu devices seen, %zu/%zu allow-listed seen",
+                          static_cast<unsigned long long>(adverts), seconds, seconds > 0 ? adverts / seconds : 0.0,
+                          _table.size() - (_allowList.size() - allowedSeen), allowedSeen, _allowList.size());
+    // RSSI of the first few allow-listed devices
+    size_t shown = 0;
+    for (uint64_t address : _allowList) {
+        auto e = _table.find(address);
+        if (!e || !e->count || shown == 4 || n <= 0 || n >= static_cast<int>(sizeof(buf))) continue;
+        n += std::snprintf(buf + n, sizeof(buf) - n, "%s %012llX %.1f dBm", shown ? "," : ";",
+                           static_cast<unsigned long long>(address), e->rssiEwma);
+        ++shown;
+    }
+    return buf;
+}
+
+AdvertStats AdvertIngest::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    AdvertStats st = _stats;
+    st.devices = _table.size();
+    return st;
+}
+
+bool AdvertIngest::lookup(uint64_t address, AdvertEntry& out) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto e = _table.find(address);
+    if (!e) return false;
+    out = *e;
+    return true;
+}
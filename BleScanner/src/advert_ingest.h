@@ -0,0 +1,98 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef ADVERT_INGEST_H
+#define ADVERT_INGEST_H
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ble_transport.h"
+
+/// One advertiser seen by the watcher
+struct AdvertEntry {
+    uint64_t address   = 0;       ///< 0 = empty slot
+    int64_t  lastSeenNs = 0;      ///< steady_clock time of the last advert
+    uint32_t count     = 0;       ///< adverts seen
+    float    rssiEwma  = 0.0f;    ///< smoothed RSSI, alpha 1/8
+    bool     allowed   = false;   ///< on the allow-list
+};
+
+/// Fixed-capacity open-addressing table (linear probing) keyed by BLE address.
+/// Never allocates after construction; once full, new addresses are not tracked.
+class AdvertTable {
+public:
+    /// @param capacity rounded up to a power of two, keep the load under ~50 %
+    explicit AdvertTable(size_t capacity = 16384);
+
+    /// Finds the address or claims a free slot for it
+    /// @return nullptr if the address is new and the table is at its entry limit
+    AdvertEntry* upsert(uint64_t address);
+    const AdvertEntry* find(uint64_t address) const;
+
+    void clear();
+    size_t size() const { return _size; }
+    size_t capacity() const { return _slots.size(); }
+    const std::vector<AdvertEntry>& slots() const { return _slots; }
+
+private:
+    size_t slotFor(uint64_t address) const;
+
+    std::vector<AdvertEntry> _slots;
+    size_t _mask  = 0;
+    size_t _size  = 0;
+    size_t _limit = 0;      ///< max entries (half the slots), keeps probe chains short
+};
+
+/// Counters of the advertisement ingestion path
+struct AdvertStats {
+    uint64_t adverts   = 0;       ///< everything the watcher delivered
+    uint64_t allowed   = 0;       ///< adverts from allow-listed addresses
+    uint64_t untracked = 0;       ///< adverts from new addresses while the table was full
+    size_t   devices   = 0;       ///< distinct addresses in the table (allow-list included)
+    uint32_t summaries = 0;       ///< summary lines emitted
+};
+
+/// Watcher-side fast path: every advert costs one table probe (which also answers the
+/// allow-list question) and an RSSI update; nothing is formatted per advert. A summary
+/// line is produced at most once per interval instead. ingest() is meant for the single
+/// watcher thread, stats()/lookup() may be called from anywhere.
+class AdvertIngest {
+public:
+    using SummaryCallback = std::function<void(const std::string&)>;
+
+    explicit AdvertIngest(size_t capacity = 16384);
+
+    /// Starts a new scan with the given allow-list
+    /// @param summaryIntervalMs min spacing of summary lines (0 = no summaries)
+    void reset(const std::vector<uint64_t>& allowList, double summaryIntervalMs = 1000.0);
+
+    void onSummary(SummaryCallback cb) { _summaryCb = std::move(cb); }
+
+    /// Records the advert
+    /// @return true if the address is on the allow-list
+    bool ingest(const BleAdvertisement& adv);
+
+    AdvertStats stats() const;
+    bool lookup(uint64_t address, AdvertEntry& out) const;
+
+private:
+    std::string summaryLocked(int64_t nowNs);
+
+    mutable std::mutex _mutex;
+    AdvertTable     _table;
+    AdvertStats     _stats{};
+    int64_t         _intervalNs    = 0;
+    int64_t         _lastSummaryNs = 0;
+    uint64_t        _advertsAtSummary = 0;
+    std::vector<uint64_t> _allowList;
+    SummaryCallback _summaryCb{};
+};
+
+#endif //ADVERT_INGEST_H
@@ -0,0 +1,37 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef AEAD_TAG_H
+#define AEAD_TAG_H
+#pragma once
+
+#include "poly1305_simd.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/// Tag handling shared by the AEAD decrypt paths (crypto, AES-GCM kernels, fused
+/// ChaCha20-Poly1305, keystream cache). Internal to the crypto layer.
+namespace AeadTag {
+
+/// Tag comparison that takes the same time wherever the first difference is
+inline bool equal(const uint8_t* a, const uint8_t* b, size_t len) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; ++i) diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+
+/// Closes a ChaCha20-Poly1305 MAC that has seen the ciphertext:
+/// ct || pad || le64(aad len = 0) || le64(ct len)
+inline void finishPoly1305(Poly1305::Mac& mac, size_t ctLen, uint8_t tag[16]) {
+    mac.padToBlock();
+    uint8_t lengths[16] = {};
+    for (int i = 0; i < 8; ++i) lengths[8 + i] = static_cast<uint8_t>(static_cast<uint64_t>(ctLen) >> (8 * i));
+    mac.update(lengths, sizeof(lengths));
+    mac.finish(tag);
+}
+
+} // namespace AeadTag
+
+#endif //AEAD_TAG_H
@@ -0,0 +1,917 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "aes_gcm_simd.h"
+#include "aead_tag.h"
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#if BLE_X86
+#include <immintrin.h>
+#endif
+
+namespace AesGcm {
+
+namespace {
+
+std::atomic<int> g_forced{ -1 };
+
+#if BLE_X86
+
+#define BLE_NI   "aes,pclmul,ssse3"
+#define BLE_VAES "vaes,vpclmulqdq,avx2,aes,pclmul,ssse3"
+
+//––– AES-NI / PCLMULQDQ helpers –––//
+
+BLE_TARGET(BLE_NI) inline __m128i bswap(__m128i x) {
+    return _mm_shuffle_epi8(x, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+BLE_TARGET(BLE_NI) inline __m128i load(const uint8_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+BLE_TARGET(BLE_NI) inline void store(uint8_t* p, __m128i v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+}
+
+/// R rounds: 14 for AES-256, 10 for AES-128 (round keys rk[0] … rk[R])
+template <int R>
+BLE_TARGET(BLE_NI) inline __m128i aesBlock(__m128i x, const __m128i rk[15]) {
+    x = _mm_xor_si128(x, rk[0]);
+    for (int r = 1; r < R; ++r) x = _mm_aesenc_si128(x, rk[r]);
+    return _mm_aesenclast_si128(x, rk[R]);
+}
+
+/// Counter block n (big-endian inc32 of J0) from the byte-reversed J0
+BLE_TARGET(BLE_NI) inline __m128i counter(__m128i j0r, uint32_t n) {
+    return bswap(_mm_add_epi32(j0r, _mm_setr_epi32(static_cast<int>(n), 0, 0, 0)));
+}
+
+/// Karatsuba partial products of x·h: lo, hi and (x.hi ^ x.lo)·(h.hi ^ h.lo)
+BLE_TARGET(BLE_NI) inline void mulAcc(__m128i x, __m128i h, __m128i hk, __m128i& lo, __m128i& mid, __m128i& hi) {
+    lo  = _mm_xor_si128(lo, _mm_clmulepi64_si128(x, h, 0x00));
+    hi  = _mm_xor_si128(hi, _mm_clmulepi64_si128(x, h, 0x11));
+    mid = _mm_xor_si128(mid, _mm_clmulepi64_si128(_mm_xor_si128(x, _mm_shuffle_epi32(x, 0x4E)), hk, 0x00));
+}
+
+/// Sum of Karatsuba partials → 256-bit product → reduced mod x^128 + x^7 + x^2 + x + 1
+/// (bit-reflected, Intel's shift-left-by-one form)
+BLE_TARGET(BLE_NI) inline __m128i reduce(__m128i lo, __m128i mid, __m128i hi) {
+    mid = _mm_xor_si128(mid, _mm_xor_si128(lo, hi));
+    __m128i t3 = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    __m128i t6 = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+    __m128i t7 = _mm_srli_epi32(t3, 31);
+    __m128i t8 = _mm_srli_epi32(t6, 31);
+    t3 = _mm_slli_epi32(t3, 1);
+    t6 = _mm_slli_epi32(t6, 1);
+    const __m128i t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    t3 = _mm_or_si128(t3, t7);
+    t6 = _mm_or_si128(_mm_or_si128(t6, t8), t9);
+
+    t7 = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(t3, 31), _mm_slli_epi32(t3, 30)), _mm_slli_epi32(t3, 25));
+    t8 = _mm_srli_si128(t7, 4);
+    t3 = _mm_xor_si128(t3, _mm_slli_si128(t7, 12));
+    __m128i t2 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(t3, 1), _mm_srli_epi32(t3, 2)), _mm_srli_epi32(t3, 7));
+    t2 = _mm_xor_si128(t2, t8);
+    t3 = _mm_xor_si128(t3, t2);
+    return _mm_xor_si128(t6, t3);
+}
+
+BLE_TARGET(BLE_NI) inline __m128i gmul(__m128i x, __m128i h, __m128i hk) {
+    __m128i lo = _mm_setzero_si128(), mid = lo, hi = lo;
+    mulAcc(x, h, hk, lo, mid, hi);
+    return reduce(lo, mid, hi);
+}
+
+/// k ^ k<<32 ^ k<<64 ^ k<<96, the key schedule's running xor of words
+BLE_TARGET(BLE_NI) inline __m128i spread(__m128i k) {
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    return _mm_xor_si128(k, _mm_slli_si128(k, 4));
+}
+
+/// Round keys (AES-256 for 32 key bytes, AES-128 for 16), then H = E(0) and its powers
+BLE_TARGET(BLE_NI) void niSetKey(const uint8_t* key, size_t keyBytes, uint8_t rkOut[15][16], uint8_t hOut[8][16],
+                                 uint8_t hkOut[8][16]) {
+    __m128i rk[15] = {};
+    __m128i a = load(key);
+    rk[0] = a;
+#define BLE_AES128_ROUND(i, rcon)                                                                        \
+    a = _mm_xor_si128(spread(a), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(a, rcon), 0xff));           \
+    rk[i] = a;
+    if (keyBytes == 16) {
+        BLE_AES128_ROUND(1, 0x01)
+        BLE_AES128_ROUND(2, 0x02)
+        BLE_AES128_ROUND(3, 0x04)
+        BLE_AES128_ROUND(4, 0x08)
+        BLE_AES128_ROUND(5, 0x10)
+        BLE_AES128_ROUND(6, 0x20)
+        BLE_AES128_ROUND(7, 0x40)
+        BLE_AES128_ROUND(8, 0x80)
+        BLE_AES128_ROUND(9, 0x1b)
+        BLE_AES128_ROUND(10, 0x36)
+    }
+#undef BLE_AES128_ROUND
+    __m128i b = keyBytes == 16 ? _mm_setzero_si128() : load(key + 16);
+    if (keyBytes != 16) rk[1] = b;
+#define BLE_AES256_ROUND(i, rcon)                                                                        \
+    a = _mm_xor_si128(spread(a), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(b, rcon), 0xff));           \
+    rk[i] = a;                                                                                           \
+    if (i + 1 < 15) {                                                                                    \
+        b = _mm_xor_si128(spread(b), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(a, 0x00), 0xaa));       \
+        rk[i + 1] = b;                                                                                   \
+    }
+    if (keyBytes != 16) {
+        BLE_AES256_ROUND(2, 0x01)
+        BLE_AES256_ROUND(4, 0x02)
+        BLE_AES256_ROUND(6, 0x04)
+        BLE_AES256_ROUND(8, 0x08)
+        BLE_AES256_ROUND(10, 0x10)
+        BLE_AES256_ROUND(12, 0x20)
+        BLE_AES256_ROUND(14, 0x40)
+    }
+#undef BLE_AES256_ROUND
+    for (int i = 0; i < 15; ++i) store(rkOut[i], rk[i]);
+
+    const __m128i h1 = bswap(keyBytes == 16 ? aesBlock<10>(_mm_setzero_si128(), rk)
+                                            : aesBlock<14>(_mm_setzero_si128(), rk));
+    const __m128i hk1 = _mm_xor_si128(h1, _mm_shuffle_epi32(h1, 0x4E));
+    __m128i h = h1;
+    for (int i = 0; i < 8; ++i) {
+        if (i > 0) h = gmul(h, h1, hk1);
+        store(hOut[i], h);
+        store(hkOut[i], _mm_xor_si128(h, _mm_shuffle_epi32(h, 0x4E)));
+    }
+}
+
+/// Single blocks (tail), the length block and the tag; y is the GHASH so far
+template <int R>
+BLE_TARGET(BLE_NI) bool niFinish(const __m128i rk[15], const __m128i h[8], const __m128i hk[8], __m128i j0r, __m128i y,
+                                 uint32_t block, const uint8_t* ct, size_t len, size_t off, const uint8_t tag[16],
+                                 uint8_t* out) {
+    for (; off + 16 <= len; off += 16, ++block) {
+        const __m128i c = load(ct + off);
+        y = gmul(_mm_xor_si128(y, bswap(c)), h[0], hk[0]);
+        store(out + off, _mm_xor_si128(c, aesBlock<R>(counter(j0r, block), rk)));
+    }
+    if (off < len) {
+        alignas(16) uint8_t buf[16] = {};
+        const size_t n = len - off;
+        std::memcpy(buf, ct + off, n);
+        const __m128i c = load(buf);
+        y = gmul(_mm_xor_si128(y, bswap(c)), h[0], hk[0]);
+        store(buf, _mm_xor_si128(c, aesBlock<R>(counter(j0r, block), rk)));
+        std::memcpy(out + off, buf, n);
+    }
+    // [be64 aad bits = 0][be64 ct bits]
+    const __m128i lengths = _mm_set_epi64x(0, static_cast<long long>(static_cast<uint64_t>(len) * 8));
+    y = gmul(_mm_xor_si128(y, lengths), h[0], hk[0]);
+
+    alignas(16) uint8_t computed[16];
+    store(computed, _mm_xor_si128(bswap(y), aesBlock<R>(counter(j0r, 0), rk)));
+    return AeadTag::equal(computed, tag, 16);
+}
+
+//––– AES-NI: 8 CTR blocks per step, stitched with GHASH of the same 8 ciphertext blocks –––//
+
+template <int R>
+BLE_TARGET(BLE_NI) bool niDecrypt(const uint8_t rkIn[15][16], const uint8_t hIn[8][16], const uint8_t hkIn[8][16],
+                                  const uint8_t iv[12], const uint8_t* ct, size_t len, const uint8_t tag[16],
+                                  uint8_t* out) {
+    __m128i rk[15], h[8], hk[8];
+    for (int i = 0; i < 15; ++i) rk[i] = load(rkIn[i]);
+    for (int i = 0; i < 8; ++i) { h[i] = load(hIn[i]); hk[i] = load(hkIn[i]); }
+
+    // J0 = IV || be32(1); data block n (from 0) is counter(j0r, n + 1)
+    alignas(16) uint8_t j0[16] = {};
+    std::memcpy(j0, iv, 12);
+    j0[15] = 1;
+    const __m128i j0r = bswap(load(j0));
+
+    __m128i y = _mm_setzero_si128();
+    uint32_t block = 1;
+    size_t off = 0;
+    for (; off + 128 <= len; off += 128, block += 8) {
+        __m128i x[8], c[8];
+        for (int k = 0; k < 8; ++k) {
+            x[k] = _mm_xor_si128(counter(j0r, block + k), rk[0]);
+            c[k] = load(ct + off + 16 * k);
+        }
+        // Y' = (Y ^ C0)·H^8 ^ C1·H^7 ^ … ^ C7·H, one product per AES round
+        __m128i lo = _mm_setzero_si128(), mid = lo, hi = lo;
+        for (int r = 1; r < R; ++r) {
+            for (int k = 0; k < 8; ++k) x[k] = _mm_aesenc_si128(x[k], rk[r]);
+            if (r <= 8) {
+                const int k = r - 1;
+                __m128i g = bswap(c[k]);
+                if (k == 0) g = _mm_xor_si128(g, y);
+                mulAcc(g, h[7 - k], hk[7 - k], lo, mid, hi);
+            }
+        }
+        for (int k = 0; k < 8; ++k) {
+            store(out + off + 16 * k, _mm_xor_si128(c[k], _mm_aesenclast_si128(x[k], rk[R])));
+        }
+        y = reduce(lo, mid, hi);
+    }
+    return niFinish<R>(rk, h, hk, j0r, y, block, ct, len, off, tag, out);
+}
+
+//––– VAES / VPCLMULQDQ: the same 8 blocks as 4 ymm registers of 2 blocks –––//
+
+/// Low ^ high 128-bit half
+BLE_TARGET(BLE_VAES) inline __m128i fold(__m256i v) {
+    return _mm_xor_si128(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+template <int R>
+BLE_TARGET(BLE_VAES) bool vaesDecrypt(const uint8_t rkIn[15][16], const uint8_t hIn[8][16], const uint8_t hkIn[8][16],
+                                      const uint8_t iv[12], const uint8_t* ct, size_t len, const uint8_t tag[16],
+                                      uint8_t* out) {
+    __m128i rk[15], h[8], hk[8];
+    __m256i rk2[15], hp[4], hkp[4];
+    for (int i = 0; i < 15; ++i) {
+        rk[i]  = load(rkIn[i]);
+        rk2[i] = _mm256_broadcastsi128_si256(rk[i]);
+    }
+    for (int i = 0; i < 8; ++i) { h[i] = load(hIn[i]); hk[i] = load(hkIn[i]); }
+    // pair p covers blocks 2p, 2p+1: powers H^(8-2p), H^(7-2p)
+    for (int p = 0; p < 4; ++p) {
+        hp[p]  = _mm256_set_m128i(h[6 - 2 * p], h[7 - 2 * p]);
+        hkp[p] = _mm256_set_m128i(hk[6 - 2 * p], hk[7 - 2 * p]);
+    }
+    const __m256i swap = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                          15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+    alignas(16) uint8_t j0[16] = {};
+    std::memcpy(j0, iv, 12);
+    j0[15] = 1;
+    const __m128i j0r = bswap(load(j0));
+
+    __m128i y = _mm_setzero_si128();
+    uint32_t block = 1;
+    size_t off = 0;
+    for (; off + 128 <= len; off += 128, block += 8) {
+        __m256i x[4], c[4];
+        for (int p = 0; p < 4; ++p) {
+            x[p] = _mm256_xor_si256(_mm256_set_m128i(counter(j0r, block + 2 * p + 1), counter(j0r, block + 2 * p)),
+                                    rk2[0]);
+            c[p] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ct + off + 32 * p));
+        }
+        __m256i lo = _mm256_setzero_si256(), mid = lo, hi = lo;
+        for (int r = 1; r < R; ++r) {
+            for (int p = 0; p < 4; ++p) x[p] = _mm256_aesenc_epi128(x[p], rk2[r]);
+            if (r <= 4) {
+                const int p = r - 1;
+                __m256i g = _mm256_shuffle_epi8(c[p], swap);
+                if (p == 0) g = _mm256_xor_si256(g, _mm256_set_m128i(_mm_setzero_si128(), y));
+                lo  = _mm256_xor_si256(lo, _mm256_clmulepi64_epi128(g, hp[p], 0x00));
+                hi  = _mm256_xor_si256(hi, _mm256_clmulepi64_epi128(g, hp[p], 0x11));
+                mid = _mm256_xor_si256(mid, _mm256_clmulepi64_epi128(
+                          _mm256_xor_si256(g, _mm256_shuffle_epi32(g, 0x4E)), hkp[p], 0x00));
+            }
+        }
+        for (int p = 0; p < 4; ++p) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + off + 32 * p),
+                                _mm256_xor_si256(c[p], _mm256_aesenclast_epi128(x[p], rk2[R])));
+        }
+        y = reduce(fold(lo), fold(mid), fold(hi));
+    }
+    return niFinish<R>(rk, h, hk, j0r, y, block, ct, len, off, tag, out);
+}
+
+//––– Fixed-IV pads: CTR keystream once, then GHASH + XOR per packet –––//
+
+template <int R>
+BLE_TARGET(BLE_NI) void niPads(const uint8_t rkIn[15][16], const uint8_t iv[12], uint8_t tagMask[16], uint8_t* pads,
+                               size_t len) {
+    __m128i rk[15];
+    for (int i = 0; i < 15; ++i) rk[i] = load(rkIn[i]);
+    alignas(16) uint8_t j0[16] = {};
+    std::memcpy(j0, iv, 12);
+    j0[15] = 1;
+    const __m128i j0r = bswap(load(j0));
+    store(tagMask, aesBlock<R>(counter(j0r, 0), rk));
+
+    uint32_t block = 1;
+    size_t off = 0;
+    for (; off + 128 <= len; off += 128, block += 8) {
+        __m128i x[8];
+        for (int k = 0; k < 8; ++k) x[k] = _mm_xor_si128(counter(j0r, block + k), rk[0]);
+        for (int r = 1; r < R; ++r) {
+            for (int k = 0; k < 8; ++k) x[k] = _mm_aesenc_si128(x[k], rk[r]);
+        }
+        for (int k = 0; k < 8; ++k) store(pads + off + 16 * k, _mm_aesenclast_si128(x[k], rk[R]));
+    }
+    for (; off < len; off += 16, ++block) {
+        alignas(16) uint8_t buf[16];
+        store(buf, aesBlock<R>(counter(j0r, block), rk));
+        std::memcpy(pads + off, buf, std::min<size_t>(16, len - off));
+    }
+}
+
+/// GHASH of ct and its length block, 8 blocks per reduction
+BLE_TARGET(BLE_NI) __m128i niGhash(const uint8_t hIn[8][16], const uint8_t hkIn[8][16], const uint8_t* ct, size_t len) {
+    __m128i h[8], hk[8];
+    for (int i = 0; i < 8; ++i) { h[i] = load(hIn[i]); hk[i] = load(hkIn[i]); }
+    __m128i y = _mm_setzero_si128();
+    size_t off = 0;
+    for (; off + 128 <= len; off += 128) {
+        __m128i lo = _mm_setzero_si128(), mid = lo, hi = lo;
+        for (int k = 0; k < 8; ++k) {
+            __m128i g = bswap(load(ct + off + 16 * k));
+            if (k == 0) g = _mm_xor_si128(g, y);
+            mulAcc(g, h[7 - k], hk[7 - k], lo, mid, hi);
+        }
+        y = reduce(lo, mid, hi);
+    }
+    // the last ≤ 8 blocks and the length block, aggregated as well: a short packet is mostly tail
+    __m128i g[9];
+    int m = 0;
+    for (; off < len; off += 16) {
+        alignas(16) uint8_t buf[16] = {};
+        std::memcpy(buf, ct + off, std::min<size_t>(16, len - off));
+        g[m++] = bswap(load(buf));
+    }
+    g[m++] = _mm_set_epi64x(0, static_cast<long long>(static_cast<uint64_t>(len) * 8));
+    int k = 0;
+    if (m > 8) y = gmul(_mm_xor_si128(y, g[k++]), h[0], hk[0]);
+    __m128i lo = _mm_setzero_si128(), mid = lo, hi = lo;
+    for (int i = k; i < m; ++i) {
+        const __m128i x = i == k ? _mm_xor_si128(g[i], y) : g[i];
+        mulAcc(x, h[m - 1 - i], hk[m - 1 - i], lo, mid, hi);
+    }
+    return reduce(lo, mid, hi);
+}
+
+BLE_TARGET(BLE_NI) bool niDecryptWithPads(const uint8_t hIn[8][16], const uint8_t hkIn[8][16], const uint8_t tagMask[16],
+                                          const uint8_t* pads, const uint8_t* ct, size_t len, const uint8_t tag[16],
+                                          uint8_t* out) {
+    alignas(16) uint8_t computed[16];
+    store(computed, _mm_xor_si128(bswap(niGhash(hIn, hkIn, ct, len)), load(tagMask)));
+    if (!AeadTag::equal(computed, tag, 16)) return false;
+    size_t off = 0;
+    for (; off + 16 <= len; off += 16) store(out + off, _mm_xor_si128(load(ct + off), load(pads + off)));
+    for (; off < len; ++off) out[off] = ct[off] ^ pads[off];
+    return true;
+}
+
+/// Tag only: E(J0) and GHASH, no CTR pass over the data
+template <int R>
+BLE_TARGET(BLE_NI) bool niVerify(const uint8_t rkIn[15][16], const uint8_t hIn[8][16], const uint8_t hkIn[8][16],
+                                 const uint8_t iv[12], const uint8_t* ct, size_t len, const uint8_t tag[16]) {
+    __m128i rk[15];
+    for (int i = 0; i < 15; ++i) rk[i] = load(rkIn[i]);
+    alignas(16) uint8_t j0[16] = {};
+    std::memcpy(j0, iv, 12);
+    j0[15] = 1;
+    alignas(16) uint8_t computed[16];
+    store(computed, _mm_xor_si128(bswap(niGhash(hIn, hkIn, ct, len)), aesBlock<R>(load(j0), rk)));
+    return AeadTag::equal(computed, tag, 16);
+}
+
+//––– Multi-packet lanes: one packet per lane, up to 4 blocks per lane and step –––//
+// Packets share the key and H but not their GHASH chains, so the lanes' AES rounds and
+// reductions are independent of each other and overlap instead of waiting on one chain.
+// A lane's first step puts J0 (for the tag) in slot 0 with a zero "ciphertext" block, so
+// the tag mask rides along with the data instead of costing its own AES pass.
+
+constexpr int kSlots = 4;           ///< blocks per lane and step
+
+/// A packet in flight; packet == nullptr is an idle lane
+struct Lane {
+    Packet*        packet = nullptr;
+    const uint8_t* ct = nullptr;
+    uint8_t*       out = nullptr;
+    size_t         left = 0;            ///< ciphertext bytes still to go
+    uint32_t       block = 0;           ///< counter of the step's slot 0
+    bool           first = true;        ///< slot 0 of the next step is J0
+    __m128i        j0r, y, ekj0;        ///< byte-reversed J0, GHASH so far, E(J0) for the tag
+    uint8_t        tag[16];
+};
+
+/// This step's ciphertext: l.ct itself when all slots are full data, otherwise buf with the
+/// data after the J0 slot and zero padding (GHASH pads with zeros)
+struct LaneStep {
+    const uint8_t* in;
+    size_t         n;                   ///< data bytes
+    int            slots;               ///< blocks to hash, 1 … kSlots
+};
+
+/// memcpy() of n < 64 bytes without the library call: overlapping 16/8/4-byte moves that
+/// stay inside [0, n) of both buffers
+BLE_TARGET(BLE_NI) inline void copySmall(uint8_t* dst, const uint8_t* src, size_t n) {
+    if (n >= 16) {
+        for (size_t i = 0; i + 16 <= n; i += 16) store(dst + i, load(src + i));
+        if (n % 16) store(dst + n - 16, load(src + n - 16));
+    } else if (n >= 8) {
+        uint64_t a, b;
+        std::memcpy(&a, src, 8);
+        std::memcpy(&b, src + n - 8, 8);
+        std::memcpy(dst, &a, 8);
+        std::memcpy(dst + n - 8, &b, 8);
+    } else if (n >= 4) {
+        uint32_t a, b;
+        std::memcpy(&a, src, 4);
+        std::memcpy(&b, src + n - 4, 4);
+        std::memcpy(dst, &a, 4);
+        std::memcpy(dst + n - 4, &b, 4);
+    } else {
+        for (size_t i = 0; i < n; ++i) dst[i] = src[i];
+    }
+}
+
+BLE_TARGET(BLE_NI) inline void laneStart(Lane& l, Packet& p) {
+    alignas(16) uint8_t j0[16] = {};
+    std::memcpy(j0, p.iv, 12);
+    j0[15] = 1;
+    l.packet = &p;
+    l.ct = p.ct;
+    l.out = p.out;
+    l.left = p.len;
+    l.block = 0;
+    l.first = true;
+    l.j0r = bswap(load(j0));
+    l.y = _mm_setzero_si128();
+    // in place the tag survives (it follows the ciphertext); keep a copy anyway
+    std::memcpy(l.tag, p.tag, sizeof(l.tag));
+}
+
+BLE_TARGET(BLE_NI) inline LaneStep laneLoad(const Lane& l, uint8_t buf[16 * kSlots]) {
+    const size_t skip = l.first ? 16 : 0;
+    LaneStep st;
+    st.n = std::min<size_t>(l.left, 16 * kSlots - skip);
+    st.slots = static_cast<int>((skip + st.n + 15) / 16);
+    if (st.n == 16 * kSlots) {
+        st.in = l.ct;
+    } else {
+        std::memset(buf, 0, 16 * kSlots);
+        copySmall(buf + skip, l.ct, st.n);
+        st.in = buf;
+    }
+    return st;
+}
+
+/// Length block, tag check, and the lane goes idle
+BLE_TARGET(BLE_NI) inline void laneFinish(Lane& l, __m128i h1, __m128i hk1) {
+    Packet& p = *l.packet;
+    const __m128i lengths = _mm_set_epi64x(0, static_cast<long long>(static_cast<uint64_t>(p.len) * 8));
+    const __m128i y = gmul(_mm_xor_si128(l.y, lengths), h1, hk1);
+    alignas(16) uint8_t computed[16];
+    store(computed, _mm_xor_si128(bswap(y), l.ekj0));
+    p.ok = AeadTag::equal(computed, l.tag, 16);
+    if (!p.ok && p.len > 0) std::memset(p.out, 0, p.len);
+    l.packet = nullptr;
+}
+
+/// Where this step's plaintext goes: straight to l.out for full data slots, else to buf
+BLE_TARGET(BLE_NI) inline uint8_t* laneOut(const Lane& l, const LaneStep& st, uint8_t buf[16 * kSlots]) {
+    return st.n == 16 * kSlots ? l.out : buf;
+}
+
+/// After the plaintext is written: copy it out of buf, keep E(J0) (slot 0 of the first step,
+/// 0 ^ E(J0)), move on and finish when the packet ran out
+BLE_TARGET(BLE_NI) inline void laneAdvance(Lane& l, const LaneStep& st, const uint8_t buf[16 * kSlots],
+                                           __m128i h1, __m128i hk1) {
+    if (st.n != 16 * kSlots) copySmall(l.out, buf + (l.first ? 16 : 0), st.n);
+    if (l.first) l.ekj0 = load(buf);
+    l.first = false;
+    l.ct += st.n; l.out += st.n; l.left -= st.n; l.block += st.slots;
+    if (l.left == 0) laneFinish(l, h1, hk1);
+}
+
+/// Fills idle lanes from the queue; packets over kLaneMaxBytes are left to the caller
+/// @return lanes busy afterwards
+template <size_t N>
+BLE_TARGET(BLE_NI) inline int laneRefill(Lane (&lanes)[N], Packet* packets, size_t count, size_t& next) {
+    int active = 0;
+    for (Lane& l : lanes) {
+        while (!l.packet && next < count) {
+            Packet& p = packets[next++];
+            if (p.len <= kLaneMaxBytes) laneStart(l, p);
+        }
+        active += l.packet != nullptr;
+    }
+    return active;
+}
+
+/// AES-NI: 2 lanes of 4 blocks, the same 8 AES blocks in flight as niDecrypt()
+template <int R>
+BLE_TARGET(BLE_NI) void niBatch(const uint8_t rkIn[15][16], const uint8_t hIn[8][16], const uint8_t hkIn[8][16],
+                                Packet* packets, size_t count) {
+    __m128i rk[15], h[kSlots], hk[kSlots];
+    for (int i = 0; i < 15; ++i) rk[i] = load(rkIn[i]);
+    for (int i = 0; i < kSlots; ++i) { h[i] = load(hIn[i]); hk[i] = load(hkIn[i]); }
+
+    constexpr int kLanes = 2;
+    Lane lanes[kLanes];
+    alignas(16) uint8_t bufs[kLanes][16 * kSlots];
+    size_t next = 0;
+    while (laneRefill(lanes, packets, count, next) > 0) {
+        __m128i x[kLanes][kSlots], c[kLanes][kSlots];
+        LaneStep st[kLanes] = {};
+        for (int k = 0; k < kLanes; ++k) {
+            Lane& l = lanes[k];
+            if (!l.packet) {
+                for (int j = 0; j < kSlots; ++j) x[k][j] = c[k][j] = _mm_setzero_si128();
+                continue;
+            }
+            st[k] = laneLoad(l, bufs[k]);
+            for (int j = 0; j < kSlots; ++j) {
+                x[k][j] = _mm_xor_si128(counter(l.j0r, l.block + j), rk[0]);
+                c[k][j] = load(st[k].in + 16 * j);
+            }
+        }
+        for (int r = 1; r < R; ++r) {
+            for (int k = 0; k < kLanes; ++k) {
+                for (int j = 0; j < kSlots; ++j) x[k][j] = _mm_aesenc_si128(x[k][j], rk[r]);
+            }
+            // Y' = (Y ^ C0)·H^t ^ C1·H^(t-1) ^ … ^ C(t-1)·H over the lane's t slots, one lane per round
+            if (r <= kLanes && lanes[r - 1].packet) {
+                Lane& l = lanes[r - 1];
+                const int t = st[r - 1].slots;
+                __m128i lo = _mm_setzero_si128(), mid = lo, hi = lo;
+                for (int j = 0; j < t; ++j) {
+                    __m128i g = bswap(c[r - 1][j]);
+                    if (j == 0) g = _mm_xor_si128(g, l.y);
+                    mulAcc(g, h[t - 1 - j], hk[t - 1 - j], lo, mid, hi);
+                }
+                l.y = reduce(lo, mid, hi);
+            }
+        }
+        for (int k = 0; k < kLanes; ++k) {
+            Lane& l = lanes[k];
+            if (!l.packet) continue;
+            uint8_t* dst = laneOut(l, st[k], bufs[k]);
+            for (int j = 0; j < kSlots; ++j) store(dst + 16 * j, _mm_xor_si128(c[k][j], _mm_aesenclast_si128(x[k][j], rk[R])));
+            laneAdvance(l, st[k], bufs[k], h[0], hk[0]);
+        }
+    }
+}
+
+/// VAES: 4 lanes of 4 blocks, a lane's blocks in two ymm registers
+template <int R>
+BLE_TARGET(BLE_VAES) void vaesBatch(const uint8_t rkIn[15][16], const uint8_t hIn[8][16], const uint8_t hkIn[8][16],
+                                    Packet* packets, size_t count) {
+    __m128i rk[15], h[kSlots], hk[kSlots];
+    __m256i rk2[15];
+    for (int i = 0; i < 15; ++i) {
+        rk[i]  = load(rkIn[i]);
+        rk2[i] = _mm256_broadcastsi128_si256(rk[i]);
+    }
+    for (int i = 0; i < kSlots; ++i) { h[i] = load(hIn[i]); hk[i] = load(hkIn[i]); }
+    // powers of the pair p (slots 2p, 2p+1) for t hashed slots: [H^(t-2p), H^(t-2p-1)], zero
+    // past the last slot (its zero padded block adds nothing either way)
+    __m256i hp[kSlots + 1][kSlots / 2], hkp[kSlots + 1][kSlots / 2];
+    auto power = [&](const __m128i* v, int e) { return e >= 1 ? v[e - 1] : _mm_setzero_si128(); };
+    for (int t = 1; t <= kSlots; ++t) {
+        for (int p = 0; p < kSlots / 2; ++p) {
+            hp[t][p]  = _mm256_set_m128i(power(h, t - 2 * p - 1), power(h, t - 2 * p));
+            hkp[t][p] = _mm256_set_m128i(power(hk, t - 2 * p - 1), power(hk, t - 2 * p));
+        }
+    }
+    const __m256i swap = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                          15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+    constexpr int kLanes = 4, kPairs = kSlots / 2;
+    Lane lanes[kLanes];
+    alignas(32) uint8_t bufs[kLanes][16 * kSlots];
+    size_t next = 0;
+    while (laneRefill(lanes, packets, count, next) > 0) {
+        __m256i x[kLanes][kPairs], c[kLanes][kPairs];
+        LaneStep st[kLanes] = {};
+        for (int k = 0; k < kLanes; ++k) {
+            Lane& l = lanes[k];
+            if (!l.packet) {
+                for (int p = 0; p < kPairs; ++p) x[k][p] = c[k][p] = _mm256_setzero_si256();
+                continue;
+            }
+            st[k] = laneLoad(l, bufs[k]);
+            for (int p = 0; p < kPairs; ++p) {
+                x[k][p] = _mm256_xor_si256(_mm256_set_m128i(counter(l.j0r, l.block + 2 * p + 1),
+                                                            counter(l.j0r, l.block + 2 * p)), rk2[0]);
+                c[k][p] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(st[k].in + 32 * p));
+            }
+        }
+        for (int r = 1; r < R; ++r) {
+            for (int k = 0; k < kLanes; ++k) {
+                for (int p = 0; p < kPairs; ++p) x[k][p] = _mm256_aesenc_epi128(x[k][p], rk2[r]);
+            }
+            if (r <= kLanes && lanes[r - 1].packet) {
+                Lane& l = lanes[r - 1];
+                const int t = st[r - 1].slots;
+                __m256i lo = _mm256_setzero_si256(), mid = lo, hi = lo;
+                for (int p = 0; p < kPairs; ++p) {
+                    __m256i g = _mm256_shuffle_epi8(c[r - 1][p], swap);
+                    if (p == 0) g = _mm256_xor_si256(g, _mm256_set_m128i(_mm_setzero_si128(), l.y));
+                    lo  = _mm256_xor_si256(lo, _mm256_clmulepi64_epi128(g, hp[t][p], 0x00));
+                    hi  = _mm256_xor_si256(hi, _mm256_clmulepi64_epi128(g, hp[t][p], 0x11));
+                    mid = _mm256_xor_si256(mid, _mm256_clmulepi64_epi128(
+                              _mm256_xor_si256(g, _mm256_shuffle_epi32(g, 0x4E)), hkp[t][p], 0x00));
+                }
+                l.y = reduce(fold(lo), fold(mid), fold(hi));
+            }
+        }
+        for (int k = 0; k < kLanes; ++k) {
+            Lane& l = lanes[k];
+            if (!l.packet) continue;
+            uint8_t* dst = laneOut(l, st[k], bufs[k]);
+            for (int p = 0; p < kPairs; ++p) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32 * p),
+                                    _mm256_xor_si256(c[k][p], _mm256_aesenclast_epi128(x[k][p], rk2[R])));
+            }
+            laneAdvance(l, st[k], bufs[k], h[0], hk[0]);
+        }
+    }
+}
+
+#endif // BLE_X86
+
+} // namespace
+
+const char* kernelName(Kernel kernel) {
+    switch (kernel) {
+      case Kernel::Scalar: return "mbedTLS";
+      case Kernel::AesNi:  return "AES-NI";
+      case Kernel::Vaes:   return "VAES";
+    }
+    return "?";
+}
+
+bool kernelSupported(Kernel kernel) {
+    const CpuFeatures& f = cpuFeatures();
+    switch (kernel) {
+      case Kernel::Scalar: return true;
+      case Kernel::AesNi:  return BLE_X86 && f.aesni && f.pclmul && f.ssse3;
+      case Kernel::Vaes:   return BLE_X86 && f.aesni && f.pclmul && f.ssse3 && f.vaes && f.vpclmulqdq;
+    }
+    return false;
+}
+
+Kernel bestKernel() {
+    static const Kernel best = kernelSupported(Kernel::Vaes)  ? Kernel::Vaes
+                             : kernelSupported(Kernel::AesNi) ? Kernel::AesNi : Kernel::Scalar;
+    return best;
+}
+
+Kernel activeKernel() {
+    const int forced = g_forced.load(std::memory_order_relaxed);
+    return forced < 0 ? bestKernel() : static_cast<Kernel>(forced);
+}
+
+void forceKernel(Kernel kernel) {
+    g_forced.store(static_cast<int>(kernelSupported(kernel) ? kernel : Kernel::Scalar), std::memory_order_relaxed);
+}
+
+void resetKernel() {
+    g_forced.store(-1, std::memory_order_relaxed);
+}
+
+Key::Key() {
+    mbedtls_gcm_init(&_ctx);
+}
+
+Key::~Key() {
+    mbedtls_gcm_free(&_ctx);
+}
+
+bool Key::setKey(const uint8_t* key, size_t keyBytes) {
+    if (keyBytes != 16 && keyBytes != 32) return false;
+    // also builds the mbedTLS GHASH table
+    if (mbedtls_gcm_setkey(&_ctx, MBEDTLS_CIPHER_ID_AES, key, static_cast<unsigned>(keyBytes * 8)) != 0) return false;
+    _rounds = keyBytes == 16 ? 10 : 14;
+#if BLE_X86
+    if (kernelSupported(Kernel::AesNi)) niSetKey(key, keyBytes, _rk, _h, _hk);
+#endif
+    return true;
+}
+
+bool decrypt(Kernel kernel, Key& key, const uint8_t iv[12], const uint8_t* ct, size_t len,
+             const uint8_t tag[16], uint8_t* out) {
+    if (!kernelSupported(kernel)) kernel = Kernel::Scalar;
+    // the tag follows the ciphertext, so in place it survives; keep a copy anyway
+    uint8_t expected[16];
+    std::memcpy(expected, tag, sizeof(expected));
+    bool ok = false;
+    switch (kernel) {
+#if BLE_X86
+      case Kernel::Vaes:
+        ok = key._rounds == 10 ? vaesDecrypt<10>(key._rk, key._h, key._hk, iv, ct, len, expected, out)
+                               : vaesDecrypt<14>(key._rk, key._h, key._hk, iv, ct, len, expected, out);
+        break;
+      case Kernel::AesNi:
+        ok = key._rounds == 10 ? niDecrypt<10>(key._rk, key._h, key._hk, iv, ct, len, expected, out)
+                               : niDecrypt<14>(key._rk, key._h, key._hk, iv, ct, len, expected, out);
+        break;
+#endif
+      default:
+        ok = mbedtls_gcm_auth_decrypt(&key._ctx, len, iv, 12, nullptr, 0, expected, 16, ct, out) == 0;
+        break;
+    }
+    if (!ok && len > 0) std::memset(out, 0, len);
+    return ok;
+}
+
+bool decrypt(Key& key, const uint8_t iv[12], const uint8_t* ct, size_t len, const uint8_t tag[16], uint8_t* out) {
+    return decrypt(activeKernel(), key, iv, ct, len, tag, out);
+}
+
+void decryptBatch(Kernel kernel, Key& key, Packet* packets, size_t count) {
+    if (!kernelSupported(kernel)) kernel = Kernel::Scalar;
+#if BLE_X86
+    if (kernel != Kernel::Scalar) {
+        // short packets side by side in the lanes, long ones fill the single-packet kernel
+        if (kernel == Kernel::Vaes && key._rounds == 10) vaesBatch<10>(key._rk, key._h, key._hk, packets, count);
+        else if (kernel == Kernel::Vaes)                 vaesBatch<14>(key._rk, key._h, key._hk, packets, count);
+        else if (key._rounds == 10)                      niBatch<10>(key._rk, key._h, key._hk, packets, count);
+        else                                             niBatch<14>(key._rk, key._h, key._hk, packets, count);
+        for (size_t i = 0; i < count; ++i) {
+            Packet& p = packets[i];
+            if (p.len > kLaneMaxBytes) p.ok = decrypt(kernel, key, p.iv, p.ct, p.len, p.tag, p.out);
+        }
+        return;
+    }
+#endif
+    for (size_t i = 0; i < count; ++i) {
+        Packet& p = packets[i];
+        p.ok = decrypt(kernel, key, p.iv, p.ct, p.len, p.tag, p.out);
+    }
+}
+
+void decryptBatch(Key& key, Packet* packets, size_t count) {
+    decryptBatch(activeKernel(), key, packets, count);
+}
+
+bool verify(Kernel kernel, Key& key, const uint8_t iv[12], const uint8_t* ct, size_t len, const uint8_t tag[16]) {
+    if (!kernelSupported(kernel)) kernel = Kernel::Scalar;
+#if BLE_X86
+    // GHASH is the same with VAES, the one AES block doesn't need it
+    if (kernel != Kernel::Scalar) {
+        return key._rounds == 10 ? niVerify<10>(key._rk, key._h, key._hk, iv, ct, len, tag)
+                                 : niVerify<14>(key._rk, key._h, key._hk, iv, ct, len, tag);
+    }
+#endif
+    // mbedTLS has no tag-only call: stream the plaintext into a scratch block and drop it
+    if (mbedtls_gcm_starts(&key._ctx, MBEDTLS_GCM_DECRYPT, iv, 12) != 0) return false;
+    uint8_t scratch[256 + 16];
+    size_t olen = 0;
+    bool ok = true;
+    for (size_t off = 0; off < len && ok; off += 256) {
+        ok = mbedtls_gcm_update(&key._ctx, ct + off, std::min<size_t>(256, len - off), scratch, sizeof(scratch),
+                                &olen) == 0;
+    }
+    uint8_t computed[16];
+    ok = ok && mbedtls_gcm_finish(&key._ctx, scratch, sizeof(scratch), &olen, computed, sizeof(computed)) == 0;
+    std::memset(scratch, 0, sizeof(scratch));
+    return ok && AeadTag::equal(computed, tag, 16);
+}
+
+bool verify(Key& key, const uint8_t iv[12], const uint8_t* ct, size_t len, const uint8_t tag[16]) {
+    return verify(activeKernel(), key, iv, ct, len, tag);
+}
+
+bool padsSupported() {
+    return kernelSupported(Kernel::AesNi);
+}
+
+bool makePads(Key& key, const uint8_t iv[12], uint8_t tagMask[16], uint8_t* pads, size_t len) {
+#if BLE_X86
+    if (padsSupported()) {
+        if (key._rounds == 10) niPads<10>(key._rk, iv, tagMask, pads, len);
+        else                   niPads<14>(key._rk, iv, tagMask, pads, len);
+        return true;
+    }
+#endif
+    (void)key; (void)iv; (void)tagMask; (void)pads; (void)len;
+    return false;
+}
+
+bool decryptWithPads(Key& key, const uint8_t tagMask[16], const uint8_t* pads, const uint8_t* ct, size_t len,
+                     const uint8_t tag[16], uint8_t* out) {
+    bool ok = false;
+#if BLE_X86
+    // the tag is checked before out is written
+    if (padsSupported()) ok = niDecryptWithPads(key._h, key._hk, tagMask, pads, ct, len, tag, out);
+#endif
+    (void)key; (void)tagMask; (void)pads; (void)ct; (void)tag;
+    if (!ok && len > 0) std::memset(out, 0, len);
+    return ok;
+}
+
+namespace {
+
+/// selfTest() under one random key of keyBytes
+bool selfTestKey(size_t keyBytes) {
+    uint32_t seed = 0x13579bdf;
+    auto next = [&seed]() { return static_cast<uint8_t>((seed = seed * 1664525 + 1013904223) >> 24); };
+    uint8_t k[32], iv[12];
+    for (auto& b : k) b = next();
+    for (auto& b : iv) b = next();
+    Key key;
+    if (!key.setKey(k, keyBytes)) return false;
+    mbedtls_gcm_context enc;
+    mbedtls_gcm_init(&enc);
+    mbedtls_gcm_setkey(&enc, MBEDTLS_CIPHER_ID_AES, k, static_cast<unsigned>(keyBytes * 8));
+
+    constexpr size_t kMax = 3072;
+    std::vector<uint8_t> plain(kMax), ct(kMax), out(kMax);
+    for (auto& b : plain) b = next();
+    bool ok = true;
+    for (size_t len = 0; len <= kMax && ok; len += (len < 400 ? 1 : 29)) {
+        uint8_t tag[16];
+        mbedtls_gcm_crypt_and_tag(&enc, MBEDTLS_GCM_ENCRYPT, len, iv, 12, nullptr, 0, plain.data(), ct.data(),
+                                  16, tag);
+        for (Kernel kernel : { Kernel::Scalar, Kernel::AesNi, Kernel::Vaes }) {
+            if (!kernelSupported(kernel)) continue;
+            if (!decrypt(kernel, key, iv, ct.data(), len, tag, out.data()) ||
+                !std::equal(plain.begin(), plain.begin() + len, out.begin())) { ok = false; break; }
+
+            std::vector<uint8_t> inPlace(ct.begin(), ct.begin() + len);
+            if (!decrypt(kernel, key, iv, inPlace.data(), len, tag, inPlace.data()) ||
+                !std::equal(plain.begin(), plain.begin() + len, inPlace.begin())) { ok = false; break; }
+
+            if (!verify(kernel, key, iv, ct.data(), len, tag)) { ok = false; break; }
+
+            tag[len % 16] ^= 0x01;
+            const bool forged = decrypt(kernel, key, iv, ct.data(), len, tag, out.data()) ||
+                                verify(kernel, key, iv, ct.data(), len, tag);
+            tag[len % 16] ^= 0x01;
+            if (forged || std::any_of(out.begin(), out.begin() + len, [](uint8_t b) { return b != 0; })) {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    // batches: ragged packets (a few empty or long) with their own IVs, every 7th forged;
+    // separate output and in place
+    constexpr size_t kPackets = 41;
+    std::vector<std::vector<uint8_t>> ivs(kPackets, std::vector<uint8_t>(12)), cts(kPackets), bufs(kPackets);
+    std::vector<std::array<uint8_t, 16>> tags(kPackets);
+    std::vector<Packet> packets(kPackets);
+    for (size_t i = 0; i < kPackets && ok; ++i) {
+        for (auto& b : ivs[i]) b = next();
+        const size_t len = i % 10 == 0 ? 0 : i % 9 == 0 ? 600 + next() * 3 : next() + next() % 2;
+        cts[i].resize(len);
+        mbedtls_gcm_crypt_and_tag(&enc, MBEDTLS_GCM_ENCRYPT, len, ivs[i].data(), 12, nullptr, 0, plain.data(),
+                                  cts[i].data(), 16, tags[i].data());
+        if (i % 7 == 3) tags[i][i % 16] ^= 0x01;
+    }
+    for (Kernel kernel : { Kernel::Scalar, Kernel::AesNi, Kernel::Vaes }) {
+        if (!kernelSupported(kernel)) continue;
+        for (int inPlace = 0; inPlace < 2 && ok; ++inPlace) {
+            for (size_t i = 0; i < kPackets; ++i) {
+                const size_t len = cts[i].size();
+                bufs[i].assign(2 * len, 0xA5);
+                std::copy(cts[i].begin(), cts[i].end(), bufs[i].begin());
+                packets[i] = { ivs[i].data(), bufs[i].data(), len, tags[i].data(),
+                               bufs[i].data() + (inPlace ? 0 : len) };
+            }
+            decryptBatch(kernel, key, packets.data(), kPackets);
+            for (size_t i = 0; i < kPackets && ok; ++i) {
+                const bool forged = i % 7 == 3;
+                const uint8_t* out = packets[i].out;
+                ok = packets[i].ok != forged &&
+                     (forged ? std::all_of(out, out + cts[i].size(), [](uint8_t b) { return b == 0; })
+                             : std::equal(out, out + cts[i].size(), plain.begin()));
+            }
+        }
+    }
+
+    // pads of one IV, then every length through decryptWithPads()
+    if (ok && padsSupported()) {
+        uint8_t tagMask[16];
+        std::vector<uint8_t> pads(kMax);
+        ok = makePads(key, iv, tagMask, pads.data(), pads.size());
+        for (size_t len = 0; len <= kMax && ok; len += (len < 400 ? 1 : 29)) {
+            uint8_t tag[16];
+            mbedtls_gcm_crypt_and_tag(&enc, MBEDTLS_GCM_ENCRYPT, len, iv, 12, nullptr, 0, plain.data(), ct.data(),
+                                      16, tag);
+            std::vector<uint8_t> inPlace(ct.begin(), ct.begin() + len);
+            ok = decryptWithPads(key, tagMask, pads.data(), inPlace.data(), len, tag, inPlace.data()) &&
+                 std::equal(plain.begin(), plain.begin() + len, inPlace.begin());
+            tag[len % 16] ^= 0x01;
+            ok = ok && !decryptWithPads(key, tagMask, pads.data(), ct.data(), len, tag, out.data()) &&
+                 std::all_of(out.begin(), out.begin() + len, [](uint8_t b) { return b == 0; });
+        }
+    }
+    mbedtls_gcm_free(&enc);
+    return ok;
+}
+
+} // namespace
+
+bool selfTest() {
+    return mbedtls_gcm_self_test(0) == 0 && selfTestKey(32) && selfTestKey(16);
+}
+
+} // namespace AesGcm
@@ -0,0 +1,119 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef AES_GCM_SIMD_H
+#define AES_GCM_SIMD_H
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mbedtls/gcm.h>
+
+/// AES-GCM decryption (256- or 128-bit key, 96-bit IV, no AAD) in the project's crypto layer. The AES-NI
+/// kernel runs 8 CTR blocks per step stitched with an 8-block aggregated GHASH (PCLMULQDQ,
+/// Karatsuba, one reduction per 8 blocks); the VAES kernel does the same 2 blocks per ymm
+/// register with VAES/VPCLMULQDQ. The Scalar kernel is mbedtls_gcm_auth_decrypt(). Picked at
+/// runtime from cpuFeatures(); the vendored mbedTLS stays untouched.
+namespace AesGcm {
+
+enum class Kernel : uint8_t { Scalar, AesNi, Vaes };
+
+const char* kernelName(Kernel kernel);
+bool kernelSupported(Kernel kernel);
+
+/// Best kernel of this CPU
+Kernel bestKernel();
+
+/// Kernel decrypt() uses: bestKernel() unless forced
+Kernel activeKernel();
+
+/// Forces a kernel (benchmarks, cross-checks); an unsupported one means Scalar
+void forceKernel(Kernel kernel);
+void resetKernel();
+
+/// One packet of decryptBatch()
+struct Packet {
+    const uint8_t* iv;          ///< 12 bytes
+    const uint8_t* ct;
+    size_t         len;
+    const uint8_t* tag;         ///< 16 bytes
+    uint8_t*       out;         ///< may equal ct
+    bool           ok = false;  ///< tag matched; on a mismatch out is zeroed
+};
+
+/// Packets longer than this skip the lanes: the single-packet kernel's 8-block steps with one
+/// reduction each are cheaper for them
+constexpr size_t kLaneMaxBytes = 256;
+
+/// Expanded AES-256 / AES-128 key with the GHASH key powers H^1 … H^8, plus the mbedTLS context
+class Key {
+public:
+    Key();
+    ~Key();
+    Key(const Key&) = delete;
+    Key& operator=(const Key&) = delete;
+
+    /// @param keyBytes  32 for AES-256, 16 for AES-128
+    /// @return false when mbedTLS rejects the key
+    bool setKey(const uint8_t* key, size_t keyBytes = 32);
+
+private:
+    friend bool decrypt(Kernel, Key&, const uint8_t*, const uint8_t*, size_t, const uint8_t*, uint8_t*);
+    friend void decryptBatch(Kernel, Key&, Packet*, size_t);
+    friend bool verify(Kernel, Key&, const uint8_t*, const uint8_t*, size_t, const uint8_t*);
+    friend bool makePads(Key&, const uint8_t*, uint8_t*, uint8_t*, size_t);
+    friend bool decryptWithPads(Key&, const uint8_t*, const uint8_t*, const uint8_t*, size_t, const uint8_t*, uint8_t*);
+
+    mbedtls_gcm_context _ctx;           ///< Scalar kernel
+    alignas(16) uint8_t _rk[15][16]{};  ///< round keys, 15 for AES-256 and 11 for AES-128
+    int                 _rounds = 14;   ///< 14 for AES-256, 10 for AES-128
+    alignas(16) uint8_t _h[8][16]{};    ///< H^1 … H^8, byte-reversed for PCLMULQDQ
+    alignas(16) uint8_t _hk[8][16]{};   ///< hi ^ lo half of each power (Karatsuba), low 64 bits
+};
+
+/// Checks tag and decrypts ct into out (out may equal ct). On a tag mismatch out is zeroed.
+/// @return true when the tag matched
+bool decrypt(Kernel kernel, Key& key, const uint8_t iv[12], const uint8_t* ct, size_t len,
+             const uint8_t tag[16], uint8_t* out);
+bool decrypt(Key& key, const uint8_t iv[12], const uint8_t* ct, size_t len, const uint8_t tag[16],
+             uint8_t* out);
+
+/// Checks the tag without producing plaintext: GHASH and E(J0) only with AES-NI / VAES, the
+/// Scalar kernel decrypts into a scratch block it throws away
+/// @return true when the tag matched
+bool verify(Kernel kernel, Key& key, const uint8_t iv[12], const uint8_t* ct, size_t len, const uint8_t tag[16]);
+bool verify(Key& key, const uint8_t iv[12], const uint8_t* ct, size_t len, const uint8_t tag[16]);
+
+/// decrypt() of independent packets under one key, interleaved: the AES-NI kernel keeps 2
+/// packets in flight and the VAES kernel 4, 4 blocks each per step with one GHASH reduction,
+/// so one packet's AES rounds and reductions overlap the others' instead of waiting on its
+/// own chain. E(J0) for the tag rides in the first step's spare slot. A finished lane is
+/// refilled from the queue; packets over kLaneMaxBytes and the Scalar kernel go one by one.
+/// Packets must not overlap each other.
+void decryptBatch(Kernel kernel, Key& key, Packet* packets, size_t count);
+void decryptBatch(Key& key, Packet* packets, size_t count);
+
+/// Whether makePads() / decryptWithPads() work on this CPU (they need AES-NI and PCLMULQDQ)
+bool padsSupported();
+
+/// The CTR keystream of a fixed IV: tagMask = E(J0), pads = E(J0 + 1) … for len bytes. Every
+/// packet under this key and IV uses the same pads, so they can be computed once.
+/// @return false when !padsSupported()
+bool makePads(Key& key, const uint8_t iv[12], uint8_t tagMask[16], uint8_t* pads, size_t len);
+
+/// decrypt() with pads from makePads() (len ≤ their length): GHASH, tag check, then XOR
+/// (out may equal ct). On a tag mismatch out is zeroed.
+/// @return true when the tag matched; false as well when !padsSupported()
+bool decryptWithPads(Key& key, const uint8_t tagMask[16], const uint8_t* pads, const uint8_t* ct, size_t len,
+                     const uint8_t tag[16], uint8_t* out);
+
+/// mbedtls_gcm_self_test() (the NIST GCM vectors) for the reference, then every supported
+/// kernel against it with an AES-256 and an AES-128 key for 0 … 3 kB, in place and with forged tags (verify() too), decryptBatch() on
+/// ragged packets with different IVs, some forged, and decryptWithPads()
+/// @return false on the first mismatch
+bool selfTest();
+
+} // namespace AesGcm
+
+#endif //AES_GCM_SIMD_H
@@ -0,0 +1,25 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "alloc_counter.h"
+#include <atomic>
+
+namespace {
+    thread_local uint64_t  t_allocations = 0;
+    std::atomic<bool>      g_active{ false };
+}
+
+void AllocCounter::record() noexcept {
+    if (t_allocations++ == 0 && !g_active.load(std::memory_order_relaxed)) {
+        g_active.store(true, std::memory_order_relaxed);
+    }
+}
+
+uint64_t AllocCounter::thread() noexcept {
+    return t_allocations;
+}
+
+bool AllocCounter::active() noexcept {
+    return g_active.load(std::memory_order_relaxed);
+}
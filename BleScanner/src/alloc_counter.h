@@ -0,0 +1,25 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+#pragma once
+
+#include <cstdint>
+
+/// Per-thread heap allocation counter. The counts only move in binaries that replace the
+/// global operator new with one calling record() (BleBench does); elsewhere they stay 0
+/// and active() is false.
+namespace AllocCounter {
+    /// Called by a counting operator new
+    void record() noexcept;
+
+    /// Allocations made by the calling thread so far
+    uint64_t thread() noexcept;
+
+    /// true once record() was called anywhere in the process
+    bool active() noexcept;
+}
+
+#endif //ALLOC_COUNTER_H
@@ -3,26 +3,25 @@
 //
 #include "ble_manager.h"
 #include "constants.h"
-#include <winrt/Windows.Devices.Radios.h>
-#include <winrt/Windows.Storage.Streams.h>
-#include <winrt/base.h>
-#include <windows.h>
-#include <sstream>
+#include <algorithm>
 #include <chrono>
-#include <winrt/Windows.Foundation.Collections.h>
+#include <cstdio>
 
-using namespace winrt;
-using namespace Windows::Devices::Bluetooth;
-using namespace Windows::Devices::Bluetooth::Advertisement;
-using namespace Windows::Devices::Bluetooth::GenericAttributeProfile;
-using namespace Windows::Storage::Streams;
-using namespace Windows::Devices::Radios;
-using namespace Windows::Foundation::Collections;
-
-BleManager::BleManager() = default;
+BleManager::BleManager(std::unique_ptr<BleTransport> transport)
+    : _transport(std::move(transport)) {
+}
 
 BleManager::~BleManager() {
     stopScan();
+    if (_scanThread.joinable()) _scanThread.join();
+}
+
+void BleManager::setTransport(std::unique_ptr<BleTransport> transport) {
+    if (_running || _active) return;
+    if (_scanThread.joinable()) _scanThread.join();
+    _sessions.clear();
+    _byAddress.clear();
+    _transport = std::move(transport);
 }
 
 void BleManager::onLog(std::function<void(const std::string&)> cb) {
@@ -31,258 +30,302 @@ void BleManager::onLog(std::function<void(const std::string&)> cb) {
 void BleManager::onStateChanged(std::function<void(AppState)> cb) {
     _stateCb = std::move(cb);
 }
-void BleManager::onData(std::function<void(const std::vector<uint8_t>&, double)> cb) {
+void BleManager::onData(std::function<void(const PacketView&)> cb) {
     _dataCb = std::move(cb);
 }
+void BleManager::onDeviceData(std::function<void(uint64_t, std::span<const uint8_t>, double)> cb) {
+    _deviceDataCb = std::move(cb);
+}
 void BleManager::onCipherTime(std::function<void(double, int)> cb) {
     _cipherCb = std::move(cb);
 }
 
-void BleManager::startScan(uint64_t address, uint8_t requestType, uint32_t bytesToRequest, uint32_t wordSize, double interChunkDelayMs) {
-    if (_running) return;
+void BleManager::startScan(uint64_t address, uint8_t requestType, uint32_t bytesToRequest, uint32_t wordSize, double interChunkDelayMs,
+                           uint32_t window, bool adaptivePacing, bool sequenceIds) {
+    SessionConfig cfg;
+    cfg.requestType       = requestType;
+    cfg.bytesToRequest    = bytesToRequest;
+    cfg.wordSize          = wordSize;
+    cfg.interChunkDelayMs = interChunkDelayMs;
+    cfg.window            = (window < 1) ? 1 : window;
+    cfg.adaptivePacing    = adaptivePacing;
+    cfg.sequenceIds       = sequenceIds;
+    startSessions({ address }, cfg);
+}
+
+void BleManager::startSessions(const std::vector<uint64_t>& addresses, const SessionConfig& cfg) {
+    if (_running || _active || addresses.empty()) return;
     // Clean up any previous thread
     if (_scanThread.joinable()) _scanThread.join();
 
-    _requestType = requestType;
-    _bytesToRequest = bytesToRequest;
-    _interChunkDelayMs = interChunkDelayMs;
-    _wordSize = wordSize;
+    _cfg = cfg;
+    _sessions.clear();
+    _byAddress.clear();
+    _connectQueue.clear();
+    _claimed = 0;
+    _anyConnected = false;
+    // fresh per run, so its counters describe this run only
+    _decryptPool.reset();
+    if (cfg.decrypt && _decryptWorkers > 0) _decryptPool = std::make_unique<DecryptPool>(_decryptWorkers);
+
+    const bool tagged = addresses.size() > 1;
+    for (uint64_t address : addresses) {
+        if (_byAddress.count(address)) continue;
+        auto session = std::make_unique<DeviceSession>(address, cfg);
+        session->setDecryptPool(_decryptPool.get());
+        session->onLog([this, address, tagged](const std::string& msg) {
+            if (!_logCb) return;
+            if (!tagged) { _logCb(msg); return; }
+            char tag[24];
+            std::snprintf(tag, sizeof(tag), "[%012llX] ", static_cast<unsigned long long>(address));
+            _logCb(tag + msg);
+        });
+        session->onData([this](const PacketView& packet) {
+            if (_dataCb) _dataCb(packet);
+        });
+        session->onPlaintext([this](uint64_t addr, std::span<const uint8_t> plain, double rtt) {
+            if (_deviceDataCb) _deviceDataCb(addr, plain, rtt);
+        });
+        session->onCipherTime([this](double ms, int blocks) {
+            if (_cipherCb) _cipherCb(ms, blocks);
+        });
+        _byAddress[address] = session.get();
+        _sessions.push_back(std::move(session));
+    }
+
+    std::vector<uint64_t> allowList;
+    allowList.reserve(_sessions.size());
+    for (auto const& s : _sessions) allowList.push_back(s->address());
+    _adverts.reset(allowList, AppConstants::ADVERT_SUMMARY_MS);
+    _adverts.onSummary([this](const std::string& line) {
+        if (_logCb) _logCb(line);
+    });
+
     _running = true;
+    _active = true;
     _state = AppState::Scanning;
     if (_stateCb) _stateCb(_state);
-    if (_logCb) _logCb("Starting scan");
+    if (_logCb) {
+        _logCb("Starting scan (" + _transport->name() + ")" +
+               (tagged ? " for " + std::to_string(_sessions.size()) + " devices" : std::string()));
+    }
+
+    _scanThread = std::thread([this]() { runScheduler(); });
+}
+
+void BleManager::runScheduler() {
+    _transport->initThread();
+
+    // 1) Check BT radio
+    if (!_transport->radioEnabled()) {
+        if (_logCb) _logCb("Bluetooth not enabled");
+        _running = false;
+        _state = AppState::Ready;
+        if (_stateCb) _stateCb(_state);
+        return;
+    }
 
-    _scanThread = std::thread([this, address]() {
-        init_apartment(apartment_type::multi_threaded);
+    // 2) One watcher for all sessions; a session goes to the connect queue the first
+    //    time its advertisement shows up. Adverts of everything else only touch the
+    //    seen-device table, the log gets a periodic summary
+    _transport->startWatcher([this](const BleAdvertisement& adv) {
+        if (!_adverts.ingest(adv)) return;
+        auto it = _byAddress.find(adv.address);
+        if (it == _byAddress.end() || !it->second->claim()) return;
+        {
+            std::lock_guard<std::mutex> lock(_schedMutex);
+            _connectQueue.push_back(it->second);
+            ++_claimed;
+        }
+        _schedCv.notify_all();
+    });
+    if (_logCb) _logCb("Watcher started");
+
+    // 3) Connect scheduler: a few links are set up in parallel, each session then
+    //    runs its request loop on its own thread
+    std::vector<std::thread> workers;
+    size_t workerCount = std::min<size_t>(_maxConnects, _sessions.size());
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back([this]() { connectWorker(); });
+    }
 
-        // 1) Check BT radio
+    {
+        std::unique_lock<std::mutex> lock(_schedMutex);
+        _schedCv.wait(lock, [this]() { return !_running || _claimed == _sessions.size(); });
+    }
+    _transport->stopWatcher();
+    if (_logCb) {
+        auto st = _adverts.stats();
+        char buf[160];
+        std::snprintf(buf, sizeof(buf), "Watcher stopped: %llu adverts (%llu allow-listed) from %zu devices",
+                      static_cast<unsigned long long>(st.adverts), static_cast<unsigned long long>(st.allowed), st.devices);
+        _logCb(buf);
+    }
+    for (auto& w : workers) w.join();
+
+    // 4) Keep the sessions alive until stopped
+    while (_running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+void BleManager::connectWorker() {
+    _transport->initThread();
+    for (;;) {
+        DeviceSession* session = nullptr;
         {
-            auto radios = Radio::GetRadiosAsync().get();
-            bool ok = false;
-            for (auto const& r : radios) {
-                if (r.Kind() == RadioKind::Bluetooth && r.State() == RadioState::On) {
-                    ok = true; break;
-                }
-            }
-            if (!ok) {
-                if (_logCb) _logCb("Bluetooth not enabled");
+            std::unique_lock<std::mutex> lock(_schedMutex);
+            _schedCv.wait(lock, [this]() {
+                return !_running || !_connectQueue.empty() || _claimed == _sessions.size();
+            });
+            if (!_running || _connectQueue.empty()) return;
+            session = _connectQueue.front();
+            _connectQueue.pop_front();
+        }
+
+        if (_logCb) {
+            char buf[64];
+            std::snprintf(buf, sizeof(buf), "Found %012llX, connecting…",
+                          static_cast<unsigned long long>(session->address()));
+            _logCb(buf);
+        }
+        if (!session->connect(*_transport)) {
+            bool allFailed = std::all_of(_sessions.begin(), _sessions.end(), [](auto const& s) {
+                return s->state() == SessionState::Failed;
+            });
+            if (allFailed) {
                 _running = false;
+                _schedCv.notify_all();
                 _state = AppState::Ready;
                 if (_stateCb) _stateCb(_state);
-                return;
             }
+            continue;
         }
-
-        // 2) Prepare watcher
-        _watcher = BluetoothLEAdvertisementWatcher();
-        _watcher.Received([this, address](auto const&, auto const& args) {
-            uint64_t addr = args.BluetoothAddress();
-            if (_logCb) {
-                char buf[64];
-                sprintf_s(buf, "Advertisement %016llX RSSI %d", addr, args.RawSignalStrengthInDBm());
-                _logCb(buf);
-            }
-            if (addr == address) {
-                _watcher.Stop();
-                if (_logCb) _logCb("Found target, connecting…");
-                connectToDevice(addr);
-            }
-        });
-
-        _watcher.Start();
-        if (_logCb) _logCb("Watcher started");
-        // 3) Poll until stopped
-        while (_running) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (!_anyConnected.exchange(true)) {
+            _state = AppState::Connected;
+            if (_stateCb) _stateCb(_state);
         }
-        _watcher.Stop();
-        if (_logCb) _logCb("Watcher stopped");
-    });
+        if (_running) {
+            session->startTransfer(_cfg.adaptivePacing ? convergedRate(session->address(), _cfg.requestType) : 0.0);
+        }
+    }
 }
 
 void BleManager::stopScan() {
-    if (!_running && !_device) return;
+    if (!_running && !_active) return;
     _running = false;
+    _schedCv.notify_all();
     if (_scanThread.joinable()) _scanThread.join();
     if (_logCb) _logCb("Scan thread joined");
 
-    // Disconnect if connected
-    if (_device) {
-        if (_logCb) _logCb("Disconnecting device");
-        // unregister notifications
-        if (_dataOutChar) {
-            _dataOutChar.ValueChanged(_dataOutToken);
-            _dataOutChar = nullptr;
-        }
-        if (_buttonChar) {
-            _buttonChar.ValueChanged(_buttonToken);
-            _buttonChar = nullptr;
+    // Disconnect everything that connected
+    for (auto& s : _sessions) {
+        bool transferred = s->pipelineStats().requestsCompleted > 0;
+        s->stop();
+        if (_cfg.adaptivePacing && transferred) {
+            _convergedRates[{ s->address(), _cfg.requestType }] = s->pacing().convergedRateBps();
         }
-        if (_timingChar) {
-            _timingChar.ValueChanged(_timingToken);
-            _timingChar = nullptr;
-        }
-        _device.Close();
-        _device = nullptr;
     }
+    if (_anyConnected) logGattCache();
+
+    if (_sessions.size() > 1 && _logCb) {
+        auto agg = aggregateStats();
+        char buf[192];
+        std::snprintf(buf, sizeof(buf),
+                      "Sessions: %u devices, %u connected, %u done, %u failed, %.2f B/s aggregate (%.2f B/s sum of devices)",
+                      agg.devices, agg.connected, agg.done, agg.failed, agg.bytesPerSecond(), agg.sumDeviceBytesPerSecond);
+        _logCb(buf);
+    }
+    _active = false;
     _state = AppState::Ready;
     if (_stateCb) _stateCb(_state);
 }
 
-void BleManager::connectToDevice(uint64_t address) {
-    auto dev = BluetoothLEDevice::FromBluetoothAddressAsync(address).get();
-    if (!dev) {
-        if (_logCb) _logCb("Failed to connect");
-        _running = false;
-        _state = AppState::Ready;
-        if (_stateCb) _stateCb(_state);
-        return;
-    }
-    _device = dev;
-    _state = AppState::Connected;
-    if (_stateCb) _stateCb(_state);
-    if (_logCb) {
-        std::wstring name = dev.Name().c_str();
-        std::string s(name.begin(), name.end());
-        _logCb("Connected to: " + s);
-    }
-
-    // Discover P2P service
-    auto sr = dev.GetGattServicesForUuidAsync(AppConstants::P2P_SERVICE_UUID, BluetoothCacheMode::Uncached).get();
-    auto svcs = sr.Services();
-    if (svcs.Size() == 0) {
-        if (_logCb) _logCb("P2P service not found");
-        return;
-    }
-    auto svc = svcs.GetAt(0);
-
-    {
-        auto all = svc.GetCharacteristicsAsync(BluetoothCacheMode::Uncached).get();
-        if (_logCb) _logCb("Service characteristics:");
-        for (auto const& c : all.Characteristics()) {
-            // převedeme winrt::guid na std::wstring a pak do UTF-8
-            std::wstring wuuid = winrt::to_hstring(c.Uuid()).c_str();
-            std::string  suuid( wuuid.begin(), wuuid.end() );
-
-            auto props = static_cast<unsigned>(c.CharacteristicProperties());
-            char buf[128];
-            sprintf_s(buf,
-                      "  • UUID: %s, props: 0x%02X",
-                      suuid.c_str(),
-                      props);
-            if (_logCb) _logCb(buf);
-        }
-    }
-
-    if (AppConstants::meastureAllTime) {
-        _startTime = std::chrono::steady_clock::now();
-    }
-    enableDataNotifications(svc);
-    enableTimingNotifications(svc);
-
-    uint32_t total     = _bytesToRequest;
-    uint32_t sentSoFar = 0;
-
-    while (sentSoFar < total) {
-        uint32_t remaining = total - sentSoFar;
-        uint32_t thisChunk = (remaining < _wordSize) ? remaining : _wordSize;
-        sendDataToDevice(svc, _requestType, thisChunk);
-        sentSoFar += thisChunk;
-        std::this_thread::sleep_for(std::chrono::milliseconds(7));
-    }
+GattCacheStats BleManager::gattCacheStats() const {
+    auto cache = _transport ? _transport->gattCache() : nullptr;
+    return cache ? cache->stats() : GattCacheStats{};
 }
 
-void BleManager::enableDataNotifications(GattDeviceService const& svc) {
-    auto csr = svc.GetCharacteristicsForUuidAsync(AppConstants::DATA_OUT_CHARACTERISTIC_UUID, BluetoothCacheMode::Uncached).get();
-    if (csr.Characteristics().Size() == 0) {
-        if (_logCb) _logCb("Data-out characteristic not found");
-        return;
-    }
-    _dataOutChar = csr.Characteristics().GetAt(0);
+void BleManager::logGattCache() {
+    auto cache = _transport ? _transport->gattCache() : nullptr;
+    if (!_logCb || !cache) return;
+    auto st = cache->stats();
+    char buf[160];
+    std::snprintf(buf, sizeof(buf),
+                  "GATT cache: %llu chunk lookups avoided (~%.2f ms saved), %u invalidations, %u stale entries",
+                  static_cast<unsigned long long>(st.chunkLookupsAvoided), st.chunkSavedMs(),
+                  st.invalidations, st.staleEntries);
+    _logCb(buf);
+}
 
-    _dataOutToken = _dataOutChar.ValueChanged([this](auto const&, auto const& args) {
-        auto end = std::chrono::steady_clock::now();
-        double diffMs = std::chrono::duration<double, std::milli>(end - _startTime).count();
+PipelineStats BleManager::pipelineStats() const {
+    return _sessions.empty() ? PipelineStats{} : _sessions.front()->pipelineStats();
+}
 
-        DataReader reader = DataReader::FromBuffer(args.CharacteristicValue());
-        std::vector<uint8_t> buf(reader.UnconsumedBufferLength());
-        reader.ReadBytes(buf);
+std::vector<RequestRecord> BleManager::requestTimeline() const {
+    return _sessions.empty() ? std::vector<RequestRecord>{} : _sessions.front()->pipeline().timeline();
+}
 
-        if (_dataCb) _dataCb(buf, diffMs);
-    });
+bool BleManager::writeRequestTimeline(const std::string& path) const {
+    return !_sessions.empty() && _sessions.front()->pipeline().writeTimelineCsv(path);
+}
 
-    _dataOutChar.WriteClientCharacteristicConfigurationDescriptorAsync(
-        GattClientCharacteristicConfigurationDescriptorValue::Notify).get();
-    if (_logCb) _logCb("Data notifications enabled");
+DecryptPoolStats BleManager::decryptPoolStats() const {
+    return _decryptPool ? _decryptPool->stats() : DecryptPoolStats{};
 }
 
-void BleManager::enableTimingNotifications(GattDeviceService const& svc) {
-    auto csr = svc.GetCharacteristicsForUuidAsync(
-                   AppConstants::DATA_OUT_TIME_CHARACTERISTIC_UUID,
-                   BluetoothCacheMode::Uncached).get();
-    if (csr.Characteristics().Size() == 0) {
-        if (_logCb) _logCb("Timing characteristic not found");
-        return;
-    }
-    _timingChar = csr.Characteristics().GetAt(0);
-    _timingToken = _timingChar.ValueChanged([this](auto const&, auto const& args) {
-        DataReader reader = DataReader::FromBuffer(args.CharacteristicValue());
-        auto len = reader.UnconsumedBufferLength();
-        std::vector<uint8_t> buf(len);
-        reader.ReadBytes(buf);
-
-        if (buf.size() < 4) {
-            if (_logCb) _logCb("Timing: payload too small for uint32");
-            return;
-        }
+LatencySummary BleManager::latencySummary() const {
+    return _sessions.empty() ? LatencySummary{} : _sessions.front()->latencySummary();
+}
 
-        uint32_t us =
-            static_cast<uint32_t>(buf[0]) |
-            (static_cast<uint32_t>(buf[1]) << 8) |
-            (static_cast<uint32_t>(buf[2]) << 16) |
-            (static_cast<uint32_t>(buf[3]) << 24);
+bool BleManager::writeLatencyBreakdown(const std::string& path) const {
+    if (_sessions.empty()) return false;
+    auto parts = _sessions.front()->latencyBreakdown();
+    return !parts.empty() && writeLatencyCsv(parts, path);
+}
 
-        double ms = us / 1000.0;
+const Pacer& BleManager::pacer() const {
+    return _sessions.empty() ? _idlePacer : _sessions.front()->pacer();
+}
 
-        if (_logCb) {
-            char msg[64];
-            std::snprintf(msg, sizeof(msg),
-                          "Cipher time on MCU: %u µs → %.3f ms", us, ms);
-            _logCb(msg);
-        }
-        if (_cipherCb) {
-            _cipherCb(ms, 1);
-        }
-    });
+const CongestionController& BleManager::pacing() const {
+    return _sessions.empty() ? _idlePacing : _sessions.front()->pacing();
+}
 
-    _timingChar.WriteClientCharacteristicConfigurationDescriptorAsync(GattClientCharacteristicConfigurationDescriptorValue::Notify).get();
+double BleManager::convergedRate(uint64_t address, uint8_t requestType) const {
+    auto it = _convergedRates.find({ address, requestType });
+    return (it != _convergedRates.end()) ? it->second : 0.0;
+}
 
-    if (_logCb) _logCb("Timing notifications enabled");
+std::vector<SessionStats> BleManager::sessionStats() const {
+    std::vector<SessionStats> out;
+    out.reserve(_sessions.size());
+    for (auto const& s : _sessions) out.push_back(s->stats());
+    return out;
 }
 
-void BleManager::sendDataToDevice(GattDeviceService const& svc, uint8_t requestType, uint16_t bytesToRequest) {
-    auto csr = svc.GetCharacteristicsForUuidAsync(AppConstants::DATA_IN_CHARACTERISTIC_UUID, BluetoothCacheMode::Uncached).get();
-    if (csr.Characteristics().Size() == 0) {
-        if (_logCb) _logCb("Data-in characteristic not found");
-        return;
+AggregateStats BleManager::aggregateStats() const {
+    using clock = SessionStats::clock;
+    AggregateStats agg;
+    clock::time_point first{}, last{};
+    for (auto const& st : sessionStats()) {
+        ++agg.devices;
+        if (st.connectMs > 0.0)               ++agg.connected;
+        if (st.state == SessionState::Done)   ++agg.done;
+        if (st.state == SessionState::Failed) ++agg.failed;
+        agg.bytesCompleted  += st.pipeline.bytesCompleted;
+        agg.packets         += st.packets;
+        agg.decryptFailures += st.decryptFailures;
+        agg.tagFailures     += st.tagFailures;
+        agg.steadyAllocations += st.steadyAllocations;
+        agg.sumDeviceBytesPerSecond += st.bytesPerSecond();
+        if (st.firstSend != clock::time_point{}) {
+            if (first == clock::time_point{} || st.firstSend < first) first = st.firstSend;
+            if (st.lastData > last) last = st.lastData;
+        }
     }
-    auto inChar = csr.Characteristics().GetAt(0);
-
-    if (!AppConstants::meastureAllTime) {
-        _startTime = std::chrono::steady_clock::now();
+    if (first != clock::time_point{} && last > first) {
+        agg.elapsedMs = std::chrono::duration<double, std::milli>(last - first).count();
     }
-
-    DataWriter writer;
-    writer.WriteByte(requestType);
-    writer.WriteUInt16(bytesToRequest);
-    auto buf = writer.DetachBuffer();
-    inChar.WriteValueAsync(buf, GattWriteOption::WriteWithoutResponse).get();
-    
-    if (_logCb) {
-                char logBuf[64];
-                std::snprintf(logBuf, sizeof(logBuf),
-                              "Request sent, start timer (bytesToRequest=%u)",
-                              static_cast<unsigned>(bytesToRequest));
-                _logCb(logBuf);
-            }
-}
\ No newline at end of file
+    return agg;
+}
@@ -7,31 +7,71 @@
 #pragma once
 
 #include <functional>
+#include <map>
 #include <vector>
 #include <string>
 #include <cstdint>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <thread>
+#include <unordered_map>
+#include <utility>
 
-#include <winrt/base.h>
-#include <winrt/Windows.Devices.Bluetooth.h>
-#include <winrt/Windows.Devices.Bluetooth.Advertisement.h>
-#include <winrt/Windows.Devices.Bluetooth.GenericAttributeProfile.h>
+#include "advert_ingest.h"
+#include "ble_transport.h"
+#include "decrypt_pool.h"
+#include "congestion_control.h"
+#include "device_session.h"
+#include "gatt_cache.h"
+#include "pacer.h"
+#include "request_pipeline.h"
 
 /// Application state for BLE
 enum class AppState { Ready, Scanning, Connected };
 
+/// Sum over all device sessions of a run
+struct AggregateStats {
+    uint32_t devices     = 0;
+    uint32_t connected   = 0;     ///< sessions that got past connect
+    uint32_t done        = 0;
+    uint32_t failed      = 0;
+    uint64_t bytesCompleted = 0;  ///< requested bytes whose responses arrived
+    uint64_t packets     = 0;
+    uint64_t decryptFailures = 0;
+    uint64_t tagFailures     = 0;
+    uint64_t steadyAllocations = 0; ///< heap allocations in the FE44 handlers after warm-up
+    double   elapsedMs   = 0.0;   ///< earliest first send → latest notification
+    double   sumDeviceBytesPerSecond = 0.0;
+
+    double bytesPerSecond() const {
+        return (elapsedMs > 0.0) ? bytesCompleted / (elapsedMs / 1000.0) : 0.0;
+    }
+};
+
 class BleManager {
 public:
-    BleManager();
+    /// @param transport BLE backend (WinRT on Windows, simulator elsewhere)
+    explicit BleManager(std::unique_ptr<BleTransport> transport = createTransport(TransportKind::WinRt));
     ~BleManager();
 
+    /// Replaces the BLE backend, ignored while a scan/connection is active
+    void setTransport(std::unique_ptr<BleTransport> transport);
+
     /// Register a logging callback (e.g. to SimpleConsole)
     void onLog(std::function<void(const std::string&)> cb);
     /// Register a state-change callback (Ready/Scanning/Connected)
     void onStateChanged(std::function<void(AppState)> cb);
-    /// Register a data callback: (rawPacket, rtt_ms)
-    void onData(std::function<void(const std::vector<uint8_t>&, double)> cb);
+    /// Register a data callback: raw FE44 packet (ring slot view with seq, receive time and rtt_ms);
+    /// called from every session's notification thread, the view is valid during the call
+    void onData(std::function<void(const PacketView&)> cb);
+    /// Register a per-device plaintext callback: (address, plaintext, rtt_ms),
+    /// used when sessions decrypt themselves (SessionConfig::decrypt)
+    void onDeviceData(std::function<void(uint64_t, std::span<const uint8_t>, double)> cb);
     /// Register a cipher time callback
     void onCipherTime(std::function<void(double, int)> cb);
 
@@ -40,38 +80,108 @@ public:
     /// @param requestType 0x01, 0x02, 0x3 ...
     /// @param bytesToRequest 0 - 20000 B data length
     /// @param wordSize cipher word size
-    /// @param interChunkDelayMs inter chunk delay
-    void startScan(uint64_t address, uint8_t requestType, uint32_t bytesToRequest, uint32_t wordSize, double interChunkDelayMs);
+    /// @param interChunkDelayMs spacing between request sends, held against absolute deadlines (sub-ms steps work)
+    /// @param window max requests in flight (next request goes out when an older one's data arrived)
+    /// @param adaptivePacing ignore interChunkDelayMs and let the AIMD controller pace the requests;
+    ///        timed out requests are re-requested so the full length still arrives
+    /// @param sequenceIds extended request frames whose seq the firmware echoes (exact per-request RTT,
+    ///        reorder and loss detection)
+    void startScan(uint64_t address, uint8_t requestType, uint32_t bytesToRequest, uint32_t wordSize, double interChunkDelayMs,
+                   uint32_t window = 4, bool adaptivePacing = false, bool sequenceIds = false);
+
+    /// Start one session per address: a shared watcher finds them, the connect scheduler
+    /// connects up to maxConcurrentConnects at a time, then every session runs its own
+    /// request loop with the same settings
+    void startSessions(const std::vector<uint64_t>& addresses, const SessionConfig& cfg);
+
+    /// Connections established in parallel (default 4)
+    void setMaxConcurrentConnects(uint32_t n) { _maxConnects = (n < 1) ? 1 : n; }
+
+    /// Decrypt workers shared by the sessions of the next startSessions() with
+    /// SessionConfig::decrypt (0 = every session decrypts on its own, the default)
+    void setDecryptWorkers(uint32_t n) { _decryptWorkers = n; }
+
+    /// Counters of the shared decrypt pool (zeros if there is none)
+    DecryptPoolStats decryptPoolStats() const;
 
     /// Stop scanning / disconnect if connected
     void stopScan();
 
+    /// Counters of the transport's GATT handle cache (zeros if the backend has none)
+    GattCacheStats gattCacheStats() const;
+
+    /// In-flight depth, stall time and throughput of the current/last transfer (first session)
+    PipelineStats pipelineStats() const;
+
+    /// Per-request timeline of the current/last transfer (first session)
+    std::vector<RequestRecord> requestTimeline() const;
+
+    /// Writes requestTimeline() as CSV, false if there is none or the file can't be written
+    bool writeRequestTimeline(const std::string& path) const;
+
+    /// Host send / air / MCU queue / MCU cipher / host split of the request RTTs (first session,
+    /// needs sequence IDs and a peripheral answering clock sync)
+    LatencySummary latencySummary() const;
+
+    /// Writes the per-request breakdown as CSV, false if there is none or the file can't be written
+    bool writeLatencyBreakdown(const std::string& path) const;
+
+    /// Actual vs requested request spacing of the current/last paced transfer (first session)
+    const Pacer& pacer() const;
+
+    /// Pacing controller of the current/last adaptive transfer (first session)
+    const CongestionController& pacing() const;
+
+    /// Rate adaptive pacing converged to for a device and request type in an earlier run (0 = none yet)
+    double convergedRate(uint64_t address, uint8_t requestType) const;
+
+    /// Per-device counters of the current/last run
+    std::vector<SessionStats> sessionStats() const;
+
+    /// Totals over all sessions of the current/last run
+    AggregateStats aggregateStats() const;
+
+    /// Advertisement counters of the current/last scan
+    AdvertStats advertStats() const { return _adverts.stats(); }
+
+    /// Last-seen time, advert count and smoothed RSSI of an address seen by the current/last scan
+    bool advertEntry(uint64_t address, AdvertEntry& out) const { return _adverts.lookup(address, out); }
+
 private:
-    void connectToDevice(uint64_t address);
-    void enableDataNotifications(winrt::Windows::Devices::Bluetooth::GenericAttributeProfile::GattDeviceService const& svc);
-    void enableTimingNotifications(winrt::Windows::Devices::Bluetooth::GenericAttributeProfile::GattDeviceService const& svc);
-    void sendDataToDevice(winrt::Windows::Devices::Bluetooth::GenericAttributeProfile::GattDeviceService const& svc, uint8_t requestType, uint16_t bytesToRequest);
-
-    winrt::Windows::Devices::Bluetooth::Advertisement::BluetoothLEAdvertisementWatcher _watcher{ nullptr };
-    winrt::Windows::Devices::Bluetooth::BluetoothLEDevice _device{ nullptr };
-    winrt::Windows::Devices::Bluetooth::GenericAttributeProfile::GattCharacteristic _dataOutChar{ nullptr };
-    winrt::Windows::Devices::Bluetooth::GenericAttributeProfile::GattCharacteristic _buttonChar{ nullptr };
-    winrt::Windows::Devices::Bluetooth::GenericAttributeProfile::GattCharacteristic _timingChar{ nullptr };
-    winrt::event_token    _timingToken{};
-    winrt::event_token    _dataOutToken{};
-    winrt::event_token    _buttonToken{};
+    void runScheduler();
+    void connectWorker();
+    void logGattCache();
+
+    std::unique_ptr<BleTransport>  _transport;
     std::thread           _scanThread;
     std::atomic<bool>     _running{ false };
-    uint8_t               _requestType = 0x01;
-    std::chrono::steady_clock::time_point _startTime;
+    bool                  _active = false;     ///< started and not yet stopped (sessions may hold links)
+
+    std::unique_ptr<DecryptPool> _decryptPool;     ///< outlives the sessions that submit to it
+    uint32_t                     _decryptWorkers = 0;
+
+    // sessions of the current/last run, replaced only by startSessions() while idle
+    std::vector<std::unique_ptr<DeviceSession>> _sessions;
+    std::unordered_map<uint64_t, DeviceSession*> _byAddress;
+    std::mutex                 _schedMutex;
+    std::condition_variable    _schedCv;
+    std::deque<DeviceSession*> _connectQueue;
+    size_t                     _claimed = 0;
+    uint32_t                   _maxConnects = 4;
+    std::atomic<bool>          _anyConnected{ false };
+    AdvertIngest               _adverts;     ///< allow-list + seen-device table of the watcher
+
+    Pacer                 _idlePacer;      ///< returned while no session exists
+    CongestionController  _idlePacing;
+    std::map<std::pair<uint64_t, uint8_t>, double> _convergedRates;     ///< seeds the next adaptive run
+    SessionConfig         _cfg{};
+
     std::function<void(const std::string&)> _logCb{};
     std::function<void(AppState)> _stateCb{};
-    std::function<void(const std::vector<uint8_t>&, double)> _dataCb{};
+    std::function<void(const PacketView&)> _dataCb{};
+    std::function<void(uint64_t, std::span<const uint8_t>, double)> _deviceDataCb{};
     std::function<void(double, int)> _cipherCb;
     AppState              _state = AppState::Ready;
-    uint32_t              _bytesToRequest;
-    uint32_t              _wordSize;
-    double                _interChunkDelayMs;
 };
 
 #endif //BLE_MANAGER_H
@@ -0,0 +1,20 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "ble_transport.h"
+#include "sim_transport.h"
+#ifdef _WIN32
+#include "winrt_transport.h"
+#endif
+
+std::unique_ptr<BleTransport> createTransport(TransportKind kind) {
+#ifdef _WIN32
+    if (kind == TransportKind::WinRt) {
+        return std::make_unique<WinRtTransport>();
+    }
+#else
+    (void)kind;
+#endif
+    return std::make_unique<SimTransport>();
+}
@@ -0,0 +1,99 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef BLE_TRANSPORT_H
+#define BLE_TRANSPORT_H
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class GattHandleCache;
+
+/// Advertisement reported by the transport's watcher
+struct BleAdvertisement {
+    uint64_t address = 0;
+    int16_t  rssi    = 0;
+};
+
+/// Characteristic found on the P2P service during discovery
+struct BleCharacteristicInfo {
+    std::string uuid;
+    uint32_t    properties = 0;
+};
+
+/// One GATT connection to a P2P peripheral (FE40 service).
+/// Methods are called from the owning DeviceSession's threads, callbacks arrive on a transport thread.
+class BleConnection {
+public:
+    using NotifyCallback = std::function<void(std::span<const uint8_t>)>;
+
+    virtual ~BleConnection() = default;
+
+    /// Human readable device name
+    virtual std::string name() const = 0;
+
+    /// Discovers the P2P service, lists its characteristics and caches the
+    /// FE43/FE44/FE45 handles for the rest of the session (persisted handles are tried first)
+    /// @return false if the service is missing
+    virtual bool discover(std::vector<BleCharacteristicInfo>& characteristics) = 0;
+
+    /// Subscribes to FE44 (ciphertext notifications)
+    virtual bool subscribeData(NotifyCallback cb) = 0;
+
+    /// Subscribes to FE45 (uint32 µs cipher time notifications)
+    virtual bool subscribeTiming(NotifyCallback cb) = 0;
+
+    /// Queues a request frame to FE43 (write without response) using the cached handle
+    /// and returns without waiting for completion; re-discovers first if the cache was
+    /// invalidated (disconnect / service changed)
+    /// @return false if the write could not be queued
+    virtual bool writeRequest(std::span<const uint8_t> frame) = 0;
+
+    /// Queued writes that later failed
+    virtual uint64_t failedWrites() const { return 0; }
+
+    /// Unsubscribes notifications and closes the link
+    virtual void close() = 0;
+};
+
+/// Radio-level part of a BLE backend: advertisement watcher and connection factory
+class BleTransport {
+public:
+    using AdvertCallback = std::function<void(const BleAdvertisement&)>;
+
+    virtual ~BleTransport() = default;
+
+    /// Backend name for logging
+    virtual std::string name() const = 0;
+
+    /// Prepares the calling thread for transport calls (e.g. WinRT apartment)
+    virtual void initThread() {}
+
+    /// @return true if a usable Bluetooth radio is present and on
+    virtual bool radioEnabled() = 0;
+
+    /// Starts delivering advertisements to cb until stopWatcher()
+    virtual void startWatcher(AdvertCallback cb) = 0;
+    virtual void stopWatcher() = 0;
+
+    /// Connects to the given address; may be called from several connect workers at once
+    /// @return nullptr on failure
+    virtual std::unique_ptr<BleConnection> connect(uint64_t address) = 0;
+
+    /// Attribute handle cache shared by all connections of this transport
+    virtual const GattHandleCache* gattCache() const { return nullptr; }
+};
+
+/// Available transport backends
+enum class TransportKind { WinRt, Simulated };
+
+/// Creates a transport backend (WinRt is only available on Windows, falls back to Simulated elsewhere)
+std::unique_ptr<BleTransport> createTransport(TransportKind kind);
+
+#endif //BLE_TRANSPORT_H
@@ -0,0 +1,524 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "chacha20_simd.h"
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include <mbedtls/chacha20.h>
+
+#if BLE_X86
+#include <immintrin.h>
+#endif
+
+namespace ChaCha20 {
+
+namespace {
+
+constexpr size_t kBlock = 64;
+const uint8_t kZeros[8 * kBlock] = {};     ///< input of the keystream-only tail pass
+
+std::atomic<int> g_forced{ -1 };
+
+//––– Scalar –––//
+
+inline uint32_t rotl(uint32_t v, int c) { return (v << c) | (v >> (32 - c)); }
+
+inline void quarterRound(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d) {
+    a += b; d ^= a; d = rotl(d, 16);
+    c += d; b ^= c; b = rotl(b, 12);
+    a += b; d ^= a; d = rotl(d, 8);
+    c += d; b ^= c; b = rotl(b, 7);
+}
+
+/// The double rounds on x in place, without the feed-forward
+inline void scalarRounds(uint32_t x[16], uint32_t doubleRounds) {
+    for (uint32_t i = 0; i < doubleRounds; ++i) {
+        quarterRound(x[0], x[4], x[8],  x[12]);
+        quarterRound(x[1], x[5], x[9],  x[13]);
+        quarterRound(x[2], x[6], x[10], x[14]);
+        quarterRound(x[3], x[7], x[11], x[15]);
+        quarterRound(x[0], x[5], x[10], x[15]);
+        quarterRound(x[1], x[6], x[11], x[12]);
+        quarterRound(x[2], x[7], x[8],  x[13]);
+        quarterRound(x[3], x[4], x[9],  x[14]);
+    }
+}
+
+void scalarBlock(const uint32_t in[16], uint32_t doubleRounds, uint32_t counter, uint8_t out[kBlock]) {
+    uint32_t s[16], x[16];
+    std::memcpy(s, in, sizeof(s));
+    s[12] = counter;
+    std::memcpy(x, s, sizeof(x));
+    scalarRounds(x, doubleRounds);
+    for (int i = 0; i < 16; ++i) {
+        const uint32_t v = x[i] + s[i];
+        out[4 * i]     = static_cast<uint8_t>(v);
+        out[4 * i + 1] = static_cast<uint8_t>(v >> 8);
+        out[4 * i + 2] = static_cast<uint8_t>(v >> 16);
+        out[4 * i + 3] = static_cast<uint8_t>(v >> 24);
+    }
+}
+
+/// Whole and partial blocks one at a time
+void scalarXor(const uint32_t st[16], uint32_t doubleRounds, uint32_t counter, const uint8_t* in, uint8_t* out,
+               size_t len) {
+    uint8_t ks[kBlock];
+    while (len > 0) {
+        scalarBlock(st, doubleRounds, counter++, ks);
+        const size_t n = std::min(len, kBlock);
+        for (size_t i = 0; i < n; ++i) out[i] = in[i] ^ ks[i];
+        in += n; out += n; len -= n;
+    }
+}
+
+#if BLE_X86
+
+//––– SSE2: 4 blocks, one block per 32-bit lane –––//
+
+BLE_TARGET("sse2") inline __m128i rotl128(__m128i v, int c) {
+    return _mm_or_si128(_mm_slli_epi32(v, c), _mm_srli_epi32(v, 32 - c));
+}
+
+#define QR128(a, b, c, d)                                               \
+    a = _mm_add_epi32(a, b); d = rotl128(_mm_xor_si128(d, a), 16);      \
+    c = _mm_add_epi32(c, d); b = rotl128(_mm_xor_si128(b, c), 12);      \
+    a = _mm_add_epi32(a, b); d = rotl128(_mm_xor_si128(d, a), 8);       \
+    c = _mm_add_epi32(c, d); b = rotl128(_mm_xor_si128(b, c), 7);
+
+/// 256 bytes: out = in XOR keystream of blocks counter … counter+3
+BLE_TARGET("sse2") void sse2Blocks4(const uint32_t st[16], uint32_t doubleRounds, uint32_t counter,
+                                    const uint8_t* in, uint8_t* out) {
+    __m128i s[16], x[16];
+    for (int i = 0; i < 16; ++i) s[i] = _mm_set1_epi32(static_cast<int>(st[i]));
+    s[12] = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(counter)), _mm_setr_epi32(0, 1, 2, 3));
+    for (int i = 0; i < 16; ++i) x[i] = s[i];
+
+    for (uint32_t r = 0; r < doubleRounds; ++r) {
+        QR128(x[0], x[4], x[8],  x[12]);
+        QR128(x[1], x[5], x[9],  x[13]);
+        QR128(x[2], x[6], x[10], x[14]);
+        QR128(x[3], x[7], x[11], x[15]);
+        QR128(x[0], x[5], x[10], x[15]);
+        QR128(x[1], x[6], x[11], x[12]);
+        QR128(x[2], x[7], x[8],  x[13]);
+        QR128(x[3], x[4], x[9],  x[14]);
+    }
+    for (int i = 0; i < 16; ++i) x[i] = _mm_add_epi32(x[i], s[i]);
+
+    // 4x4 transpose per group of 4 words: y[g][k] = words 4g … 4g+3 of block k
+    __m128i y[4][4];
+    for (int g = 0; g < 4; ++g) {
+        const __m128i t0 = _mm_unpacklo_epi32(x[4 * g],     x[4 * g + 1]);
+        const __m128i t1 = _mm_unpackhi_epi32(x[4 * g],     x[4 * g + 1]);
+        const __m128i t2 = _mm_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+        const __m128i t3 = _mm_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+        y[g][0] = _mm_unpacklo_epi64(t0, t2);
+        y[g][1] = _mm_unpackhi_epi64(t0, t2);
+        y[g][2] = _mm_unpacklo_epi64(t1, t3);
+        y[g][3] = _mm_unpackhi_epi64(t1, t3);
+    }
+    // ascending addresses, so an output a few bytes before the input is fine
+    for (int k = 0; k < 4; ++k) {
+        for (int g = 0; g < 4; ++g) {
+            const size_t off = k * kBlock + g * 16;
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + off));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + off), _mm_xor_si128(v, y[g][k]));
+        }
+    }
+}
+
+#undef QR128
+
+//––– AVX2: 8 blocks, one block per 32-bit lane –––//
+
+#define QR256(a, b, c, d)                                                               \
+    a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16); \
+    c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c);                             \
+    b = _mm256_or_si256(_mm256_slli_epi32(b, 12), _mm256_srli_epi32(b, 20));            \
+    a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot8);  \
+    c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c);                             \
+    b = _mm256_or_si256(_mm256_slli_epi32(b, 7), _mm256_srli_epi32(b, 25));
+
+/// The rounds on 8 states side by side (one per 32-bit lane) plus the feed-forward,
+/// transposed into ks[lane][32-byte half]: the 64 keystream bytes of each lane's block
+BLE_TARGET("avx2") inline void avx2Rounds(const __m256i s[16], uint32_t doubleRounds, __m256i ks[8][2]) {
+    // byte shuffles for the 16 and 8 bit rotations
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                           2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8  = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                           3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+    __m256i x[16];
+    for (int i = 0; i < 16; ++i) x[i] = s[i];
+
+    for (uint32_t r = 0; r < doubleRounds; ++r) {
+        QR256(x[0], x[4], x[8],  x[12]);
+        QR256(x[1], x[5], x[9],  x[13]);
+        QR256(x[2], x[6], x[10], x[14]);
+        QR256(x[3], x[7], x[11], x[15]);
+        QR256(x[0], x[5], x[10], x[15]);
+        QR256(x[1], x[6], x[11], x[12]);
+        QR256(x[2], x[7], x[8],  x[13]);
+        QR256(x[3], x[4], x[9],  x[14]);
+    }
+    for (int i = 0; i < 16; ++i) x[i] = _mm256_add_epi32(x[i], s[i]);
+
+    // per 128-bit half a 4x4 transpose: y[g][k] = words 4g … 4g+3 of lane k (low half)
+    // and of lane k+4 (high half)
+    __m256i y[4][4];
+    for (int g = 0; g < 4; ++g) {
+        const __m256i t0 = _mm256_unpacklo_epi32(x[4 * g],     x[4 * g + 1]);
+        const __m256i t1 = _mm256_unpackhi_epi32(x[4 * g],     x[4 * g + 1]);
+        const __m256i t2 = _mm256_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+        const __m256i t3 = _mm256_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+        y[g][0] = _mm256_unpacklo_epi64(t0, t2);
+        y[g][1] = _mm256_unpackhi_epi64(t0, t2);
+        y[g][2] = _mm256_unpacklo_epi64(t1, t3);
+        y[g][3] = _mm256_unpackhi_epi64(t1, t3);
+    }
+    for (int k = 0; k < 4; ++k) {
+        ks[k][0]     = _mm256_permute2x128_si256(y[0][k], y[1][k], 0x20);
+        ks[k][1]     = _mm256_permute2x128_si256(y[2][k], y[3][k], 0x20);
+        ks[k + 4][0] = _mm256_permute2x128_si256(y[0][k], y[1][k], 0x31);
+        ks[k + 4][1] = _mm256_permute2x128_si256(y[2][k], y[3][k], 0x31);
+    }
+}
+
+/// One 64-byte block: out = in XOR ks; both halves are loaded before either is stored,
+/// so out may equal in or start before it
+BLE_TARGET("avx2") inline void avx2XorBlock(const __m256i ks[2], const uint8_t* in, uint8_t* out) {
+    const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+    const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 32));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),      _mm256_xor_si256(v0, ks[0]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 32), _mm256_xor_si256(v1, ks[1]));
+}
+
+/// 512 bytes: out = in XOR keystream of blocks counter … counter+7
+BLE_TARGET("avx2") void avx2Blocks8(const uint32_t st[16], uint32_t doubleRounds, uint32_t counter,
+                                    const uint8_t* in, uint8_t* out) {
+    __m256i s[16], ks[8][2];
+    for (int i = 0; i < 16; ++i) s[i] = _mm256_set1_epi32(static_cast<int>(st[i]));
+    s[12] = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(counter)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    avx2Rounds(s, doubleRounds, ks);
+    // ascending addresses, so an output a few bytes before the input is fine
+    for (int b = 0; b < 8; ++b) avx2XorBlock(ks[b], in + b * kBlock, out + b * kBlock);
+}
+
+//––– AVX2 multi-buffer: one stream per lane –––//
+
+/// Up to 8 streams side by side; a lane that runs out is refilled from the queue
+struct Lanes {
+    alignas(32) uint32_t words[16][8];  ///< [state word][lane], word 12 is the lane's next counter
+    const uint8_t* in[8];
+    uint8_t*       out[8];
+    size_t         left[8];             ///< bytes still to go, 0 = idle lane
+    uint32_t       doubleRounds = 10;   ///< of every lane
+};
+
+/// One block of every lane; idle lanes are computed but never stored (masked out), a
+/// lane's last partial block only writes its own bytes
+BLE_TARGET("avx2") void avx2LanesStep(Lanes& l) {
+    __m256i s[16], ks[8][2];
+    for (int i = 0; i < 16; ++i) s[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(l.words[i]));
+    avx2Rounds(s, l.doubleRounds, ks);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(l.words[12]), _mm256_add_epi32(s[12], _mm256_set1_epi32(1)));
+    for (int k = 0; k < 8; ++k) {
+        const size_t n = l.left[k];
+        if (n == 0) continue;
+        if (n >= kBlock) {
+            avx2XorBlock(ks[k], l.in[k], l.out[k]);
+        } else {
+            alignas(32) uint8_t tmp[kBlock];
+            std::memcpy(tmp, l.in[k], n);
+            avx2XorBlock(ks[k], tmp, tmp);
+            std::memcpy(l.out[k], tmp, n);
+        }
+        const size_t done = std::min(n, kBlock);
+        l.in[k] += done; l.out[k] += done; l.left[k] -= done;
+    }
+}
+
+#undef QR256
+
+#endif // BLE_X86
+
+} // namespace
+
+const char* kernelName(Kernel kernel) {
+    switch (kernel) {
+      case Kernel::Scalar: return "scalar";
+      case Kernel::Sse2:   return "SSE2";
+      case Kernel::Avx2:   return "AVX2";
+    }
+    return "?";
+}
+
+bool kernelSupported(Kernel kernel) {
+    switch (kernel) {
+      case Kernel::Scalar: return true;
+      case Kernel::Sse2:   return BLE_X86 && cpuFeatures().sse2;
+      case Kernel::Avx2:   return BLE_X86 && cpuFeatures().avx2;
+    }
+    return false;
+}
+
+Kernel bestKernel() {
+    static const Kernel best = kernelSupported(Kernel::Avx2) ? Kernel::Avx2
+                             : kernelSupported(Kernel::Sse2) ? Kernel::Sse2 : Kernel::Scalar;
+    return best;
+}
+
+Kernel activeKernel() {
+    const int forced = g_forced.load(std::memory_order_relaxed);
+    return forced < 0 ? bestKernel() : static_cast<Kernel>(forced);
+}
+
+void forceKernel(Kernel kernel) {
+    g_forced.store(static_cast<int>(kernelSupported(kernel) ? kernel : Kernel::Scalar), std::memory_order_relaxed);
+}
+
+void resetKernel() {
+    g_forced.store(-1, std::memory_order_relaxed);
+}
+
+namespace {
+
+uint32_t le32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+} // namespace
+
+State makeState(const uint8_t key[32], const uint8_t nonce[12], uint32_t counter, int rounds) {
+    State st{};
+    st.doubleRounds = static_cast<uint32_t>(rounds / 2);
+    st.w[0] = 0x61707865; st.w[1] = 0x3320646e; st.w[2] = 0x79622d32; st.w[3] = 0x6b206574;    // "expand 32-byte k"
+    for (int i = 0; i < 8; ++i) st.w[4 + i] = le32(key + 4 * i);
+    st.w[12] = counter;
+    for (int i = 0; i < 3; ++i) st.w[13 + i] = le32(nonce + 4 * i);
+    return st;
+}
+
+void setNonce(State& st, const uint8_t nonce[12]) {
+    for (int i = 0; i < 3; ++i) st.w[13 + i] = le32(nonce + 4 * i);
+}
+
+void hchacha20(const uint8_t key[32], const uint8_t nonce[16], uint8_t subkey[32]) {
+    uint32_t x[16] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+    for (int i = 0; i < 8; ++i) x[4 + i] = le32(key + 4 * i);
+    for (int i = 0; i < 4; ++i) x[12 + i] = le32(nonce + 4 * i);
+    scalarRounds(x, 10);
+    // words 0-3 and 12-15, no feed-forward
+    for (int i = 0; i < 8; ++i) {
+        const uint32_t v = x[i < 4 ? i : i + 8];
+        for (int b = 0; b < 4; ++b) subkey[4 * i + b] = static_cast<uint8_t>(v >> (8 * b));
+    }
+}
+
+void xorStream(const State& st, const uint8_t* in, uint8_t* out, size_t len) {
+    xorStream(activeKernel(), st, in, out, len);
+}
+
+void xorStream(Kernel kernel, const State& st, const uint8_t* in, uint8_t* out, size_t len) {
+    uint32_t counter = st.w[12];
+#if BLE_X86
+    if (!kernelSupported(kernel)) kernel = Kernel::Scalar;
+    if (kernel == Kernel::Avx2) {
+        for (; len >= 8 * kBlock; len -= 8 * kBlock, in += 8 * kBlock, out += 8 * kBlock, counter += 8) {
+            avx2Blocks8(st.w, st.doubleRounds, counter, in, out);
+        }
+    }
+    if (kernel != Kernel::Scalar) {
+        for (; len >= 4 * kBlock; len -= 4 * kBlock, in += 4 * kBlock, out += 4 * kBlock, counter += 4) {
+            sse2Blocks4(st.w, st.doubleRounds, counter, in, out);
+        }
+        // a tail of 2+ blocks (a 244 B packet is all tail) still goes through a vector pass
+        if (len > kBlock) {
+            alignas(32) uint8_t ks[8 * kBlock];
+            if (kernel == Kernel::Avx2 && len > 4 * kBlock) avx2Blocks8(st.w, st.doubleRounds, counter, kZeros, ks);
+            else                                            sse2Blocks4(st.w, st.doubleRounds, counter, kZeros, ks);
+            for (size_t i = 0; i < len; ++i) out[i] = in[i] ^ ks[i];
+            return;
+        }
+    }
+#else
+    (void)kernel;
+#endif
+    scalarXor(st.w, st.doubleRounds, counter, in, out, len);
+}
+
+void xorStreams(const Stream* streams, size_t count) {
+    xorStreams(activeKernel(), streams, count);
+}
+
+void xorStreams(Kernel kernel, const Stream* streams, size_t count) {
+#if BLE_X86
+    if (kernel == Kernel::Avx2 && kernelSupported(kernel)) {
+        Lanes l{};
+        if (count > 0) l.doubleRounds = streams[0].st->doubleRounds;
+        size_t next = 0;
+        for (;;) {
+            // refill idle lanes; long streams already fill the vectors on their own
+            for (int k = 0; k < 8; ++k) {
+                while (l.left[k] == 0 && next < count) {
+                    const Stream& s = streams[next++];
+                    if (s.len > kLaneMaxBytes || s.st->doubleRounds != l.doubleRounds) {
+                        xorStream(kernel, *s.st, s.in, s.out, s.len);
+                        continue;
+                    }
+                    for (int i = 0; i < 16; ++i) l.words[i][k] = s.st->w[i];
+                    l.in[k] = s.in; l.out[k] = s.out; l.left[k] = s.len;
+                }
+            }
+            int active = 0;
+            size_t maxBlocks = 0;
+            for (int k = 0; k < 8; ++k) {
+                if (l.left[k] == 0) continue;
+                ++active;
+                maxBlocks = std::max(maxBlocks, (l.left[k] + kBlock - 1) / kBlock);
+            }
+            if (active == 0) return;
+            // draining: a few lanes with several blocks left are cheaper one stream at a time
+            if (next == count && static_cast<size_t>(active) < maxBlocks) {
+                for (int k = 0; k < 8; ++k) {
+                    if (l.left[k] == 0) continue;
+                    State st;
+                    for (int i = 0; i < 16; ++i) st.w[i] = l.words[i][k];
+                    st.doubleRounds = l.doubleRounds;
+                    xorStream(kernel, st, l.in[k], l.out[k], l.left[k]);
+                }
+                return;
+            }
+            avx2LanesStep(l);
+        }
+    }
+#endif
+    for (size_t i = 0; i < count; ++i) xorStream(kernel, *streams[i].st, streams[i].in, streams[i].out, streams[i].len);
+}
+
+bool selfTest() {
+    if (mbedtls_chacha20_self_test(0) != 0) return false;
+
+    // the RFC 8439 test keys / nonces / counters of mbedtls_chacha20_self_test()
+    uint8_t key[2][32] = {};
+    uint8_t nonce[2][12] = {};
+    key[1][31] = 0x01;
+    nonce[1][11] = 0x02;
+    const uint32_t counters[] = { 0, 1, 0xFFFFFFFEu };     // the last one wraps inside a pass
+
+    std::vector<uint8_t> in(2048 + 64), ref(in.size()), got(in.size() + 16);
+    for (size_t i = 0; i < in.size(); ++i) in[i] = static_cast<uint8_t>(i * 31 + 7);
+    for (Kernel k : { Kernel::Scalar, Kernel::Sse2, Kernel::Avx2 }) {
+        if (!kernelSupported(k)) continue;
+        for (int v = 0; v < 2; ++v) {
+            for (uint32_t counter : counters) {
+                const State st = makeState(key[v], nonce[v], counter);
+                for (size_t len = 0; len <= in.size(); len += (len < 600 ? 1 : 61)) {
+                    mbedtls_chacha20_crypt(key[v], nonce[v], counter, len, in.data(), ref.data());
+                    xorStream(k, st, in.data(), got.data(), len);
+                    if (!std::equal(ref.begin(), ref.begin() + len, got.begin())) return false;
+                    // in place
+                    std::copy(in.begin(), in.begin() + len, got.begin());
+                    xorStream(k, st, got.data(), got.data(), len);
+                    if (!std::equal(ref.begin(), ref.begin() + len, got.begin())) return false;
+                    // output 16 bytes before the input, like a tag-first packet decrypted in place
+                    std::copy(in.begin(), in.begin() + len, got.begin() + 16);
+                    xorStream(k, st, got.data() + 16, got.data(), len);
+                    if (!std::equal(ref.begin(), ref.begin() + len, got.begin())) return false;
+                }
+            }
+        }
+    }
+
+    // multi-buffer: ragged streams of different keys, nonces and counters (one wraps)
+    constexpr size_t kStreams = 37;
+    std::vector<State> states(kStreams);
+    std::vector<Stream> streams(kStreams);
+    std::vector<std::vector<uint8_t>> refs(kStreams), bufs(kStreams);
+    std::vector<uint8_t> k32(32), n12(12);
+    uint32_t seed = 0x13579bdf;
+    auto next = [&seed]() { return seed = seed * 1664525 + 1013904223; };
+    for (size_t i = 0; i < kStreams; ++i) {
+        for (auto& b : k32) b = static_cast<uint8_t>(next() >> 24);
+        for (auto& b : n12) b = static_cast<uint8_t>(next() >> 24);
+        const uint32_t counter = i == 5 ? 0xFFFFFFFEu : next() >> 8;
+        const size_t len = i % 9 == 0 ? 600 + next() % 500 : next() % (kLaneMaxBytes + 1);
+        states[i] = makeState(k32.data(), n12.data(), counter);
+        refs[i].resize(len);
+        mbedtls_chacha20_crypt(k32.data(), n12.data(), counter, len, in.data(), refs[i].data());
+    }
+    for (Kernel k : { Kernel::Scalar, Kernel::Sse2, Kernel::Avx2 }) {
+        if (!kernelSupported(k)) continue;
+        // separate output, in place, output 16 bytes before the input
+        for (int mode = 0; mode < 3; ++mode) {
+            for (size_t i = 0; i < kStreams; ++i) {
+                const size_t len = refs[i].size();
+                bufs[i].assign(2 * len + 16, 0);
+                std::copy(in.begin(), in.begin() + len, bufs[i].begin() + 16);
+                uint8_t* out = mode == 0 ? bufs[i].data() + 16 + len : bufs[i].data() + (mode == 1 ? 16 : 0);
+                streams[i] = { &states[i], bufs[i].data() + 16, out, len };
+            }
+            xorStreams(k, streams.data(), kStreams);
+            for (size_t i = 0; i < kStreams; ++i) {
+                if (!std::equal(refs[i].begin(), refs[i].end(), streams[i].out)) return false;
+            }
+        }
+    }
+
+    // ChaCha8 / ChaCha12: first keystream bytes of the all-zero key and nonce at counter 0
+    // (draft-strombergson-chacha-test-vectors TC1, same words as the 96-bit nonce layout)
+    const uint8_t zeros[32] = {};
+    const struct { int rounds; uint8_t ks[16]; } reduced[] = {
+        { 8,  { 0x3e, 0x00, 0xef, 0x2f, 0x89, 0x5f, 0x40, 0xd6, 0x7f, 0x5b, 0xb8, 0xe8, 0x1f, 0x09, 0xa5, 0xa1 } },
+        { 12, { 0x9b, 0xf4, 0x9a, 0x6a, 0x07, 0x55, 0xf9, 0x53, 0x81, 0x1f, 0xce, 0x12, 0x5f, 0x26, 0x83, 0xd5 } },
+    };
+    for (auto const& v : reduced) {
+        uint8_t ks[16];
+        xorStream(Kernel::Scalar, makeState(zeros, zeros, 0, v.rounds), zeros, ks, sizeof(ks));
+        if (!std::equal(ks, ks + sizeof(ks), v.ks)) return false;
+        // every kernel against the scalar one, whole passes and tails
+        const State st = makeState(key[1], nonce[1], 1, v.rounds);
+        for (Kernel k : { Kernel::Sse2, Kernel::Avx2 }) {
+            if (!kernelSupported(k)) continue;
+            for (size_t len = 0; len <= 1100; len += (len < 600 ? 1 : 61)) {
+                xorStream(Kernel::Scalar, st, in.data(), ref.data(), len);
+                xorStream(k, st, in.data(), got.data(), len);
+                if (!std::equal(ref.begin(), ref.begin() + len, got.begin())) return false;
+            }
+        }
+    }
+    // multi-buffer with 20, 12 and 8 rounds mixed in one call
+    for (size_t i = 0; i < kStreams; ++i) {
+        states[i].doubleRounds = i % 3 == 0 ? 10 : i % 3 == 1 ? 6 : 4;
+        xorStream(Kernel::Scalar, states[i], in.data(), refs[i].data(), refs[i].size());
+    }
+    for (Kernel k : { Kernel::Sse2, Kernel::Avx2 }) {
+        if (!kernelSupported(k)) continue;
+        for (size_t i = 0; i < kStreams; ++i) {
+            bufs[i].assign(refs[i].size(), 0);
+            streams[i] = { &states[i], in.data(), bufs[i].data(), refs[i].size() };
+        }
+        xorStreams(k, streams.data(), kStreams);
+        for (size_t i = 0; i < kStreams; ++i) {
+            if (!std::equal(refs[i].begin(), refs[i].end(), bufs[i].begin())) return false;
+        }
+    }
+
+    // HChaCha20, draft-irtf-cfrg-xchacha section 2.2.1
+    uint8_t hkey[32], hnonce[16] = { 0, 0, 0, 0x09, 0, 0, 0, 0x4a, 0, 0, 0, 0, 0x31, 0x41, 0x59, 0x27 };
+    for (int i = 0; i < 32; ++i) hkey[i] = static_cast<uint8_t>(i);
+    const uint8_t hexpected[32] = {
+        0x82, 0x41, 0x3b, 0x42, 0x27, 0xb2, 0x7b, 0xfe, 0xd3, 0x0e, 0x42, 0x50, 0x8a, 0x87, 0x7d, 0x73,
+        0xa0, 0xf9, 0xe4, 0xd5, 0x8a, 0x74, 0xa8, 0x53, 0xc1, 0x2e, 0xc4, 0x13, 0x26, 0xd3, 0xec, 0xdc,
+    };
+    uint8_t subkey[32];
+    hchacha20(hkey, hnonce, subkey);
+    return std::equal(subkey, subkey + 32, hexpected);
+}
+
+} // namespace ChaCha20
@@ -0,0 +1,83 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef CHACHA20_SIMD_H
+#define CHACHA20_SIMD_H
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// ChaCha20 (RFC 8439) keystream in the project's crypto layer: a scalar kernel plus
+/// SSE2 (4 blocks per pass) and AVX2 (8 blocks per pass) kernels, picked at runtime from
+/// cpuFeatures(). All kernels produce the same bytes as mbedtls_chacha20_crypt(); the
+/// vendored mbedTLS stays untouched (no MBEDTLS_CHACHA20_ALT), CryptoEngine calls this.
+/// The reduced-round ChaCha12 / ChaCha8 run through the same kernels (State::doubleRounds).
+namespace ChaCha20 {
+
+enum class Kernel : uint8_t { Scalar, Sse2, Avx2 };
+
+const char* kernelName(Kernel kernel);
+bool kernelSupported(Kernel kernel);
+
+/// Best kernel of this CPU
+Kernel bestKernel();
+
+/// Kernel xorStream() uses: bestKernel() unless forced
+Kernel activeKernel();
+
+/// Forces a kernel (benchmarks, cross-checks); an unsupported one means Scalar
+void forceKernel(Kernel kernel);
+void resetKernel();
+
+/// Cipher input block: constants, key, block counter (word 12), nonce
+struct State {
+    uint32_t w[16];
+    uint32_t doubleRounds = 10;     ///< 10 = ChaCha20, 6 = ChaCha12, 4 = ChaCha8
+};
+
+/// @param rounds  20, 12 or 8
+State makeState(const uint8_t key[32], const uint8_t nonce[12], uint32_t counter, int rounds = 20);
+
+/// HChaCha20 (draft-irtf-cfrg-xchacha): the 256-bit subkey of XChaCha20 from the key and
+/// the first 16 bytes of its 24-byte nonce
+void hchacha20(const uint8_t key[32], const uint8_t nonce[16], uint8_t subkey[32]);
+
+/// Replaces the nonce words, key and counter stay
+void setNonce(State& st, const uint8_t nonce[12]);
+
+/// out = in XOR keystream, starting at block st.w[12]; out may equal in or start before it
+void xorStream(const State& st, const uint8_t* in, uint8_t* out, size_t len);
+void xorStream(Kernel kernel, const State& st, const uint8_t* in, uint8_t* out, size_t len);
+
+/// One stream of xorStreams(): out = in XOR keystream from st's key, nonce and counter
+struct Stream {
+    const State*   st;
+    const uint8_t* in;
+    uint8_t*       out;
+    size_t         len;
+};
+
+/// Streams longer than this skip the lanes, a single stream fills the AVX2 kernel from 512 B
+constexpr size_t kLaneMaxBytes = 448;
+
+/// Multi-buffer xorStream() over independent streams (packets). With AVX2 each lane of the
+/// 8-block kernel carries a different stream, so 8 short packets cost one pass per block
+/// instead of one pass each; ragged lengths are masked per lane and a finished lane is
+/// refilled from the queue. The lanes take the first stream's round count, streams with
+/// another one go on their own. Other kernels run the streams one after the other.
+/// Streams must not overlap each other; within a stream out may equal in or start before it.
+void xorStreams(const Stream* streams, size_t count);
+void xorStreams(Kernel kernel, const Stream* streams, size_t count);
+
+/// mbedtls_chacha20_self_test() (the RFC 8439 vectors) for the reference, then every
+/// supported kernel against it on the RFC keys/nonces for 0 … 2 kB and across a counter wrap,
+/// and xorStreams() on ragged streams of different states. ChaCha12 / ChaCha8 against their
+/// zero-key vectors and every kernel against the scalar one, HChaCha20 against the draft's.
+/// @return false on the first mismatch
+bool selfTest();
+
+} // namespace ChaCha20
+
+#endif //CHACHA20_SIMD_H
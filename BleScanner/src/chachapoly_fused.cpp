@@ -0,0 +1,113 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "chachapoly_fused.h"
+#include "aead_tag.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <mbedtls/chachapoly.h>
+
+namespace ChaChaPoly {
+
+namespace {
+
+constexpr size_t kBlock = 64;
+
+/// Poly1305 key of block 0 of st's key/nonce
+void polyKeyOf(const ChaCha20::State& st, uint8_t polyKey[32]) {
+    ChaCha20::State s = st;
+    s.w[12] = 0;
+    std::memset(polyKey, 0, 32);
+    ChaCha20::xorStream(s, polyKey, polyKey, 32);
+}
+
+} // namespace
+
+bool decrypt(const ChaCha20::State& st, const uint8_t tag[16], const uint8_t* ct, size_t len, uint8_t* out,
+             size_t tile) {
+    // in place the first tile's plaintext lands on the tag
+    uint8_t expected[16];
+    std::memcpy(expected, tag, sizeof(expected));
+
+    uint8_t polyKey[32];
+    polyKeyOf(st, polyKey);
+    Poly1305::Mac mac(polyKey);
+
+    // MAC a tile, then decrypt it while it is still cached; the last tile may be partial
+    tile = tile == 0 ? std::max<size_t>(len, kBlock) : std::max(tile / kBlock * kBlock, kBlock);
+    ChaCha20::State s = st;
+    s.w[12] = 1;
+    for (size_t off = 0; off < len; off += tile) {
+        const size_t n = std::min(tile, len - off);
+        mac.update(ct + off, n);
+        ChaCha20::xorStream(s, ct + off, out + off, n);
+        s.w[12] += static_cast<uint32_t>(n / kBlock);
+    }
+
+    uint8_t computed[16];
+    AeadTag::finishPoly1305(mac, len, computed);
+    if (AeadTag::equal(computed, expected, sizeof(expected))) return true;
+    if (len > 0) std::memset(out, 0, len);
+    return false;
+}
+
+bool verify(const ChaCha20::State& st, const uint8_t tag[16], const uint8_t* ct, size_t len) {
+    uint8_t polyKey[32];
+    polyKeyOf(st, polyKey);
+    Poly1305::Mac mac(polyKey);
+    mac.update(ct, len);
+    uint8_t computed[16];
+    AeadTag::finishPoly1305(mac, len, computed);
+    return AeadTag::equal(computed, tag, 16);
+}
+
+bool selfTest() {
+    uint32_t seed = 0x2468ace1;
+    auto next = [&seed]() { return static_cast<uint8_t>((seed = seed * 1664525 + 1013904223) >> 24); };
+    uint8_t key[32], nonce[12];
+    for (auto& b : key) b = next();
+    for (auto& b : nonce) b = next();
+    const ChaCha20::State st = ChaCha20::makeState(key, nonce, 0);
+
+    mbedtls_chachapoly_context ctx;
+    mbedtls_chachapoly_init(&ctx);
+    mbedtls_chachapoly_setkey(&ctx, key);
+
+    constexpr size_t kMax = 20000;
+    std::vector<uint8_t> plain(kMax), packet(16 + kMax), out(kMax);
+    for (auto& b : plain) b = next();
+    const size_t tiles[] = { 0, 64, 1024, kTileBytes };
+    bool ok = true;
+    for (size_t len = 0; len <= kMax && ok; len += (len < 300 ? 1 : 397)) {
+        // tag-first packet like request 0x02
+        mbedtls_chachapoly_encrypt_and_tag(&ctx, len, nonce, nullptr, 0, plain.data(), packet.data() + 16,
+                                           packet.data());
+        if (!verify(st, packet.data(), packet.data() + 16, len)) { ok = false; break; }
+        for (size_t tile : tiles) {
+            if (!decrypt(st, packet.data(), packet.data() + 16, len, out.data(), tile) ||
+                !std::equal(plain.begin(), plain.begin() + len, out.begin())) { ok = false; break; }
+
+            // in place onto the packet's own buffer, then restore the packet
+            std::vector<uint8_t> copy(packet.begin(), packet.begin() + 16 + len);
+            if (!decrypt(st, copy.data(), copy.data() + 16, len, copy.data(), tile) ||
+                !std::equal(plain.begin(), plain.begin() + len, copy.begin())) { ok = false; break; }
+
+            // forged tag: rejected and nothing readable left behind
+            packet[len % 16] ^= 0x01;
+            const bool forged = decrypt(st, packet.data(), packet.data() + 16, len, out.data(), tile) ||
+                                verify(st, packet.data(), packet.data() + 16, len);
+            packet[len % 16] ^= 0x01;
+            if (forged || std::any_of(out.begin(), out.begin() + len, [](uint8_t b) { return b != 0; })) {
+                ok = false;
+                break;
+            }
+        }
+    }
+    mbedtls_chachapoly_free(&ctx);
+    return ok;
+}
+
+} // namespace ChaChaPoly
@@ -0,0 +1,40 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef CHACHAPOLY_FUSED_H
+#define CHACHAPOLY_FUSED_H
+#pragma once
+
+#include "chacha20_simd.h"
+#include <cstddef>
+#include <cstdint>
+
+/// ChaCha20-Poly1305 (RFC 8439, no AAD) decryption in one sweep: each tile of ciphertext is
+/// fed to Poly1305 and then decrypted while it is still in L1, instead of one MAC pass and
+/// one cipher pass over the whole buffer. Uses whatever ChaCha20 / Poly1305 kernels are active.
+namespace ChaChaPoly {
+
+/// Bytes per tile; a multiple of the 64-byte ChaCha20 block and large enough for the
+/// AVX2 Poly1305 kernel (1 kB)
+constexpr size_t kTileBytes = 4096;
+
+/// Checks tag and decrypts ct into out (out may equal ct or start before it, e.g. on the tag).
+/// Block 0 of st's key/nonce keys Poly1305 and the data starts at block 1; st's counter word
+/// is ignored. On a tag mismatch out is zeroed. tile = 0 runs the two passes one after the other.
+/// @return true when the tag matched
+bool decrypt(const ChaCha20::State& st, const uint8_t tag[16], const uint8_t* ct, size_t len, uint8_t* out,
+             size_t tile = kTileBytes);
+
+/// Checks tag without producing plaintext: the Poly1305 key from block 0, then one MAC pass
+/// @return true when the tag matched
+bool verify(const ChaCha20::State& st, const uint8_t tag[16], const uint8_t* ct, size_t len);
+
+/// Against mbedtls_chachapoly_auth_decrypt() for 0 … 20 kB with several tile sizes,
+/// in place, and with a forged tag (verify() too)
+/// @return false on the first mismatch
+bool selfTest();
+
+} // namespace ChaChaPoly
+
+#endif //CHACHAPOLY_FUSED_H
@@ -0,0 +1,124 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef CIPHER_SUITES_H
+#define CIPHER_SUITES_H
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/// Where a suite's tag (or CRC) sits in an FE44 packet
+enum class TagPosition : uint8_t {
+    None,       ///< no tag, the packet is all ciphertext
+    Front,      ///< tag || ciphertext
+    Back        ///< ciphertext || tag
+};
+
+/// What the host needs to know about one request type, fixed at compile time
+struct CipherSuite {
+    uint8_t          code;          ///< request type byte of the FE43 frame
+    const char*      name;          ///< shown in the GUI and the bench
+    TagPosition      tagPosition;
+    uint8_t          tagBytes;      ///< Poly1305 / GCM tag, CRC32C
+    uint8_t          nonceBytes;    ///< 0 for the plaintext baseline
+
+    /// Plaintext length of a packet of this suite (0 if it is too short for the tag)
+    constexpr size_t plainLength(size_t packetBytes) const {
+        return packetBytes >= tagBytes ? packetBytes - tagBytes : 0;
+    }
+};
+
+//––– Suites –––//
+// One policy type per suite: its descriptor, and the tag CryptoEngine's private open() /
+// authentic() / openBatch() overload on; the public decrypt<Suite>() / verify<Suite>() /
+// decryptBatch<Suite>() templates dispatch to those.
+
+struct ChaCha20Suite {
+    static constexpr CipherSuite info{ 0x01, "ChaCha20", TagPosition::None, 0, 12 };
+};
+/// Reduced-round ChaCha (same key, nonce and counter as 0x01), unauthenticated like it
+struct ChaCha12Suite {
+    static constexpr CipherSuite info{ 0x04, "ChaCha12", TagPosition::None, 0, 12 };
+};
+struct ChaCha8Suite {
+    static constexpr CipherSuite info{ 0x05, "ChaCha8", TagPosition::None, 0, 12 };
+};
+struct ChaChaPolySuite {
+    static constexpr CipherSuite info{ 0x02, "ChaCha20-Poly1305", TagPosition::Front, 16, 12 };
+};
+/// ChaCha20-Poly1305 under the HChaCha20 subkey of KEY and XNONCE, tag first like 0x02
+struct XChaChaPolySuite {
+    static constexpr CipherSuite info{ 0x06, "XChaCha20-Poly1305", TagPosition::Front, 16, 24 };
+};
+struct AesGcmSuite {
+    static constexpr CipherSuite info{ 0x03, "AES-GCM", TagPosition::Back, 16, 12 };
+};
+/// AES-GCM with the first 16 bytes of KEY
+struct AesGcm128Suite {
+    static constexpr CipherSuite info{ 0x07, "AES-128-GCM", TagPosition::Back, 16, 12 };
+};
+/// AES-256-CCM (mbedTLS ccm.c), 16-byte tag last
+struct AesCcmSuite {
+    static constexpr CipherSuite info{ 0x08, "AES-CCM", TagPosition::Back, 16, 12 };
+};
+/// Link-only baseline, no cipher on either side
+struct PlainCrcSuite {
+    static constexpr CipherSuite info{ 0x00, "Plaintext (CRC32C)", TagPosition::Back, 4, 0 };
+};
+
+/// A compile-time list of suites: their descriptors in list order, and a one-off dispatch
+/// from a runtime code to the suite's type
+template <class... Suites>
+struct SuiteList {
+    static constexpr size_t size = sizeof...(Suites);
+    static constexpr std::array<CipherSuite, size> infos{ Suites::info... };
+
+    /// Position of Suite in the list (also its CryptoCounters slot)
+    template <class Suite>
+    static constexpr size_t indexOf() {
+        size_t i = 0;
+        ((Suites::info.code == Suite::info.code ? false : (++i, true)) && ...);
+        return i;
+    }
+
+    /// Calls f(Suite{}) for the suite with that code
+    /// @return false if no suite has it
+    template <class F>
+    static constexpr bool visit(uint8_t code, F&& f) {
+        return ((Suites::info.code == code ? (f(Suites{}), true) : false) || ...);
+    }
+};
+
+/// The registry, in GUI order. A new suite is a policy type above plus an entry here (and its
+/// CryptoEngine::open() / authentic() overloads; openBatch() falls back to open() per packet).
+using CipherSuites = SuiteList<ChaCha20Suite, ChaCha12Suite, ChaCha8Suite,
+                               ChaChaPolySuite, XChaChaPolySuite,
+                               AesGcmSuite, AesGcm128Suite, AesCcmSuite,
+                               PlainCrcSuite>;
+
+inline constexpr const std::array<CipherSuite, CipherSuites::size>& kCipherSuites = CipherSuites::infos;
+
+/// Registry index of a request type, CipherSuites::size if there is none
+constexpr size_t suiteIndex(uint8_t code) {
+    size_t i = 0;
+    while (i < kCipherSuites.size() && kCipherSuites[i].code != code) ++i;
+    return i;
+}
+
+/// Descriptor of a request type, nullptr if there is none
+constexpr const CipherSuite* findSuite(uint8_t code) {
+    const size_t i = suiteIndex(code);
+    return i < kCipherSuites.size() ? &kCipherSuites[i] : nullptr;
+}
+
+static_assert([] {
+    for (size_t i = 0; i < kCipherSuites.size(); ++i)
+        if (suiteIndex(kCipherSuites[i].code) != i) return false;
+    return true;
+}(), "request type codes must be unique");
+static_assert(CipherSuites::indexOf<AesGcmSuite>() == suiteIndex(AesGcmSuite::info.code));
+
+#endif //CIPHER_SUITES_H
@@ -0,0 +1,92 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "ciphertext_log.h"
+#include "constants.h"
+
+#include <algorithm>
+#include <array>
+
+void CiphertextLog::reset(uint8_t requestType) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _requestType = requestType;
+    _bytes.clear();
+    _lengths.clear();
+    _decrypted  = 0;
+    _plainBytes = 0;
+}
+
+void CiphertextLog::reserve(size_t bytes, size_t packets) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _bytes.reserve(bytes);
+    _lengths.reserve(packets);
+}
+
+void CiphertextLog::append(std::span<const uint8_t> packet) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const size_t overhead = AppConstants::responseOverhead(_requestType);
+    _bytes.insert(_bytes.end(), packet.begin(), packet.end());
+    _lengths.push_back(static_cast<uint32_t>(packet.size()));
+    _plainBytes += packet.size() > overhead ? packet.size() - overhead : 0;
+}
+
+size_t CiphertextLog::packets() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _decrypted + _lengths.size();
+}
+
+size_t CiphertextLog::pending() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _lengths.size();
+}
+
+uint64_t CiphertextLog::plainBytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _plainBytes;
+}
+
+BatchResult CiphertextLog::decryptPending(CryptoEngine& crypto, const PlainSink& sink) {
+    // take the pending packets, the writer goes on appending to fresh vectors meanwhile
+    std::vector<uint8_t>  bytes;
+    std::vector<uint32_t> lengths;
+    uint8_t requestType = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        bytes.swap(_bytes);
+        lengths.swap(_lengths);
+        _decrypted += lengths.size();
+        requestType = _requestType;
+    }
+
+    BatchResult total;
+    crypto.init(requestType);
+    // in place, packet by packet the plaintext starts where its ciphertext did
+    constexpr size_t kBatch = 64;
+    std::array<BatchPacket, kBatch> batch;
+    size_t at = 0;
+    for (size_t first = 0; first < lengths.size(); first += kBatch) {
+        const size_t n = std::min(kBatch, lengths.size() - first);
+        for (size_t i = 0; i < n; ++i) {
+            const std::span<uint8_t> packet(bytes.data() + at, lengths[first + i]);
+            batch[i] = { packet, packet, {} };
+            at += packet.size();
+        }
+        auto r = crypto.decryptBatch(std::span<BatchPacket>(batch.data(), n));
+        total.ok             += r.ok;
+        total.failed         += r.failed;
+        total.plaintextBytes += r.plaintextBytes;
+        total.ms             += r.ms;
+        for (size_t i = 0; i < n; ++i) {
+            if (batch[i].result) sink(batch[i].out.first(batch[i].result.length));
+        }
+    }
+
+    // hand the (larger) buffers back unless the writer started new ones meanwhile
+    bytes.clear();
+    lengths.clear();
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_bytes.empty() && _bytes.capacity() < bytes.capacity()) _bytes.swap(bytes);
+    if (_lengths.empty() && _lengths.capacity() < lengths.capacity()) _lengths.swap(lengths);
+    return total;
+}
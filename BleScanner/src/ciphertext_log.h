@@ -0,0 +1,54 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef CIPHERTEXT_LOG_H
+#define CIPHERTEXT_LOG_H
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+#include "crypto.h"
+
+/// Received packets kept as ciphertext for DecryptMode::Lazy: the notification handler only
+/// appends a copy, and the packets are decrypted when someone wants the plaintext (the GUI's
+/// message box, an export, the bench's final check). One writer and one reader thread.
+class CiphertextLog {
+public:
+    /// Plaintext of one packet, in arrival order; the span is valid during the call
+    using PlainSink = std::function<void(std::span<const uint8_t>)>;
+
+    /// Drops everything and starts a log of requestType packets
+    void reset(uint8_t requestType);
+    /// Preallocates for about that many packet bytes in that many packets (bytes / word size + 1),
+    /// so append() doesn't grow on the hot path
+    void reserve(size_t bytes, size_t packets);
+
+    /// Copies a packet (ciphertext [+ tag]) to the end of the log
+    void append(std::span<const uint8_t> packet);
+
+    size_t packets() const;
+    /// Packets not yet passed to decryptPending()
+    size_t pending() const;
+    /// Plaintext bytes the logged packets will give (tags excluded)
+    uint64_t plainBytes() const;
+
+    /// Decrypts the pending packets with crypto (in batches, see CryptoEngine::decryptBatch())
+    /// and hands each plaintext to sink; failed packets are counted and skipped. Appending
+    /// may go on meanwhile, those packets wait for the next call.
+    BatchResult decryptPending(CryptoEngine& crypto, const PlainSink& sink);
+
+private:
+    mutable std::mutex    _mutex;
+    uint8_t               _requestType = 0;
+    std::vector<uint8_t>  _bytes;           ///< pending packets back to back
+    std::vector<uint32_t> _lengths;         ///< of every pending packet
+    size_t                _decrypted  = 0;  ///< packets already handed out
+    uint64_t              _plainBytes = 0;
+};
+
+#endif //CIPHERTEXT_LOG_H
@@ -0,0 +1,155 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "clock_sync.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+void ClockSync::reset() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _samples.clear();
+    _stats = ClockSyncStats{};
+    _base = clock::time_point{};
+    _mcuBase = 0.0;
+}
+
+double ClockSync::hostUsLocked(clock::time_point t) const {
+    return std::chrono::duration<double, std::micro>(t - _base).count();
+}
+
+double ClockSync::unwrapLocked(uint32_t mcuUs, double hostUs) const {
+    const double predicted = hostUs + _stats.offsetUs + _stats.driftPpm * 1e-6 * hostUs;
+    const auto predictedRaw = static_cast<uint32_t>(static_cast<uint64_t>(std::llround(_mcuBase + predicted)));
+    const auto diff = static_cast<int32_t>(mcuUs - predictedRaw);
+    return predicted + diff;
+}
+
+void ClockSync::addExchange(clock::time_point t1, uint32_t t2, uint32_t t3, clock::time_point t4) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_samples.empty()) {
+        _base = t1;
+        _mcuBase = t2;
+    }
+    const double h1 = hostUsLocked(t1);
+    const double h4 = hostUsLocked(t4);
+    const double m2 = unwrapLocked(t2, h1);
+    const double m3 = m2 + static_cast<int32_t>(t3 - t2);
+
+    ClockSample s;
+    s.hostUs   = (h1 + h4) / 2.0;
+    s.offsetUs = ((m2 - h1) + (m3 - h4)) / 2.0;
+    s.delayUs  = (h4 - h1) - (m3 - m2);
+    _samples.push_back(s);
+    fitLocked();
+}
+
+void ClockSync::fitLocked() {
+    ClockSyncStats st;
+    st.samples = static_cast<uint32_t>(_samples.size());
+    if (_samples.empty()) { _stats = st; return; }
+
+    st.minDelayUs = std::min_element(_samples.begin(), _samples.end(),
+                                     [](auto const& a, auto const& b) { return a.delayUs < b.delayUs; })->delayUs;
+    // samples that waited in a queue somewhere have a larger delay and a skewed offset (by up
+    // to half the extra delay), probes sent mid-transfer queue behind data notifications. The
+    // band sits on the 10th percentile, a single stamp taken late would drag the minimum down
+    std::vector<double> delays;
+    delays.reserve(_samples.size());
+    for (auto const& s : _samples) delays.push_back(s.delayUs);
+    std::nth_element(delays.begin(), delays.begin() + delays.size() / 10, delays.end());
+    const double lowDelay = delays[delays.size() / 10];
+    auto admitted = [&](ClockSample const& s) { return std::abs(s.delayUs - lowDelay) <= DELAY_SLACK_US; };
+
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0, first = 0, last = 0;
+    for (auto const& s : _samples) {
+        if (!admitted(s)) continue;
+        if (n == 0) first = s.hostUs;
+        last = s.hostUs;
+        n   += 1;
+        sx  += s.hostUs;
+        sy  += s.offsetUs;
+        sxx += s.hostUs * s.hostUs;
+        sxy += s.hostUs * s.offsetUs;
+    }
+    st.used   = static_cast<uint32_t>(n);
+    st.spanUs = last - first;
+
+    double slope = 0.0, intercept = sy / n;
+    const double det = n * sxx - sx * sx;
+    // drift needs samples spread over time, a single burst only gives the offset
+    if (n >= 3 && st.spanUs >= MIN_DRIFT_SPAN_US && det > 0.0) {
+        slope     = (n * sxy - sx * sy) / det;
+        intercept = (sy - slope * sx) / n;
+        double sq = 0.0;
+        for (auto const& s : _samples) {
+            if (!admitted(s)) continue;
+            const double r = s.offsetUs - (intercept + slope * s.hostUs);
+            sq += r * r;
+        }
+        // standard error of the slope, det / n is Σ(x − x̄)²
+        st.driftErrPpm = std::sqrt(sq / (n - 2) / (det / n)) * 1e6;
+        st.driftValid  = st.driftErrPpm <= MAX_DRIFT_ERR_PPM;
+        if (!st.driftValid) {
+            slope     = 0.0;
+            intercept = sy / n;
+        }
+    }
+    st.offsetUs = intercept;
+    st.driftPpm = slope * 1e6;
+
+    double sq = 0.0;
+    for (auto const& s : _samples) {
+        if (!admitted(s)) continue;
+        const double r = s.offsetUs - (intercept + slope * s.hostUs);
+        sq += r * r;
+    }
+    st.residualUs = std::sqrt(sq / n);
+    _stats = st;
+}
+
+bool ClockSync::valid() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return !_samples.empty();
+}
+
+ClockSync::clock::time_point ClockSync::toHost(uint32_t mcuUs, clock::time_point near) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const double m = unwrapLocked(mcuUs, hostUsLocked(near));
+    const double b = _stats.driftPpm * 1e-6;
+    const double h = (m - _stats.offsetUs) / (1.0 + b);
+    return _base + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::micro>(h));
+}
+
+double ClockSync::mcuToHostUs(double mcuIntervalUs) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return mcuIntervalUs / (1.0 + _stats.driftPpm * 1e-6);
+}
+
+ClockSyncStats ClockSync::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ClockSyncStats st = _stats;
+    st.offsetUs += _mcuBase;    // the fit works relative to the first MCU stamp
+    return st;
+}
+
+std::vector<ClockSample> ClockSync::samples() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _samples;
+}
+
+std::string describeDrift(const ClockSyncStats& st) {
+    char buf[64];
+    if (st.driftValid) {
+        std::snprintf(buf, sizeof(buf), "%.2f ±%.2f ppm", st.driftPpm, st.driftErrPpm);
+    } else if (st.spanUs < ClockSync::MIN_DRIFT_SPAN_US) {
+        std::snprintf(buf, sizeof(buf), "n/a (%.0f ms span, needs %.0f)", st.spanUs / 1000.0,
+                      ClockSync::MIN_DRIFT_SPAN_US / 1000.0);
+    } else if (st.driftErrPpm > 0.0) {
+        std::snprintf(buf, sizeof(buf), "n/a (fit ±%.1f ppm, needs ±%.0f)", st.driftErrPpm, ClockSync::MAX_DRIFT_ERR_PPM);
+    } else {
+        std::snprintf(buf, sizeof(buf), "n/a (%u low-delay samples)", st.used);
+    }
+    return buf;
+}
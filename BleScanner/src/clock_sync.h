@@ -0,0 +1,88 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// One NTP-style exchange: host send t1, MCU receive t2, MCU reply t3, host receive t4
+struct ClockSample {
+    double hostUs   = 0.0;      ///< midpoint of t1 and t4, µs since the first exchange
+    double offsetUs = 0.0;      ///< MCU clock − host clock
+    double delayUs  = 0.0;      ///< round trip minus the MCU's turnaround
+};
+
+/// Result of the offset/drift fit
+struct ClockSyncStats {
+    uint32_t samples    = 0;
+    uint32_t used       = 0;        ///< low-delay samples the fit is based on
+    double   minDelayUs = 0.0;
+    double   offsetUs   = 0.0;      ///< MCU clock − host clock, host clock counted from the first exchange
+    double   driftPpm    = 0.0;     ///< MCU clock rate − host clock rate, 0 unless driftValid
+    double   driftErrPpm = 0.0;     ///< standard error of the drift fit, 0 if the span was too short to fit
+    double   spanUs      = 0.0;     ///< host time between the first and the last used sample
+    bool     driftValid  = false;   ///< span and standard error within ClockSync's limits, driftPpm is a fit
+    double   residualUs = 0.0;      ///< RMS of the used samples around the fit, ~ sync accuracy
+};
+
+/// "41.20 ±1.30 ppm", or "n/a (…)" with the reason the drift wasn't fitted
+std::string describeDrift(const ClockSyncStats& st);
+
+/// Host ↔ MCU clock offset and drift from NTP-style exchanges. The MCU clock is a free
+/// running 32-bit µs counter (wraps every ~71 min), MCU timestamps are unwrapped against
+/// the current estimate. Only the samples near the lowest round-trip delay go into the
+/// linear fit offset(t) = offset0 + drift·t, the others carry queueing noise.
+/// Thread safe.
+class ClockSync {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// Shorter spans leave the slope to the host's scheduling jitter (±10 µs per sample)
+    static constexpr double MIN_DRIFT_SPAN_US = 500000.0;
+    /// A fit with a larger standard error is reported as no drift
+    static constexpr double MAX_DRIFT_ERR_PPM = 10.0;
+    /// Samples further than this from the low (10th percentile) round-trip delay stay out of the fit
+    static constexpr double DELAY_SLACK_US    = 25.0;
+
+    void reset();
+
+    /// Adds an exchange
+    /// @param t1 host time the sync request was written
+    /// @param t2 MCU time it was received
+    /// @param t3 MCU time the reply was sent
+    /// @param t4 host time the reply arrived
+    void addExchange(clock::time_point t1, uint32_t t2, uint32_t t3, clock::time_point t4);
+
+    /// true once there is at least one exchange
+    bool valid() const;
+
+    /// Host time at which the MCU clock read `mcuUs` (taken within ~35 min of `near`)
+    clock::time_point toHost(uint32_t mcuUs, clock::time_point near) const;
+
+    /// MCU clock interval in host µs (drift corrected)
+    double mcuToHostUs(double mcuIntervalUs) const;
+
+    ClockSyncStats stats() const;
+    std::vector<ClockSample> samples() const;
+
+private:
+    void fitLocked();
+    double hostUsLocked(clock::time_point t) const;
+    /// Unwraps a 32-bit MCU timestamp next to the MCU time predicted for host time hostUs
+    double unwrapLocked(uint32_t mcuUs, double hostUs) const;
+
+    mutable std::mutex       _mutex;
+    clock::time_point        _base{};         ///< host time of the first exchange
+    double                   _mcuBase = 0.0;  ///< unwrapped MCU µs of the first exchange's t2
+    std::vector<ClockSample> _samples;
+    ClockSyncStats           _stats{};
+};
+
+#endif //CLOCK_SYNC_H
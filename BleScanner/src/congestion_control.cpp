@@ -0,0 +1,138 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "congestion_control.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace {
+    double toMs(std::chrono::steady_clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    const char* eventName(PacingEvent ev) {
+        switch (ev) {
+            case PacingEvent::Start:        return "start";
+            case PacingEvent::Increase:     return "increase";
+            case PacingEvent::DecreaseLoss: return "loss";
+            case PacingEvent::DecreaseRtt:  return "rtt";
+        }
+        return "?";
+    }
+}
+
+CongestionController::CongestionController(PacingConfig cfg)
+    : _cfg(cfg) {
+    reset();
+}
+
+void CongestionController::reset(double startRateBps) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _rate   = (startRateBps > 0.0) ? startRateBps : _cfg.initialRateBps;
+    _rate   = std::clamp(_rate, _cfg.minRateBps, _cfg.maxRateBps);
+    _srtt   = 0.0;
+    _rttvar = 0.0;
+    _minRtt = 0.0;
+    _start  = _lastIncrease = _lastDecrease = clock::now();
+    _trajectory.clear();
+    _trajectory.reserve(1024);      // no growth on the notification thread in a normal run
+    recordLocked(_start, PacingEvent::Start);
+}
+
+void CongestionController::recordLocked(clock::time_point now, PacingEvent ev) {
+    _trajectory.push_back(PacingSample{ toMs(now - _start), _rate, _srtt, _minRtt, ev });
+}
+
+void CongestionController::decreaseLocked(clock::time_point now, PacingEvent why) {
+    // one reaction per congestion episode: its signals keep arriving for about two RTTs
+    // (the queue built up before the backoff drains first)
+    if (_srtt > 0.0 && toMs(now - _lastDecrease) < 2.0 * _srtt) return;
+    _rate = std::max(_cfg.minRateBps, _rate * _cfg.decreaseFactor);
+    _lastDecrease = _lastIncrease = now;
+    recordLocked(now, why);
+}
+
+void CongestionController::onAck(double rttMs, bool windowLimited) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto now = clock::now();
+
+    // RFC 6298 style smoothing
+    if (_srtt == 0.0) {
+        _srtt   = rttMs;
+        _rttvar = rttMs / 2.0;
+    } else {
+        _rttvar = 0.75 * _rttvar + 0.25 * std::fabs(_srtt - rttMs);
+        _srtt   = 0.875 * _srtt + 0.125 * rttMs;
+    }
+    if (_minRtt == 0.0 || rttMs < _minRtt) _minRtt = rttMs;
+
+    // the latest sample, srtt lags behind the queue draining after a backoff
+    if (rttMs > _minRtt * _cfg.rttInflation) {
+        decreaseLocked(now, PacingEvent::DecreaseRtt);
+        return;
+    }
+    if (windowLimited) return;
+    if (toMs(now - _lastIncrease) >= _srtt) {
+        _rate = std::min(_cfg.maxRateBps, _rate + _cfg.additiveStepBps);
+        _lastIncrease = now;
+        recordLocked(now, PacingEvent::Increase);
+    }
+}
+
+void CongestionController::onLoss() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    decreaseLocked(clock::now(), PacingEvent::DecreaseLoss);
+}
+
+double CongestionController::rateBps() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _rate;
+}
+
+double CongestionController::intervalMs(uint32_t chunkBytes) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return 1000.0 * chunkBytes / _rate;
+}
+
+double CongestionController::timeoutMs() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_srtt == 0.0) return 1000.0;
+    return std::max({ _srtt + 4.0 * _rttvar, 2.0 * _minRtt, 20.0 });
+}
+
+double CongestionController::convergedRateBps() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_trajectory.empty()) return _rate;
+    const double endMs  = std::max(_trajectory.back().tMs, toMs(clock::now() - _start));
+    const double fromMs = endMs / 2.0;
+
+    double weighted = 0.0, span = 0.0;
+    for (size_t i = 0; i < _trajectory.size(); ++i) {
+        double t0 = _trajectory[i].tMs;
+        double t1 = (i + 1 < _trajectory.size()) ? _trajectory[i + 1].tMs : endMs;
+        t0 = std::max(t0, fromMs);
+        if (t1 <= t0) continue;
+        weighted += _trajectory[i].rateBps * (t1 - t0);
+        span     += t1 - t0;
+    }
+    return (span > 0.0) ? weighted / span : _rate;
+}
+
+std::vector<PacingSample> CongestionController::trajectory() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _trajectory;
+}
+
+bool CongestionController::writeCsv(const std::string& path) const {
+    auto samples = trajectory();
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+    out << "t_ms,rate_Bps,srtt_ms,min_rtt_ms,event\n";
+    for (auto const& s : samples) {
+        out << s.tMs << ',' << s.rateBps << ',' << s.srttMs << ',' << s.minRttMs << ','
+            << eventName(s.event) << '\n';
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef CONGESTION_CONTROL_H
+#define CONGESTION_CONTROL_H
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Why the pacing rate changed
+enum class PacingEvent { Start, Increase, DecreaseLoss, DecreaseRtt };
+
+/// One point of the controller's rate trajectory
+struct PacingSample {
+    double      tMs      = 0.0;   ///< time since reset
+    double      rateBps  = 0.0;   ///< send rate after the event
+    double      srttMs   = 0.0;   ///< smoothed RTT at that moment
+    double      minRttMs = 0.0;   ///< lowest RTT seen in this run
+    PacingEvent event    = PacingEvent::Start;
+};
+
+/// Tuning of the AIMD controller
+struct PacingConfig {
+    double initialRateBps  = 8192.0;    ///< start rate when nothing is known about the algorithm
+    double minRateBps      = 512.0;
+    double maxRateBps      = 1048576.0;
+    double additiveStepBps = 2048.0;    ///< added once per RTT while notifications keep up
+    double decreaseFactor  = 0.7;       ///< multiplied on loss / RTT inflation
+    double rttInflation    = 1.5;       ///< RTT sample above minRtt * this counts as congestion
+};
+
+/// AIMD pacing for the FE43 request stream: grows the send rate additively while FE44
+/// responses keep up and backs off multiplicatively (at most once per two RTTs) when a
+/// request is lost or the RTT inflates. The rate trajectory is recorded for plotting. Thread safe.
+class CongestionController {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit CongestionController(PacingConfig cfg = {});
+
+    /// Starts a new run
+    /// @param startRateBps 0 = PacingConfig::initialRateBps
+    void reset(double startRateBps = 0.0);
+
+    /// A request's FE44 data arrived completely
+    /// @param windowLimited sender was blocked by the in-flight window, don't grow the rate
+    void onAck(double rttMs, bool windowLimited);
+
+    /// A request timed out (its bytes never arrived)
+    void onLoss();
+
+    double rateBps() const;
+    /// Inter-request spacing for the current rate
+    double intervalMs(uint32_t chunkBytes) const;
+    /// Retransmission style timeout: srtt + 4 * rttvar, at least twice the min RTT
+    double timeoutMs() const;
+
+    /// Time-weighted mean rate over the second half of the run (the converged rate)
+    double convergedRateBps() const;
+
+    std::vector<PacingSample> trajectory() const;
+    /// Writes the trajectory as CSV (t_ms,rate_Bps,srtt_ms,min_rtt_ms,event)
+    bool writeCsv(const std::string& path) const;
+
+private:
+    void decreaseLocked(clock::time_point now, PacingEvent why);
+    void recordLocked(clock::time_point now, PacingEvent ev);
+
+    PacingConfig              _cfg;
+    mutable std::mutex        _mutex;
+    double                    _rate   = 0.0;
+    double                    _srtt   = 0.0;
+    double                    _rttvar = 0.0;
+    double                    _minRtt = 0.0;
+    clock::time_point         _start{};
+    clock::time_point         _lastIncrease{};
+    clock::time_point         _lastDecrease{};
+    std::vector<PacingSample> _trajectory;
+};
+
+#endif //CONGESTION_CONTROL_H
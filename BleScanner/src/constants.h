@@ -6,16 +6,22 @@
 #define CONSTANTS_H
 
 #pragma once
+#ifdef _WIN32
 #include <winrt/base.h>
+#endif
 #include <cstdint>
 #include <array>
 #include <vector>
 #include <string>
 #include <utility>
+#include "cipher_suites.h"
 
 namespace AppConstants {
     inline const bool meastureAllTime = false;
 
+    /// File with persisted GATT handles per device address (see GattHandleCache)
+    inline constexpr const char* GATT_CACHE_FILE = "gatt_cache.txt";
+
     //––– Symmetric Keys –––//
     inline constexpr std::array<uint8_t, 32> KEY = {{
         0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,
@@ -29,6 +35,22 @@ namespace AppConstants {
         0x29,0x3A,0x4B,0x5C
     }};
 
+    /// XChaCha20-Poly1305 (0x06): bytes 0-15 go into HChaCha20, 16-23 are the ChaCha20 nonce
+    inline constexpr std::array<uint8_t, 24> XNONCE = {{
+        0xA1,0xB2,0xC3,0xD4,0xE5,0xF6,0x07,0x18,
+        0x29,0x3A,0x4B,0x5C,0x6D,0x7E,0x8F,0x90,
+        0x01,0x12,0x23,0x34,0x45,0x56,0x67,0x78
+    }};
+
+    //––– BLE Services & Characteristics (16-bit short form) –––//
+    inline constexpr uint16_t P2P_SERVICE_SHORT_UUID       = 0xFE40;
+    inline constexpr uint16_t LED_SHORT_UUID               = 0xFE41;
+    inline constexpr uint16_t BUTTON_NOTIFY_SHORT_UUID     = 0xFE42;
+    inline constexpr uint16_t DATA_IN_SHORT_UUID           = 0xFE43;
+    inline constexpr uint16_t DATA_OUT_SHORT_UUID          = 0xFE44;
+    inline constexpr uint16_t DATA_OUT_TIME_SHORT_UUID     = 0xFE45;
+
+#ifdef _WIN32
     //––– BLE Services & Characteristics –––//
     inline const winrt::guid P2P_SERVICE_UUID {
         0x0000fe40, 0xcc7a, 0x482a, {0x98,0x4a,0x7f,0x2e,0xd5,0xb3,0xe5,0x8f}
@@ -48,13 +70,52 @@ namespace AppConstants {
     inline const winrt::guid DATA_OUT_TIME_CHARACTERISTIC_UUID {
         0x0000fe45, 0x8e22, 0x4541, {0x9d,0x4c,0x21,0xed,0xae,0x82,0xed,0x19}
     };
+#endif
+
+    //––– Advertisement ingestion –––//
+    /// Min spacing of the watcher's advert summary log lines
+    inline constexpr double ADVERT_SUMMARY_MS = 2000.0;
+
+    //––– Request frames –––//
+    /// Set in the request type byte of an extended FE43 frame: [type | SEQ_FLAG][uint16 length][uint16 seq]
+    inline constexpr uint8_t  SEQ_FLAG = 0x80;
+    /// Big-endian seq echoed in front of every FE44 response and after the FE45 time of an extended request
+    inline constexpr uint32_t SEQ_HEADER_BYTES = 2;
+    /// FE45 of an extended request: [uint32 cipher µs][uint16 seq][uint32 MCU rx][uint32 cipher start][uint32 cipher done],
+    /// MCU clock stamps in µs, integers little-endian like the plain FE45 time
+    inline constexpr uint32_t TIMING_EXT_BYTES = 18;
+    /// Clock sync request type (always sent as an extended frame, length 0); the MCU answers
+    /// on FE45 with [SYNC_REQUEST | SEQ_FLAG][uint16 seq][uint32 t2 received][uint32 t3 replied]
+    inline constexpr uint8_t  SYNC_REQUEST = 0x70;
+    inline constexpr uint32_t SYNC_REPLY_BYTES = 11;
+
+    //––– Request pipeline –––//
+    /// Requests without a complete FE44 response after this long are treated as lost
+    inline constexpr double REQUEST_TIMEOUT_MS = 2000.0;
+
+    /// Largest response the GUI requests; also what CryptoEngine's keystream cache covers by default
+    inline constexpr uint32_t MAX_DATA_STM_SIZE = 50000;
+
+    /// Plaintext request: FE44 carries the payload followed by its CRC32C, little-endian
+    inline constexpr uint32_t CRC_BYTES = PlainCrcSuite::info.tagBytes;
+
+    /// Extra FE44 bytes per response on top of the requested payload (Poly1305 / GCM tag, CRC32C)
+    inline constexpr uint32_t responseOverhead(uint8_t requestType) {
+        const CipherSuite* suite = findSuite(requestType);
+        return suite ? suite->tagBytes : 0;
+    }
+
+    /// Longest FE44 notification (max ATT attribute value), also the size of a PacketRing slot
+    inline constexpr uint32_t MAX_NOTIFICATION_BYTES = 512;
+
+    /// Largest word whose response (seq header + payload + tag) fits one notification
+    inline constexpr uint32_t maxWordSize(uint8_t requestType) {
+        return MAX_NOTIFICATION_BYTES - SEQ_HEADER_BYTES - responseOverhead(requestType);
+    }
 
     //––– Supported Protocols List –––//
-    inline const std::vector<std::pair<std::string,uint8_t>> REQUEST_LIST = {
-        { "ChaCha20",           0x01 },
-        { "ChaCha20-Poly1305",  0x02 },
-        { "AES-GCM",            0x03 },
-    };
+    /// The cipher suite registry (cipher_suites.h), in GUI order
+    inline constexpr auto& REQUEST_LIST = kCipherSuites;
 
     //––– Predefined Devices –––//
     inline const std::vector<std::pair<std::string,uint64_t>> DEVICE_LIST = {
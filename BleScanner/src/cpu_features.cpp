@@ -0,0 +1,77 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "cpu_features.h"
+#include <cstdint>
+
+#if BLE_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace {
+
+void cpuid(uint32_t leaf, uint32_t sub, uint32_t r[4]) {
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuidex(regs, static_cast<int>(leaf), static_cast<int>(sub));
+    for (int i = 0; i < 4; ++i) r[i] = static_cast<uint32_t>(regs[i]);
+#else
+    __cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+BLE_TARGET("xsave") uint64_t xcr0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<uint64_t>(hi) << 32) | lo;
+#endif
+}
+
+CpuFeatures detect() {
+    CpuFeatures f;
+    uint32_t r[4];
+    cpuid(0, 0, r);
+    const uint32_t maxLeaf = r[0];
+
+    cpuid(1, 0, r);
+    f.sse2   = (r[3] >> 26) & 1;
+    f.ssse3  = (r[2] >> 9) & 1;
+    f.sse42  = (r[2] >> 20) & 1;
+    f.pclmul = (r[2] >> 1) & 1;
+    f.aesni  = (r[2] >> 25) & 1;
+    const bool osxsave = (r[2] >> 27) & 1;
+    const bool avx     = (r[2] >> 28) & 1;
+    // the OS must save the ymm registers, otherwise AVX code faults
+    const bool ymmSaved = osxsave && avx && (xcr0() & 0x6) == 0x6;
+
+    if (maxLeaf >= 7) {
+        cpuid(7, 0, r);
+        f.avx2       = ymmSaved && ((r[1] >> 5) & 1);
+        f.vaes       = f.avx2 && ((r[2] >> 9) & 1);
+        f.vpclmulqdq = f.avx2 && ((r[2] >> 10) & 1);
+    }
+    return f;
+}
+
+} // namespace
+
+const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features = detect();
+    return features;
+}
+
+#else
+
+const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features{};
+    return features;
+}
+
+#endif
@@ -0,0 +1,38 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+#pragma once
+
+/// x86-64 builds compile the SIMD kernels, they are only called after cpuFeatures() said so
+#if defined(__x86_64__) || defined(_M_X64)
+#define BLE_X86 1
+#else
+#define BLE_X86 0
+#endif
+
+/// Enables an instruction set for one function (GCC/Clang); MSVC compiles intrinsics without it
+#if defined(__GNUC__) || defined(__clang__)
+#define BLE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BLE_TARGET(isa)
+#endif
+
+/// Instruction sets the CPU and the OS (saved register state) support
+struct CpuFeatures {
+    bool sse2       = false;
+    bool ssse3      = false;
+    bool sse42      = false;    ///< crc32 instruction (CRC32C)
+    bool avx2       = false;
+    bool aesni      = false;
+    bool pclmul     = false;
+    bool vaes       = false;    ///< 256-bit AES (with avx2)
+    bool vpclmulqdq = false;    ///< 256-bit carry-less multiply (with avx2)
+};
+
+/// Detected once on first use
+const CpuFeatures& cpuFeatures();
+
+#endif //CPU_FEATURES_H
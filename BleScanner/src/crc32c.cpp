@@ -0,0 +1,139 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "crc32c.h"
+#include "cpu_features.h"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#if BLE_X86
+#include <immintrin.h>
+#endif
+
+namespace Crc32c {
+
+namespace {
+
+constexpr uint32_t kPoly = 0x82F63B78;     ///< 0x1EDC6F41 bit-reversed
+
+std::atomic<int> g_forced{ -1 };
+
+constexpr std::array<uint32_t, 256> makeTable() {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c >> 1) ^ ((c & 1) ? kPoly : 0);
+        t[i] = c;
+    }
+    return t;
+}
+
+constexpr std::array<uint32_t, 256> kTable = makeTable();
+
+uint32_t scalarCrc(uint32_t crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) crc = kTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#if BLE_X86
+
+BLE_TARGET("sse4.2") uint32_t sse42Crc(uint32_t crc, const uint8_t* data, size_t len) {
+    uint64_t c = crc;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        std::memcpy(&v, data + i, sizeof(v));
+        c = _mm_crc32_u64(c, v);
+    }
+    uint32_t c32 = static_cast<uint32_t>(c);
+    for (; i < len; ++i) c32 = _mm_crc32_u8(c32, data[i]);
+    return c32;
+}
+
+#endif
+
+} // namespace
+
+const char* kernelName(Kernel kernel) {
+    switch (kernel) {
+      case Kernel::Scalar: return "scalar";
+      case Kernel::Sse42:  return "SSE4.2";
+    }
+    return "?";
+}
+
+bool kernelSupported(Kernel kernel) {
+    switch (kernel) {
+      case Kernel::Scalar: return true;
+      case Kernel::Sse42:  return BLE_X86 && cpuFeatures().sse42;
+    }
+    return false;
+}
+
+Kernel bestKernel() {
+    static const Kernel best = kernelSupported(Kernel::Sse42) ? Kernel::Sse42 : Kernel::Scalar;
+    return best;
+}
+
+Kernel activeKernel() {
+    const int forced = g_forced.load(std::memory_order_relaxed);
+    return forced < 0 ? bestKernel() : static_cast<Kernel>(forced);
+}
+
+void forceKernel(Kernel kernel) {
+    g_forced.store(static_cast<int>(kernelSupported(kernel) ? kernel : Kernel::Scalar), std::memory_order_relaxed);
+}
+
+void resetKernel() {
+    g_forced.store(-1, std::memory_order_relaxed);
+}
+
+uint32_t compute(Kernel kernel, const uint8_t* data, size_t len) {
+    if (!kernelSupported(kernel)) kernel = Kernel::Scalar;
+#if BLE_X86
+    if (kernel == Kernel::Sse42) return ~sse42Crc(0xFFFFFFFF, data, len);
+#endif
+    return ~scalarCrc(0xFFFFFFFF, data, len);
+}
+
+uint32_t compute(const uint8_t* data, size_t len) {
+    return compute(activeKernel(), data, len);
+}
+
+bool selfTest() {
+    // RFC 3720 B.4: 32 bytes of 0x00, of 0xFF, ascending, descending
+    uint8_t v[4][32];
+    for (int i = 0; i < 32; ++i) {
+        v[0][i] = 0x00;
+        v[1][i] = 0xFF;
+        v[2][i] = static_cast<uint8_t>(i);
+        v[3][i] = static_cast<uint8_t>(31 - i);
+    }
+    const uint32_t expected[4] = { 0x8A9136AA, 0x62A8AB43, 0x46DD794E, 0x113FDB5C };
+    const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+
+    uint32_t seed = 0x0badc0de;
+    std::vector<uint8_t> buf(1024 + 8);
+    for (auto& b : buf) b = static_cast<uint8_t>((seed = seed * 1664525 + 1013904223) >> 24);
+
+    for (Kernel kernel : { Kernel::Scalar, Kernel::Sse42 }) {
+        if (!kernelSupported(kernel)) continue;
+        for (int i = 0; i < 4; ++i) {
+            if (compute(kernel, v[i], sizeof(v[i])) != expected[i]) return false;
+        }
+        if (compute(kernel, check, sizeof(check)) != 0xE3069283) return false;
+        for (size_t align = 0; align < 8; ++align) {
+            for (size_t len = 0; len <= 1024; len += (len < 64 ? 1 : 13)) {
+                if (compute(kernel, buf.data() + align, len) != compute(Kernel::Scalar, buf.data() + align, len))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace Crc32c
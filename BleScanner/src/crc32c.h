@@ -0,0 +1,42 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef CRC32C_H
+#define CRC32C_H
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// CRC-32C (Castagnoli, the iSCSI / RFC 3720 polynomial) for the plaintext request type 0x00:
+/// a table-driven scalar kernel and the SSE4.2 crc32 instruction, 8 bytes per step, picked at
+/// runtime from cpuFeatures(). Both give the same value, init and final XOR 0xFFFFFFFF.
+namespace Crc32c {
+
+enum class Kernel : uint8_t { Scalar, Sse42 };
+
+const char* kernelName(Kernel kernel);
+bool kernelSupported(Kernel kernel);
+
+/// Best kernel of this CPU
+Kernel bestKernel();
+
+/// Kernel compute() uses: bestKernel() unless forced
+Kernel activeKernel();
+
+/// Forces a kernel (benchmarks, cross-checks); an unsupported one means Scalar
+void forceKernel(Kernel kernel);
+void resetKernel();
+
+uint32_t compute(const uint8_t* data, size_t len);
+uint32_t compute(Kernel kernel, const uint8_t* data, size_t len);
+
+/// The RFC 3720 B.4 vectors and "123456789", then every supported kernel against the scalar
+/// one for 0 … 1 kB at every alignment
+/// @return false on the first mismatch
+bool selfTest();
+
+} // namespace Crc32c
+
+#endif //CRC32C_H
@@ -3,115 +3,393 @@
 //
 
 #include "crypto.h"
-#include "constants.h"         // KEY, NONCE
-#include <mbedtls/chacha20.h>
-#include <mbedtls/chachapoly.h>
+#include "aead_tag.h"
+#include "constants.h"         // KEY, NONCE, MAX_DATA_STM_SIZE
+#include "chachapoly_fused.h"
+#include "crc32c.h"
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 
 CryptoEngine::CryptoEngine() {
-    // No initialization here – ChaCha-Poly is only initialized when requestType == 0x02
+    mbedtls_ccm_init(&_ccm);
+    setKey(AppConstants::KEY);
 }
 
 CryptoEngine::~CryptoEngine() {
-    if (_polyInited) {
-        mbedtls_chachapoly_free(&_chachapoly);
+    mbedtls_ccm_free(&_ccm);
+}
+
+void CryptoEngine::setKey(std::span<const uint8_t, 32> key) {
+    // counter starts at 1 like the firmware
+    _chacha   = ChaCha20::makeState(key.data(), _nonce.data(), 1);
+    _chacha12 = ChaCha20::makeState(key.data(), _nonce.data(), 1, 12);
+    _chacha8  = ChaCha20::makeState(key.data(), _nonce.data(), 1, 8);
+    // XChaCha20: subkey from the first 16 nonce bytes, the last 8 make the ChaCha20 nonce
+    uint8_t subkey[32];
+    uint8_t xnonce[12] = {};
+    ChaCha20::hchacha20(key.data(), AppConstants::XNONCE.data(), subkey);
+    std::memcpy(xnonce + 4, AppConstants::XNONCE.data() + 16, 8);
+    _xchacha = ChaCha20::makeState(subkey, xnonce, 1);
+    // AES key schedules and GHASH key powers
+    if (!_gcm.setKey(key.data()) || !_gcm128.setKey(key.data(), 16) ||
+        mbedtls_ccm_setkey(&_ccm, MBEDTLS_CIPHER_ID_AES, key.data(), 256) != 0)
+        throw std::runtime_error("Crypto key setup failed");
+    if (_ksCacheBytes > 0) setKeystreamCache(true, _ksCacheBytes);
+}
+
+void CryptoEngine::setNonce(std::span<const uint8_t, 12> nonce) {
+    if (std::equal(nonce.begin(), nonce.end(), _nonce.begin())) return;
+    std::copy(nonce.begin(), nonce.end(), _nonce.begin());
+    ChaCha20::setNonce(_chacha, _nonce.data());
+    ChaCha20::setNonce(_chacha12, _nonce.data());
+    ChaCha20::setNonce(_chacha8, _nonce.data());
+    // the cached keystream belongs to the old nonce
+    if (_ksCacheBytes > 0) {
+        setKeystreamCache(false);
+        _ksPerPacketNonce.store(true, std::memory_order_relaxed);
     }
 }
 
+void CryptoEngine::setKeystreamCache(bool enabled, size_t maxBytes) {
+    _ksCacheBytes = enabled ? maxBytes : 0;
+    _ksCache.build(_chacha, _gcm, _nonce.data(), _ksCacheBytes);
+    _ksFootprint.store(_ksCache.footprint(), std::memory_order_relaxed);
+    if (enabled) _ksPerPacketNonce.store(false, std::memory_order_relaxed);
+}
+
+KeystreamCacheStats CryptoEngine::keystreamCacheStats() const {
+    KeystreamCacheStats st;
+    st.footprint      = _ksFootprint.load(std::memory_order_relaxed);
+    st.enabled        = st.footprint > 0;
+    st.perPacketNonce = _ksPerPacketNonce.load(std::memory_order_relaxed);
+    st.gcmCached      = st.enabled && _ksCache.gcmCached();
+    st.bytes          = st.enabled ? _ksCacheBytes : 0;
+    st.hits           = _ksHits.load(std::memory_order_relaxed);
+    st.misses         = _ksMisses.load(std::memory_order_relaxed);
+    return st;
+}
+
+bool CryptoEngine::cacheLookup(size_t len, bool gcm) {
+    if (!_ksCache.ready()) return false;
+    const bool hit = _ksCache.covers(len) && (!gcm || _ksCache.gcmCached());
+    bump(hit ? _ksHits : _ksMisses);
+    return hit;
+}
+
 void CryptoEngine::init(uint8_t requestType) {
-    // If switching to Poly and not yet initialized:
-    if (requestType == 0x02 && !_polyInited) {
-        mbedtls_chachapoly_init(&_chachapoly);
-        mbedtls_chachapoly_setkey(&_chachapoly, AppConstants::KEY.data());
-        _polyInited = true;
+    _suite = findSuite(requestType);
+    _bound = { &CryptoEngine::decryptUnknown, &CryptoEngine::verifyUnknown, &CryptoEngine::decryptBatchUnknown };
+    CipherSuites::visit(requestType, [this](auto suite) {
+        using Suite = decltype(suite);
+        _bound = { &CryptoEngine::decrypt<Suite>, &CryptoEngine::verify<Suite>, &CryptoEngine::decryptBatch<Suite> };
+    });
+}
+
+const char* decryptStatusName(DecryptStatus status) {
+    switch (status) {
+      case DecryptStatus::Ok:               return "ok";
+      case DecryptStatus::TooShort:         return "packet too short for the tag";
+      case DecryptStatus::OutputTooSmall:   return "output buffer too small";
+      case DecryptStatus::TagMismatch:      return "tag mismatch";
+      case DecryptStatus::UnknownAlgorithm: return "unknown request type";
+      case DecryptStatus::Failed:           return "cipher error";
+    }
+    return "?";
+}
+
+size_t CryptoEngine::packetPlainLength(size_t packetBytes) const {
+    return _suite ? _suite->plainLength(packetBytes) : packetBytes;
+}
+
+CryptoCounters CryptoEngine::counters(uint8_t requestType) const {
+    CryptoCounters c;
+    const size_t index = suiteIndex(requestType);
+    if (index >= _counters.size()) return c;
+    auto const& a = _counters[index];
+    c.packets     = a.packets.load(std::memory_order_relaxed);
+    c.bytes       = a.bytes.load(std::memory_order_relaxed);
+    c.tagFailures = a.tagFailures.load(std::memory_order_relaxed);
+    c.errors      = a.errors.load(std::memory_order_relaxed);
+    return c;
+}
+
+const char* decryptModeName(DecryptMode mode) {
+    switch (mode) {
+      case DecryptMode::Full:       return "decrypt";
+      case DecryptMode::VerifyOnly: return "verify only";
+      case DecryptMode::Lazy:       return "lazy";
+    }
+    return "?";
+}
+
+DecryptResult CryptoEngine::decryptUnknown(std::span<const uint8_t>, std::span<uint8_t>) noexcept {
+    return { DecryptStatus::UnknownAlgorithm, 0 };
+}
+
+DecryptResult CryptoEngine::verifyUnknown(std::span<const uint8_t>) noexcept {
+    return { DecryptStatus::UnknownAlgorithm, 0 };
+}
+
+BatchResult CryptoEngine::decryptBatchUnknown(std::span<BatchPacket> packets) noexcept {
+    for (auto& p : packets) p.result = { DecryptStatus::UnknownAlgorithm, 0 };
+    BatchResult r;
+    r.failed = static_cast<uint32_t>(packets.size());
+    return r;
+}
+
+BatchResult CryptoEngine::tally(size_t suite, std::span<const BatchPacket> packets,
+                                std::chrono::steady_clock::time_point t0) {
+    BatchResult r;
+    uint64_t tagFailures = 0;
+    for (auto const& p : packets) {
+        if (p.result) {
+            ++r.ok;
+            r.plaintextBytes += p.result.length;
+        } else {
+            ++r.failed;
+            if (p.result.status == DecryptStatus::TagMismatch) ++tagFailures;
+        }
+    }
+    auto& c = _counters[suite];
+    bump(c.packets, r.ok);
+    bump(c.bytes, r.plaintextBytes);
+    bump(c.tagFailures, tagFailures);
+    bump(c.errors, r.failed - tagFailures);
+    r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return r;
+}
+
+DecryptStatus CryptoEngine::authentic(PlainCrcSuite, std::span<const uint8_t> packet) {
+    // payload || le32 CRC32C, SSE4.2 when the CPU has it, see crc32c.h
+    const size_t len = packet.size() - AppConstants::CRC_BYTES;
+    const uint8_t* crc = packet.data() + len;
+    const uint32_t expected = crc[0] | (crc[1] << 8) | (crc[2] << 16) | (static_cast<uint32_t>(crc[3]) << 24);
+    return Crc32c::compute(packet.data(), len) == expected ? DecryptStatus::Ok : DecryptStatus::TagMismatch;
+}
+
+DecryptResult CryptoEngine::open(PlainCrcSuite, std::span<const uint8_t> packet, std::span<uint8_t> out) {
+    if (packet.size() < AppConstants::CRC_BYTES) return { DecryptStatus::TooShort, 0 };
+    const size_t len = packet.size() - AppConstants::CRC_BYTES;
+    if (out.size() < len) return { DecryptStatus::OutputTooSmall, 0 };
+    if (authentic(PlainCrcSuite{}, packet) != DecryptStatus::Ok) return { DecryptStatus::TagMismatch, 0 };
+    if (out.data() != packet.data()) std::memmove(out.data(), packet.data(), len);
+    return { DecryptStatus::Ok, len };
+}
+
+DecryptResult CryptoEngine::xorOpen(const ChaCha20::State& st, std::span<const uint8_t> packet,
+                                    std::span<uint8_t> out) {
+    // SIMD keystream when the CPU has it, see chacha20_simd.h
+    if (out.size() < packet.size()) return { DecryptStatus::OutputTooSmall, 0 };
+    ChaCha20::xorStream(st, packet.data(), out.data(), packet.size());
+    return { DecryptStatus::Ok, packet.size() };
+}
+
+DecryptResult CryptoEngine::open(ChaCha20Suite, std::span<const uint8_t> packet, std::span<uint8_t> out) {
+    if (out.size() < packet.size()) return { DecryptStatus::OutputTooSmall, 0 };
+    if (!cacheLookup(packet.size(), false)) return xorOpen(_chacha, packet, out);
+    _ksCache.xorChaCha(packet.data(), out.data(), packet.size());
+    return { DecryptStatus::Ok, packet.size() };
+}
+
+DecryptResult CryptoEngine::open(ChaCha12Suite, std::span<const uint8_t> packet, std::span<uint8_t> out) {
+    return xorOpen(_chacha12, packet, out);
+}
+
+DecryptResult CryptoEngine::open(ChaCha8Suite, std::span<const uint8_t> packet, std::span<uint8_t> out) {
+    return xorOpen(_chacha8, packet, out);
+}
+
+void CryptoEngine::openBatch(ChaCha20Suite, std::span<BatchPacket> packets) {
+    // a cached keystream beats computing it, even in lanes
+    if (_ksCache.ready()) {
+        for (auto& p : packets) p.result = open(ChaCha20Suite{}, p.in, p.out);
+        return;
     }
-    // If switching from Poly to something else, free the context:
-    else if (requestType != 0x02 && _polyInited) {
-        mbedtls_chachapoly_free(&_chachapoly);
-        _polyInited = false;
+    xorBatch(_chacha, packets);
+}
+
+void CryptoEngine::xorBatch(const ChaCha20::State& st, std::span<BatchPacket> packets) {
+    // multi-buffer: short packets share the AVX2 lanes, see ChaCha20::xorStreams()
+    constexpr size_t kGroup = 64;
+    ChaCha20::Stream streams[kGroup];
+    for (size_t base = 0; base < packets.size(); base += kGroup) {
+        const size_t n = std::min(kGroup, packets.size() - base);
+        size_t count = 0;
+        for (size_t i = base; i < base + n; ++i) {
+            auto& p = packets[i];
+            if (p.out.size() < p.in.size()) { p.result = { DecryptStatus::OutputTooSmall, 0 }; continue; }
+            streams[count++] = { &st, p.in.data(), p.out.data(), p.in.size() };
+            p.result = { DecryptStatus::Ok, p.in.size() };
+        }
+        ChaCha20::xorStreams(streams, count);
     }
+}
+
+DecryptStatus CryptoEngine::authentic(ChaChaPolySuite, std::span<const uint8_t> packet) {
+    constexpr size_t kTagLen = ChaChaPolySuite::info.tagBytes;
+    return ChaChaPoly::verify(_chacha, packet.data(), packet.data() + kTagLen, packet.size() - kTagLen)
+        ? DecryptStatus::Ok : DecryptStatus::TagMismatch;
+}
+
+DecryptResult CryptoEngine::open(ChaChaPolySuite, std::span<const uint8_t> packet, std::span<uint8_t> out) {
+    // tag first
+    constexpr size_t kTagLen = ChaChaPolySuite::info.tagBytes;
+    if (packet.size() < kTagLen) return { DecryptStatus::TooShort, 0 };
+    const size_t ctLen = packet.size() - kTagLen;
+    if (out.size() < ctLen) return { DecryptStatus::OutputTooSmall, 0 };
+    // Poly1305 and ChaCha20 tile by tile, see chachapoly_fused.h
+    const bool ok = cacheLookup(ctLen, false)
+        ? _ksCache.decryptChaChaPoly(packet.data(), packet.data() + kTagLen, ctLen, out.data())
+        : ChaChaPoly::decrypt(_chacha, packet.data(), packet.data() + kTagLen, ctLen, out.data());
+    if (!ok) return { DecryptStatus::TagMismatch, 0 };
+    return { DecryptStatus::Ok, ctLen };
+}
+
+DecryptStatus CryptoEngine::authentic(XChaChaPolySuite, std::span<const uint8_t> packet) {
+    constexpr size_t kTagLen = XChaChaPolySuite::info.tagBytes;
+    return ChaChaPoly::verify(_xchacha, packet.data(), packet.data() + kTagLen, packet.size() - kTagLen)
+        ? DecryptStatus::Ok : DecryptStatus::TagMismatch;
+}
+
+DecryptResult CryptoEngine::open(XChaChaPolySuite, std::span<const uint8_t> packet, std::span<uint8_t> out) {
+    // 0x02 under the subkey setKey() derived, no keystream cache
+    constexpr size_t kTagLen = XChaChaPolySuite::info.tagBytes;
+    if (packet.size() < kTagLen) return { DecryptStatus::TooShort, 0 };
+    const size_t ctLen = packet.size() - kTagLen;
+    if (out.size() < ctLen) return { DecryptStatus::OutputTooSmall, 0 };
+    if (!ChaChaPoly::decrypt(_xchacha, packet.data(), packet.data() + kTagLen, ctLen, out.data()))
+        return { DecryptStatus::TagMismatch, 0 };
+    return { DecryptStatus::Ok, ctLen };
+}
 
-    // AES-GCM initialization
-    if (requestType == 0x03 && !_gcmInited) {
-        mbedtls_gcm_init(&_gcm);
-        // 256-bit key = 32 * 8 bits
-        mbedtls_gcm_setkey(&_gcm, MBEDTLS_CIPHER_ID_AES, AppConstants::KEY.data(), (int)AppConstants::KEY.size() * 8);
-        _gcmInited = true;
+DecryptStatus CryptoEngine::authentic(AesGcmSuite, std::span<const uint8_t> packet) {
+    const size_t ctLen = packet.size() - AesGcmSuite::info.tagBytes;
+    return AesGcm::verify(_gcm, _nonce.data(), packet.data(), ctLen, packet.data() + ctLen)
+        ? DecryptStatus::Ok : DecryptStatus::TagMismatch;
+}
+
+DecryptStatus CryptoEngine::authentic(AesGcm128Suite, std::span<const uint8_t> packet) {
+    const size_t ctLen = packet.size() - AesGcm128Suite::info.tagBytes;
+    return AesGcm::verify(_gcm128, _nonce.data(), packet.data(), ctLen, packet.data() + ctLen)
+        ? DecryptStatus::Ok : DecryptStatus::TagMismatch;
+}
+
+DecryptResult CryptoEngine::gcmOpen(AesGcm::Key& key, std::span<const uint8_t> packet, std::span<uint8_t> out) {
+    // tag last
+    constexpr size_t kTagLen = AesGcmSuite::info.tagBytes;
+    if (packet.size() < kTagLen) return { DecryptStatus::TooShort, 0 };
+    const size_t ctLen = packet.size() - kTagLen;
+    if (out.size() < ctLen) return { DecryptStatus::OutputTooSmall, 0 };
+    // AES-NI / VAES when the CPU has them, see aes_gcm_simd.h
+    const uint8_t* tag = packet.data() + ctLen;
+    const bool ok = &key == &_gcm && cacheLookup(ctLen, true)
+        ? _ksCache.decryptGcm(_gcm, packet.data(), ctLen, tag, out.data())
+        : AesGcm::decrypt(key, _nonce.data(), packet.data(), ctLen, tag, out.data());
+    if (!ok) return { DecryptStatus::TagMismatch, 0 };
+    return { DecryptStatus::Ok, ctLen };
+}
+
+DecryptResult CryptoEngine::open(AesGcmSuite, std::span<const uint8_t> packet, std::span<uint8_t> out) {
+    return gcmOpen(_gcm, packet, out);
+}
+
+DecryptResult CryptoEngine::open(AesGcm128Suite, std::span<const uint8_t> packet, std::span<uint8_t> out) {
+    return gcmOpen(_gcm128, packet, out);
+}
+
+void CryptoEngine::openBatch(AesGcmSuite, std::span<BatchPacket> packets) {
+    // with cached pads only GHASH is left per packet
+    if (_ksCache.gcmCached()) {
+        for (auto& p : packets) p.result = open(AesGcmSuite{}, p.in, p.out);
+        return;
     }
-    else if (requestType != 0x03 && _gcmInited) {
-        mbedtls_gcm_free(&_gcm);
-        _gcmInited = false;
+    gcmBatch(_gcm, packets);
+}
+
+void CryptoEngine::gcmBatch(AesGcm::Key& key, std::span<BatchPacket> packets) {
+    constexpr size_t kTagLen = AesGcmSuite::info.tagBytes;
+    // several packets interleaved in the AES/GHASH pipeline, see AesGcm::decryptBatch()
+    constexpr size_t kGroup = 64;
+    AesGcm::Packet gcm[kGroup];
+    BatchPacket* owner[kGroup];
+    for (size_t base = 0; base < packets.size(); base += kGroup) {
+        const size_t n = std::min(kGroup, packets.size() - base);
+        size_t count = 0;
+        for (size_t i = base; i < base + n; ++i) {
+            auto& p = packets[i];
+            if (p.in.size() < kTagLen) { p.result = { DecryptStatus::TooShort, 0 }; continue; }
+            const size_t ctLen = p.in.size() - kTagLen;
+            if (p.out.size() < ctLen) { p.result = { DecryptStatus::OutputTooSmall, 0 }; continue; }
+            gcm[count] = { _nonce.data(), p.in.data(), ctLen, p.in.data() + ctLen, p.out.data() };
+            owner[count++] = &p;
+        }
+        AesGcm::decryptBatch(key, gcm, count);
+        for (size_t i = 0; i < count; ++i) {
+            owner[i]->result = gcm[i].ok ? DecryptResult{ DecryptStatus::Ok, gcm[i].len }
+                                         : DecryptResult{ DecryptStatus::TagMismatch, 0 };
+        }
     }
+}
 
-    _currentRequest = requestType;
+DecryptStatus CryptoEngine::authentic(AesCcmSuite, std::span<const uint8_t> packet) {
+    // CBC-MAC runs over the plaintext, so CCM can't skip the CTR pass: decrypt into a
+    // scratch block by block and only compare the tag
+    constexpr size_t kTagLen = AesCcmSuite::info.tagBytes;
+    const size_t ctLen = packet.size() - kTagLen;
+    // an mbedTLS error is a cipher failure, not a forged packet
+    if (mbedtls_ccm_starts(&_ccm, MBEDTLS_CCM_DECRYPT, _nonce.data(), _nonce.size()) != 0 ||
+        mbedtls_ccm_set_lengths(&_ccm, 0, ctLen, kTagLen) != 0)
+        return DecryptStatus::Failed;
+    uint8_t scratch[256];
+    for (size_t off = 0; off < ctLen; off += sizeof(scratch)) {
+        const size_t n = std::min(sizeof(scratch), ctLen - off);
+        size_t written = 0;
+        if (mbedtls_ccm_update(&_ccm, packet.data() + off, n, scratch, sizeof(scratch), &written) != 0)
+            return DecryptStatus::Failed;
+    }
+    uint8_t computed[kTagLen];
+    if (mbedtls_ccm_finish(&_ccm, computed, kTagLen) != 0) return DecryptStatus::Failed;
+    return AeadTag::equal(computed, packet.data() + ctLen, kTagLen) ? DecryptStatus::Ok : DecryptStatus::TagMismatch;
+}
+
+DecryptResult CryptoEngine::open(AesCcmSuite, std::span<const uint8_t> packet, std::span<uint8_t> out) {
+    // tag last; mbedTLS only (no CCM kernel of our own), in place is fine
+    constexpr size_t kTagLen = AesCcmSuite::info.tagBytes;
+    if (packet.size() < kTagLen) return { DecryptStatus::TooShort, 0 };
+    const size_t ctLen = packet.size() - kTagLen;
+    if (out.size() < ctLen) return { DecryptStatus::OutputTooSmall, 0 };
+    const int rc = mbedtls_ccm_auth_decrypt(&_ccm, ctLen, _nonce.data(), _nonce.size(), nullptr, 0,
+                                            packet.data(), out.data(), packet.data() + ctLen, kTagLen);
+    if (rc == MBEDTLS_ERR_CCM_AUTH_FAILED) return { DecryptStatus::TagMismatch, 0 };
+    if (rc != 0)                           return { DecryptStatus::Failed, 0 };
+    return { DecryptStatus::Ok, ctLen };
 }
 
 std::vector<uint8_t> CryptoEngine::decrypt(const std::vector<uint8_t>& packet,
                                            double& outMs)
+{
+    std::vector<uint8_t> plaintext;
+    decrypt(std::span<const uint8_t>(packet), plaintext, outMs);
+    return plaintext;
+}
+
+void CryptoEngine::decrypt(std::span<const uint8_t> packet, std::vector<uint8_t>& plaintext,
+                           double& outMs)
 {
     using clock = std::chrono::steady_clock;
     auto t0 = clock::now();
-    std::vector<uint8_t> plaintext;
 
-    switch (_currentRequest) {
-      case 0x01: {
-        // ChaCha20
-        size_t len = packet.size();
-        plaintext.resize(len);
-        if (mbedtls_chacha20_crypt(
-                AppConstants::KEY.data(),
-                AppConstants::NONCE.data(),
-                1, len,
-                packet.data(), plaintext.data()) != 0)
-            throw std::runtime_error("ChaCha20 decrypt failed");
-        break;
-      }
-
-      case 0x02: {
-        // ChaCha20-Poly1305
-        if (!_polyInited)
-            throw std::runtime_error("ChaChaPoly not initialized");
-        if (packet.size() < 16)
-            throw std::runtime_error("Packet too small for Poly1305 tag");
-        size_t ctLen = packet.size() - 16;
-        const uint8_t* tag = packet.data();
-        const uint8_t* ct  = packet.data() + 16;
-        plaintext.resize(ctLen);
-        if (mbedtls_chachapoly_auth_decrypt(
-                &_chachapoly, ctLen,
-                AppConstants::NONCE.data(), nullptr, 0,
-                tag, ct, plaintext.data()) != 0)
-            throw std::runtime_error("ChaChaPoly decrypt failed");
-        break;
-      }
-
-      case 0x03: {
-        // AES-GCM
-        if (!_gcmInited)
-            throw std::runtime_error("GCM not initialized");
-        if (packet.size() < 16)
-            throw std::runtime_error("Packet too small for GCM tag");
-        const size_t tagLen = 16;
-        const size_t ctLen = packet.size() - tagLen;
-
-        const uint8_t* ct  = packet.data();
-        const uint8_t* tag = packet.data() + ctLen;
-        plaintext.resize(ctLen);
-        if (mbedtls_gcm_auth_decrypt(&_gcm, ctLen,
-            AppConstants::NONCE.data(), (int)AppConstants::NONCE.size(),
-            nullptr, 0,   // no AAD
-            tag, (int)tagLen,
-            ct, plaintext.data()) != 0)
-        throw std::runtime_error("AES-GCM decrypt failed or tag invalid");
-        break;
-      }
-
-      default:
-        throw std::runtime_error("Unknown requestType");
+    plaintext.resize(packetPlainLength(packet.size()));
+    DecryptResult r = decrypt(packet, std::span<uint8_t>(plaintext));
+    if (!r) {
+        plaintext.clear();
+        throw std::runtime_error(std::string("Decrypt failed: ") + decryptStatusName(r.status));
     }
+    plaintext.resize(r.length);
 
     auto t1 = clock::now();
     outMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
-    return plaintext;
-}
\ No newline at end of file
+}
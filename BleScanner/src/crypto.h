@@ -6,35 +6,292 @@
 #define CRYPTO_H
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <vector>
 #include <cstdint>
-#include <mbedtls/chachapoly.h>
-#include <mbedtls/gcm.h>
+#include <span>
 #include <chrono>
+#include <mbedtls/ccm.h>
+#include "aes_gcm_simd.h"
+#include "chacha20_simd.h"
+#include "cipher_suites.h"
+#include "constants.h"
+#include "keystream_cache.h"
 
-/// Decryption engine for ChaCha20, ChaCha20-Poly1305, and AES-GCM
+/// Outcome of CryptoEngine::decrypt() on spans
+enum class DecryptStatus : uint8_t {
+    Ok,
+    TooShort,           ///< packet shorter than the tag
+    OutputTooSmall,     ///< out span can't hold the plaintext
+    TagMismatch,        ///< authentication failed (CRC32C mismatch for 0x00), out is wiped
+    UnknownAlgorithm,   ///< init() got an unsupported request type
+    Failed              ///< mbedTLS error other than the tag
+};
+
+const char* decryptStatusName(DecryptStatus status);
+
+/// What a receive path does with each FE44 packet
+enum class DecryptMode : uint8_t {
+    Full,           ///< decrypt() into plaintext right away
+    VerifyOnly,     ///< verify() the tag, no plaintext (the plain ChaCha suites have no tag, only the length is taken)
+    Lazy            ///< keep the ciphertext in a CiphertextLog, decrypt when the plaintext is asked for
+};
+
+const char* decryptModeName(DecryptMode mode);
+
+/// Status + plaintext length, an `expected`-style result of the span decrypt
+struct DecryptResult {
+    DecryptStatus status = DecryptStatus::Ok;
+    size_t        length = 0;       ///< plaintext bytes written to out (0 unless Ok)
+
+    explicit operator bool() const { return status == DecryptStatus::Ok; }
+};
+
+/// One packet of CryptoEngine::decryptBatch(): in/out like the span decrypt(), result filled in
+struct BatchPacket {
+    std::span<const uint8_t> in{};
+    std::span<uint8_t>       out{};
+    DecryptResult            result{};
+};
+
+/// Totals of one decryptBatch() call
+struct BatchResult {
+    uint32_t ok             = 0;
+    uint32_t failed         = 0;
+    uint64_t plaintextBytes = 0;
+    double   ms             = 0.0;  ///< whole batch, one clock read at each end
+};
+
+/// Per-algorithm counters of a CryptoEngine
+struct CryptoCounters {
+    uint64_t packets     = 0;       ///< decrypted successfully
+    uint64_t bytes       = 0;       ///< plaintext bytes of those
+    uint64_t tagFailures = 0;
+    uint64_t errors      = 0;       ///< every other non-Ok status
+};
+
+/// State of a CryptoEngine's keystream cache
+struct KeystreamCacheStats {
+    bool     enabled        = false;
+    bool     perPacketNonce = false;    ///< setNonce() changed the nonce, so the cache was dropped
+    bool     gcmCached      = false;    ///< AES-GCM pads too (needs AES-NI)
+    size_t   bytes          = 0;        ///< keystream per algorithm
+    size_t   footprint      = 0;        ///< heap bytes
+    uint64_t hits           = 0;        ///< packets decrypted from the cache
+    uint64_t misses         = 0;        ///< longer packets (or 0x03 without cached pads), computed as usual
+
+    double hitRate() const { return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0; }
+};
+
+/// Decryption engine for ChaCha20/12/8, (X)ChaCha20-Poly1305, AES-256/128-GCM and AES-CCM,
+/// plus the plaintext baseline (0x00) that only checks a CRC32C.
+/// Keeps a keyed context for every algorithm for its whole lifetime (key schedule and
+/// GHASH tables are computed once per key), so a packet only costs nonce setup + data.
+/// Every operation exists per suite of the registry (cipher_suites.h): decrypt<Suite>() and
+/// friends when the suite is known at compile time, or bound once by init() for the runtime
+/// request type.
 class CryptoEngine {
 public:
     CryptoEngine();
     ~CryptoEngine();
 
-    /// (Re)initializes the engine based on selected method:
-    /// 0x01 = ChaCha20, 0x02 = ChaCha20-Poly1305, 0x03 = AES-GCM
+    CryptoEngine(const CryptoEngine&) = delete;
+    CryptoEngine& operator=(const CryptoEngine&) = delete;
+
+    /// Selects the suite by request type (see kCipherSuites): binds decrypt(), verify() and
+    /// decryptBatch() to that suite's versions, so a packet costs one indirect call and no
+    /// branching on the type. Cheap, but meant per transfer rather than per packet.
     void init(uint8_t requestType);
 
+    /// Suite init() selected, nullptr before it or for an unknown request type
+    const CipherSuite* suite() const { return _suite; }
+
+    /// Re-keys all contexts (256-bit key, AES-128-GCM takes its first 16 bytes), the engine
+    /// starts with AppConstants::KEY. Rebuilds the keystream cache when it is on.
+    void setKey(std::span<const uint8_t, 32> key);
+
+    /// Nonce of the following packets, the engine starts with AppConstants::NONCE. A nonce
+    /// other than the current one means per-packet nonces: the keystream cache is dropped
+    /// and stays off until setKeystreamCache() turns it on again. XChaCha20-Poly1305 (0x06)
+    /// keeps its 24-byte AppConstants::XNONCE.
+    void setNonce(std::span<const uint8_t, 12> nonce);
+
+    /// Precomputes maxBytes of keystream per algorithm for the current key and nonce, so a
+    /// packet up to that long decrypts with a XOR (plus Poly1305 / GHASH for the tag).
+    /// Covers 0x01-0x03; off by default; not to be called while another thread decrypts.
+    void setKeystreamCache(bool enabled, size_t maxBytes = AppConstants::MAX_DATA_STM_SIZE);
+
+    /// Footprint and hit rate of the keystream cache, readable from any thread
+    KeystreamCacheStats keystreamCacheStats() const;
+
+    /// Decrypts one packet without allocating or throwing.
+    /// @param packet  Ciphertext [+ tag for Poly/GCM].
+    /// @param out     Plaintext output, at least packetPlainLength() bytes. May be the packet's own
+    ///                buffer (out.data() == packet.data()): the plaintext then starts at its beginning.
+    /// @return        Status and plaintext length; tag failures are counted per algorithm.
+    DecryptResult decrypt(std::span<const uint8_t> packet, std::span<uint8_t> out) noexcept {
+        return (this->*_bound.decrypt)(packet, out);
+    }
+
+    /// Checks a packet's Poly1305 / GCM tag without writing plaintext: one MAC / GHASH pass
+    /// instead of MAC plus cipher. Counted like decrypt(). Never allocates or throws.
+    /// @return  Ok with the plaintext length decrypt() would give, or why it failed
+    DecryptResult verify(std::span<const uint8_t> packet) noexcept {
+        return (this->*_bound.verify)(packet);
+    }
+
+    /// Decrypts packets back to back: one algorithm dispatch, one timing and one counter
+    /// update for the whole batch instead of per packet. Never allocates or throws.
+    /// ChaCha20/12/8 (0x01/0x04/0x05) packets run side by side in the multi-buffer kernel and
+    /// AES-GCM (0x03/0x07) packets interleaved in the AES/GHASH pipeline, so packets of one
+    /// batch must not overlap each other (each may still decrypt in place).
+    BatchResult decryptBatch(std::span<BatchPacket> packets) noexcept {
+        return (this->*_bound.batch)(packets);
+    }
+
+    //––– Static dispatch –––//
+    // The same three for a suite known at compile time (e.g. decrypt<AesGcmSuite>()): no
+    // dispatch at all, the implementation is picked by overload resolution on the suite type.
+    // They don't look at init() and count against Suite.
+
+    template <class Suite>
+    DecryptResult decrypt(std::span<const uint8_t> packet, std::span<uint8_t> out) noexcept {
+        return count(CipherSuites::indexOf<Suite>(), open(Suite{}, packet, out));
+    }
+
+    template <class Suite>
+    DecryptResult verify(std::span<const uint8_t> packet) noexcept {
+        constexpr size_t index = CipherSuites::indexOf<Suite>();
+        if (packet.size() < Suite::info.tagBytes) return count(index, { DecryptStatus::TooShort, 0 });
+        if (auto st = authentic(Suite{}, packet); st != DecryptStatus::Ok) return count(index, { st, 0 });
+        return count(index, { DecryptStatus::Ok, Suite::info.plainLength(packet.size()) });
+    }
+
+    template <class Suite>
+    BatchResult decryptBatch(std::span<BatchPacket> packets) noexcept {
+        const auto t0 = std::chrono::steady_clock::now();
+        openBatch(Suite{}, packets);
+        return tally(CipherSuites::indexOf<Suite>(), packets, t0);
+    }
+
+    /// Plaintext length of a packet of the selected algorithm (0 if it is too short)
+    size_t packetPlainLength(size_t packetBytes) const;
+
+    /// Counters of one suite by request type (zeros for an unknown one), readable from any thread
+    CryptoCounters counters(uint8_t requestType) const;
+
     /// Decrypts the given packet and measures decryption time (in milliseconds).
+    /// Throws std::runtime_error on failure, prefer the span overload on hot paths.
     /// @param packet  Input buffer (ciphertext [+ tag for Poly/GCM]).
     /// @param outMs   Output variable for time spent (in ms).
     /// @return        Decrypted plaintext as a vector<uint8_t>.
     std::vector<uint8_t> decrypt(const std::vector<uint8_t>& packet,
                                  double& outMs);
 
+    /// Same as decrypt(), into a caller-owned buffer that is reused across packets
+    /// (resized to the plaintext length, allocates only when it has to grow). Throws like decrypt().
+    /// @param packet  Input span (e.g. a PacketRing slot).
+    /// @param out     Plaintext output.
+    /// @param outMs   Output variable for time spent (in ms).
+    void decrypt(std::span<const uint8_t> packet, std::vector<uint8_t>& out,
+                 double& outMs);
+
 private:
-    mbedtls_chachapoly_context _chachapoly;
-    bool                       _polyInited    = false;
-    mbedtls_gcm_context        _gcm;
-    bool                       _gcmInited     = false;
-    uint8_t                    _currentRequest = 0x00;
+    /// Single writer (the decrypting thread), so plain load/store instead of RMW
+    struct AtomicCounters {
+        std::atomic<uint64_t> packets{ 0 }, bytes{ 0 }, tagFailures{ 0 }, errors{ 0 };
+    };
+    static void bump(std::atomic<uint64_t>& c, uint64_t by = 1) {
+        c.store(c.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+    /// Adds a single-packet result to the counters of registry entry `suite`
+    DecryptResult count(size_t suite, DecryptResult r) {
+        auto& c = _counters[suite];
+        switch (r.status) {
+          case DecryptStatus::Ok:          bump(c.packets); bump(c.bytes, r.length); break;
+          case DecryptStatus::TagMismatch: bump(c.tagFailures); break;
+          default:                         bump(c.errors); break;
+        }
+        return r;
+    }
+    /// Adds a batch's results to the counters of registry entry `suite` and times it from t0
+    BatchResult tally(size_t suite, std::span<const BatchPacket> packets, std::chrono::steady_clock::time_point t0);
+    /// Counts a packet against the cache, true when it is covered (gcm: needs the AES-GCM pads)
+    bool cacheLookup(size_t len, bool gcm);
+
+    //––– Per-suite implementations, picked by overload on the suite type –––//
+    /// 0x00: CRC32C check, then the payload is copied (or left in place)
+    DecryptResult open(PlainCrcSuite, std::span<const uint8_t> packet, std::span<uint8_t> out);
+    DecryptResult open(ChaCha20Suite, std::span<const uint8_t> packet, std::span<uint8_t> out);
+    DecryptResult open(ChaCha12Suite, std::span<const uint8_t> packet, std::span<uint8_t> out);
+    DecryptResult open(ChaCha8Suite, std::span<const uint8_t> packet, std::span<uint8_t> out);
+    DecryptResult open(ChaChaPolySuite, std::span<const uint8_t> packet, std::span<uint8_t> out);
+    DecryptResult open(XChaChaPolySuite, std::span<const uint8_t> packet, std::span<uint8_t> out);
+    DecryptResult open(AesGcmSuite, std::span<const uint8_t> packet, std::span<uint8_t> out);
+    DecryptResult open(AesGcm128Suite, std::span<const uint8_t> packet, std::span<uint8_t> out);
+    DecryptResult open(AesCcmSuite, std::span<const uint8_t> packet, std::span<uint8_t> out);
+
+    /// Tag (CRC) check of a packet at least tagBytes long, without plaintext
+    /// @return Ok, TagMismatch, or Failed when the cipher itself errors out
+    DecryptStatus authentic(PlainCrcSuite, std::span<const uint8_t> packet);
+    DecryptStatus authentic(ChaCha20Suite, std::span<const uint8_t>) { return DecryptStatus::Ok; }     // no tag
+    DecryptStatus authentic(ChaCha12Suite, std::span<const uint8_t>) { return DecryptStatus::Ok; }
+    DecryptStatus authentic(ChaCha8Suite, std::span<const uint8_t>) { return DecryptStatus::Ok; }
+    DecryptStatus authentic(ChaChaPolySuite, std::span<const uint8_t> packet);
+    DecryptStatus authentic(XChaChaPolySuite, std::span<const uint8_t> packet);
+    DecryptStatus authentic(AesGcmSuite, std::span<const uint8_t> packet);
+    DecryptStatus authentic(AesGcm128Suite, std::span<const uint8_t> packet);
+    DecryptStatus authentic(AesCcmSuite, std::span<const uint8_t> packet);
+
+    /// Fills every packet's result; packet by packet unless the suite has a batch kernel
+    template <class Suite>
+    void openBatch(Suite, std::span<BatchPacket> packets) {
+        for (auto& p : packets) p.result = open(Suite{}, p.in, p.out);
+    }
+    /// 0x01/0x04/0x05 through the multi-buffer kernel
+    void openBatch(ChaCha20Suite, std::span<BatchPacket> packets);
+    void openBatch(ChaCha12Suite, std::span<BatchPacket> packets) { xorBatch(_chacha12, packets); }
+    void openBatch(ChaCha8Suite, std::span<BatchPacket> packets)  { xorBatch(_chacha8, packets); }
+    /// 0x03/0x07 with the packets interleaved
+    void openBatch(AesGcmSuite, std::span<BatchPacket> packets);
+    void openBatch(AesGcm128Suite, std::span<BatchPacket> packets) { gcmBatch(_gcm128, packets); }
+
+    /// Shared by the suites above: the bare keystream XOR / GCM open with that state or key
+    DecryptResult xorOpen(const ChaCha20::State& st, std::span<const uint8_t> packet, std::span<uint8_t> out);
+    DecryptResult gcmOpen(AesGcm::Key& key, std::span<const uint8_t> packet, std::span<uint8_t> out);
+    void xorBatch(const ChaCha20::State& st, std::span<BatchPacket> packets);
+    void gcmBatch(AesGcm::Key& key, std::span<BatchPacket> packets);
+
+    /// Before init() and for unknown request types: UnknownAlgorithm, not counted
+    DecryptResult decryptUnknown(std::span<const uint8_t>, std::span<uint8_t>) noexcept;
+    DecryptResult verifyUnknown(std::span<const uint8_t>) noexcept;
+    BatchResult decryptBatchUnknown(std::span<BatchPacket> packets) noexcept;
+
+    /// What the runtime decrypt() / verify() / decryptBatch() call, set by init()
+    struct Bound {
+        DecryptResult (CryptoEngine::*decrypt)(std::span<const uint8_t>, std::span<uint8_t>) noexcept;
+        DecryptResult (CryptoEngine::*verify)(std::span<const uint8_t>) noexcept;
+        BatchResult   (CryptoEngine::*batch)(std::span<BatchPacket>) noexcept;
+    };
+
+    ChaCha20::State            _chacha{};      ///< 0x01/0x02: key, nonce, counter 1
+    ChaCha20::State            _chacha12{};    ///< 0x04: the same with 12 rounds
+    ChaCha20::State            _chacha8{};     ///< 0x05: the same with 8 rounds
+    ChaCha20::State            _xchacha{};     ///< 0x06: HChaCha20 subkey, 0 || XNONCE[16..24], counter 1
+    AesGcm::Key                _gcm;           ///< 0x03: round keys, H powers, mbedTLS context
+    AesGcm::Key                _gcm128;        ///< 0x07: the same for the first 16 key bytes
+    mbedtls_ccm_context        _ccm;           ///< 0x08: AES-256 key schedule
+    std::array<uint8_t, 12>    _nonce = AppConstants::NONCE;
+    KeystreamCache             _ksCache;
+    size_t                     _ksCacheBytes = 0;  ///< requested size, 0 = off
+    std::atomic<bool>          _ksPerPacketNonce{ false };
+    std::atomic<size_t>        _ksFootprint{ 0 };
+    std::atomic<uint64_t>      _ksHits{ 0 }, _ksMisses{ 0 };
+    const CipherSuite*         _suite = nullptr;
+    Bound                      _bound{ &CryptoEngine::decryptUnknown, &CryptoEngine::verifyUnknown,
+                                       &CryptoEngine::decryptBatchUnknown };
+    std::array<AtomicCounters, CipherSuites::size> _counters{};     ///< in registry order
 };
 
 #endif //CRYPTO_H
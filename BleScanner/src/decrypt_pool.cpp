@@ -0,0 +1,192 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "decrypt_pool.h"
+#include <chrono>
+#include <cstring>
+
+struct DecryptPool::Stream {
+    uint64_t   id          = 0;
+    uint8_t    requestType = 0;
+    Delivery   cb{};
+
+    std::mutex              mutex;
+    std::condition_variable drained;
+    bool     started   = false;
+    uint64_t next      = 0;             ///< seq delivered next
+    uint64_t submitted = 0;
+    uint64_t delivered = 0;
+    std::vector<int32_t> parked;        ///< job slot per seq % capacity, -1 = not finished yet
+};
+
+DecryptPool::DecryptPool(uint32_t workers, uint32_t capacity)
+    : _capacity(capacity ? capacity : 1), _jobs(_capacity) {
+    if (workers < 1) workers = 1;
+    _queue.resize(_capacity);
+    _free.reserve(_capacity);
+    for (uint32_t i = _capacity; i-- > 0;) _free.push_back(i);
+
+    _workerPackets = std::make_unique<std::atomic<uint64_t>[]>(workers);
+    _workerBusyNs  = std::make_unique<std::atomic<uint64_t>[]>(workers);
+    _threads.reserve(workers);
+    for (uint32_t i = 0; i < workers; ++i) {
+        _threads.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+DecryptPool::~DecryptPool() {
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        _stopping = true;
+    }
+    _queueCv.notify_all();
+    _freeCv.notify_all();
+    for (auto& t : _threads) t.join();
+}
+
+DecryptPool::Stream* DecryptPool::openStream(uint64_t id, uint8_t requestType, Delivery cb) {
+    auto s = std::make_unique<Stream>();
+    s->id          = id;
+    s->requestType = requestType;
+    s->cb          = std::move(cb);
+    s->parked.assign(_capacity, -1);
+    Stream* handle = s.get();
+    std::lock_guard<std::mutex> lock(_streamsMutex);
+    _streams.emplace(handle, std::move(s));
+    return handle;
+}
+
+bool DecryptPool::submit(Stream* stream, uint64_t seq, std::span<const uint8_t> packet, double rttMs) {
+    if (!stream || packet.size() > PacketRing::SLOT_BYTES) return false;
+
+    uint32_t idx;
+    {
+        std::unique_lock<std::mutex> lock(_queueMutex);
+        if (_free.empty()) {
+            _stalls.fetch_add(1, std::memory_order_relaxed);
+            _freeCv.wait(lock, [this]() { return !_free.empty() || _stopping; });
+        }
+        if (_stopping) return false;
+        idx = _free.back();
+        _free.pop_back();
+    }
+
+    // the slot is ours until a worker completes it
+    Job& job   = _jobs[idx];
+    job.stream = stream;
+    job.seq    = seq;
+    job.length = static_cast<uint32_t>(packet.size());
+    job.rttMs  = rttMs;
+    if (!packet.empty()) std::memcpy(job.in.data(), packet.data(), packet.size());
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (!stream->started) {
+            stream->started = true;
+            stream->next = seq;
+        }
+        ++stream->submitted;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        _queue[(_queueHead + _queueCount) % _capacity] = idx;
+        ++_queueCount;
+    }
+    _queueCv.notify_one();
+    _submitted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void DecryptPool::workerLoop(uint32_t index) {
+    using clock = std::chrono::steady_clock;
+    CryptoEngine engine;
+    std::vector<uint32_t> freed;
+    freed.reserve(_capacity);
+
+    while (true) {
+        uint32_t idx;
+        {
+            std::unique_lock<std::mutex> lock(_queueMutex);
+            _queueCv.wait(lock, [this]() { return _queueCount > 0 || _stopping; });
+            if (_queueCount == 0) return;       // stopping and nothing left
+            idx = _queue[_queueHead];
+            _queueHead = (_queueHead + 1) % _capacity;
+            --_queueCount;
+        }
+
+        Job& job = _jobs[idx];
+        engine.init(job.stream->requestType);
+        auto t0 = clock::now();
+        DecryptResult r = engine.decrypt(std::span<const uint8_t>(job.in.data(), job.length), job.plain);
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count();
+
+        job.out.seq       = job.seq;
+        job.out.result    = r;
+        job.out.plain     = std::span<const uint8_t>(job.plain.data(), r.length);
+        job.out.rttMs     = job.rttMs;
+        job.out.decryptMs = ns / 1e6;
+        job.out.worker    = index;
+        _workerPackets[index].fetch_add(1, std::memory_order_relaxed);
+        _workerBusyNs[index].fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed);
+
+        complete(idx, freed);
+        if (!freed.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(_queueMutex);
+                _free.insert(_free.end(), freed.begin(), freed.end());
+            }
+            _freeCv.notify_all();
+            freed.clear();
+        }
+    }
+}
+
+void DecryptPool::complete(uint32_t idx, std::vector<uint32_t>& freed) {
+    Job& job = _jobs[idx];
+    Stream& s = *job.stream;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (job.seq != s.next) _heldBack.fetch_add(1, std::memory_order_relaxed);
+    s.parked[job.seq % _capacity] = static_cast<int32_t>(idx);
+
+    // deliver the run of finished packets that starts at the next expected seq
+    int32_t* slot;
+    while (*(slot = &s.parked[s.next % _capacity]) >= 0) {
+        const uint32_t j = static_cast<uint32_t>(*slot);
+        *slot = -1;
+        if (s.cb) s.cb(_jobs[j].out);
+        ++s.next;
+        ++s.delivered;
+        freed.push_back(j);
+    }
+    _delivered.fetch_add(freed.size(), std::memory_order_relaxed);
+    if (s.delivered == s.submitted) s.drained.notify_all();
+}
+
+void DecryptPool::drain(Stream* stream) {
+    if (!stream) return;
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    stream->drained.wait(lock, [stream]() { return stream->delivered == stream->submitted; });
+}
+
+void DecryptPool::closeStream(Stream* stream) {
+    if (!stream) return;
+    drain(stream);
+    std::lock_guard<std::mutex> lock(_streamsMutex);
+    _streams.erase(stream);
+}
+
+DecryptPoolStats DecryptPool::stats() const {
+    DecryptPoolStats st;
+    st.workers      = workers();
+    st.capacity     = _capacity;
+    st.submitted    = _submitted.load(std::memory_order_relaxed);
+    st.delivered    = _delivered.load(std::memory_order_relaxed);
+    st.heldBack     = _heldBack.load(std::memory_order_relaxed);
+    st.submitStalls = _stalls.load(std::memory_order_relaxed);
+    st.perWorker.resize(st.workers);
+    for (uint32_t i = 0; i < st.workers; ++i) {
+        st.perWorker[i] = _workerPackets[i].load(std::memory_order_relaxed);
+        st.busyMs += _workerBusyNs[i].load(std::memory_order_relaxed) / 1e6;
+    }
+    return st;
+}
@@ -0,0 +1,120 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef DECRYPT_POOL_H
+#define DECRYPT_POOL_H
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "crypto.h"
+#include "packet_ring.h"
+
+/// One decrypted packet as handed to its stream's delivery callback
+struct DecryptedPacket {
+    uint64_t      seq       = 0;            ///< sequence index given to submit()
+    DecryptResult result{};
+    std::span<const uint8_t> plain{};       ///< valid during the callback
+    double        rttMs     = 0.0;          ///< as given to submit()
+    double        decryptMs = 0.0;
+    uint32_t      worker    = 0;
+};
+
+/// Counters of a DecryptPool
+struct DecryptPoolStats {
+    uint32_t workers      = 0;
+    uint32_t capacity     = 0;      ///< packets in flight (queued, decrypting or waiting for an older one)
+    uint64_t submitted    = 0;
+    uint64_t delivered    = 0;
+    uint64_t heldBack     = 0;      ///< finished before an older packet of their stream, delivered later
+    uint64_t submitStalls = 0;      ///< submit() calls that waited for a free slot
+    double   busyMs       = 0.0;    ///< decrypt time summed over the workers
+    std::vector<uint64_t> perWorker;    ///< packets decrypted by each worker
+};
+
+/// Pool of decrypt workers, each with its own CryptoEngine. Packets of several streams
+/// (one per device) go through one job queue; every stream gets its plaintext back in
+/// submit order, whichever worker finished first. Payloads are copied into preallocated
+/// job slots, so the submitter's buffer (a PacketRing slot) may be reused right away;
+/// when all slots are in flight submit() waits.
+class DecryptPool {
+public:
+    using Delivery = std::function<void(const DecryptedPacket&)>;
+
+    /// Per-stream reassembly state, opaque to callers
+    struct Stream;
+
+    /// @param workers  decrypt threads (at least 1)
+    /// @param capacity job slots, bounds the packets in flight and the reorder distance
+    explicit DecryptPool(uint32_t workers, uint32_t capacity = 256);
+    ~DecryptPool();
+
+    DecryptPool(const DecryptPool&) = delete;
+    DecryptPool& operator=(const DecryptPool&) = delete;
+
+    /// Registers a stream; its sequence starts at the first seq submitted
+    /// @param cb called in seq order, never concurrently for the same stream
+    /// @return handle for submit/drain/closeStream, valid until closeStream()
+    Stream* openStream(uint64_t id, uint8_t requestType, Delivery cb);
+
+    /// Queues a packet. Seqs of a stream must be submitted in order and without gaps.
+    /// @return false if the packet is longer than a slot or the pool is shutting down
+    bool submit(Stream* stream, uint64_t seq, std::span<const uint8_t> packet, double rttMs);
+
+    /// Blocks until everything submitted to the stream was delivered
+    void drain(Stream* stream);
+
+    /// drain() and forget the stream
+    void closeStream(Stream* stream);
+
+    uint32_t workers() const { return static_cast<uint32_t>(_threads.size()); }
+    DecryptPoolStats stats() const;
+
+private:
+    struct Job {
+        Stream*  stream = nullptr;
+        uint64_t seq    = 0;
+        uint32_t length = 0;
+        double   rttMs  = 0.0;
+        DecryptedPacket out{};
+        alignas(64) std::array<uint8_t, PacketRing::SLOT_BYTES> in{};
+        alignas(64) std::array<uint8_t, PacketRing::SLOT_BYTES> plain{};
+    };
+
+    void workerLoop(uint32_t index);
+    /// Parks a finished job and delivers every consecutive one from the stream's next seq
+    void complete(uint32_t job, std::vector<uint32_t>& freed);
+
+    const uint32_t _capacity;
+    std::vector<Job> _jobs;
+
+    mutable std::mutex      _queueMutex;
+    std::condition_variable _queueCv;      ///< workers: a job was queued
+    std::condition_variable _freeCv;       ///< submitters: a slot was freed
+    std::vector<uint32_t>   _free;         ///< free job slots (stack)
+    std::vector<uint32_t>   _queue;        ///< FIFO ring of queued job slots
+    uint32_t                _queueHead  = 0;
+    uint32_t                _queueCount = 0;
+    bool                    _stopping   = false;
+
+    mutable std::mutex _streamsMutex;
+    std::unordered_map<Stream*, std::unique_ptr<Stream>> _streams;
+
+    std::vector<std::thread> _threads;
+    std::unique_ptr<std::atomic<uint64_t>[]> _workerPackets;
+    std::unique_ptr<std::atomic<uint64_t>[]> _workerBusyNs;
+    std::atomic<uint64_t> _submitted{ 0 }, _delivered{ 0 }, _heldBack{ 0 }, _stalls{ 0 };
+};
+
+#endif //DECRYPT_POOL_H
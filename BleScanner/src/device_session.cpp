@@ -0,0 +1,598 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "device_session.h"
+#include "alloc_counter.h"
+#include "constants.h"
+#include "gatt_cache.h"
+#include <algorithm>
+#include <cstdio>
+
+static_assert(PacketRing::SLOT_BYTES >= AppConstants::MAX_NOTIFICATION_BYTES,
+              "a ring slot must hold the longest notification");
+
+const char* sessionStateName(SessionState state) {
+    switch (state) {
+        case SessionState::Waiting:      return "Waiting";
+        case SessionState::Connecting:   return "Connecting";
+        case SessionState::Transferring: return "Transferring";
+        case SessionState::Done:         return "Done";
+        case SessionState::Stopped:      return "Stopped";
+        case SessionState::Failed:       return "Failed";
+    }
+    return "?";
+}
+
+DeviceSession::DeviceSession(uint64_t address, SessionConfig cfg)
+    : _address(address), _cfg(cfg) {
+    _stats.address = address;
+    if (_cfg.decrypt) _crypto.init(_cfg.requestType);
+    if (_cfg.decrypt && _cfg.keystreamCache) _crypto.setKeystreamCache(true, PacketRing::SLOT_BYTES);
+    if (_cfg.decrypt && _cfg.batchDecrypt) {
+        _batch.resize(_ring.slots());
+        _batchViews.resize(_ring.slots());
+        _batchPlain.resize(static_cast<size_t>(_ring.slots()) * PacketRing::SLOT_BYTES);
+    }
+}
+
+DeviceSession::~DeviceSession() {
+    stop();
+}
+
+bool DeviceSession::claim() {
+    auto expected = SessionState::Waiting;
+    return _state.compare_exchange_strong(expected, SessionState::Connecting);
+}
+
+void DeviceSession::logGattCache(const BleTransport& transport) {
+    auto cache = transport.gattCache();
+    if (!_logCb || !cache) return;
+    auto st = cache->stats();
+    char buf[160];
+    std::snprintf(buf, sizeof(buf),
+                  "GATT cache: %u cached / %u uncached discoveries, connect time saved %.2f ms",
+                  st.cachedDiscoveries, st.uncachedDiscoveries, st.connectSavedMs());
+    _logCb(buf);
+}
+
+bool DeviceSession::connect(BleTransport& transport) {
+    _state = SessionState::Connecting;
+    auto t0 = std::chrono::steady_clock::now();
+
+    auto conn = transport.connect(_address);
+    if (!conn) {
+        if (_logCb) _logCb("Failed to connect");
+        _state = SessionState::Failed;
+        return false;
+    }
+    _connection = std::move(conn);
+    if (_logCb) _logCb("Connected to: " + _connection->name());
+
+    // Discover P2P service
+    std::vector<BleCharacteristicInfo> characteristics;
+    if (!_connection->discover(characteristics)) {
+        if (_logCb) _logCb("P2P service not found");
+        _state = SessionState::Failed;
+        return false;
+    }
+
+    logGattCache(transport);
+
+    if (_logCb) {
+        _logCb("Service characteristics:");
+        for (auto const& c : characteristics) {
+            char buf[128];
+            std::snprintf(buf, sizeof(buf),
+                          "  • UUID: %s, props: 0x%02X",
+                          c.uuid.c_str(),
+                          c.properties);
+            _logCb(buf);
+        }
+    }
+
+    _connectedAt = std::chrono::steady_clock::now();
+    if (_cfg.decrypt && _pool && !_poolStream) {
+        _poolStream = _pool->openStream(_address, _cfg.requestType,
+                                        [this](const DecryptedPacket& p) { onDecrypted(p); });
+    } else if (_cfg.decrypt && _cfg.batchDecrypt && !_decryptThread.joinable()) {
+        _decryptStop = false;
+        _decryptNext = _ring.head();
+        _decryptThread = std::thread([this]() { decryptLoop(); });
+    }
+    enableDataNotifications();
+    enableTimingNotifications();
+
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    _stats.name = _connection->name();
+    _stats.connectMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return true;
+}
+
+void DeviceSession::startTransfer(double seedRateBps) {
+    if (!_connection || _thread.joinable()) return;
+    _running = true;
+    _state = SessionState::Transferring;
+    if (_cfg.adaptivePacing) _pacingCtl.reset(seedRateBps);
+    _thread = std::thread([this]() { transfer(); });
+}
+
+void DeviceSession::stop() {
+    _running = false;
+    _pipeline.abort();
+    if (_thread.joinable()) _thread.join();
+
+    if (_connection) {
+        if (_logCb) _logCb("Disconnecting device");
+        uint64_t failed = _connection->failedWrites();
+        _connection->close();
+        _connection.reset();
+        if (failed && _logCb) _logCb("Failed request writes: " + std::to_string(failed));
+    }
+    // after close, so the pool / decrypt thread gets through the last notifications
+    if (_poolStream) {
+        _pool->closeStream(_poolStream);
+        _poolStream = nullptr;
+    }
+    if (_decryptThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(_decryptMutex);
+            _decryptStop = true;
+        }
+        _decryptCv.notify_one();
+        _decryptThread.join();
+    }
+    auto st = _state.load();
+    if (st == SessionState::Waiting || st == SessionState::Connecting || st == SessionState::Transferring) {
+        _state = SessionState::Stopped;
+    }
+}
+
+void DeviceSession::transfer() {
+    uint32_t total     = _cfg.bytesToRequest;
+    uint32_t sentSoFar = 0;
+    const uint32_t overhead = AppConstants::responseOverhead(_cfg.requestType);
+    // a longer response wouldn't fit one notification (nor a ring slot)
+    const uint32_t word = std::clamp<uint32_t>(_cfg.wordSize, 1, AppConstants::maxWordSize(_cfg.requestType));
+    if (word != _cfg.wordSize && _logCb) {
+        _logCb("Word size " + std::to_string(_cfg.wordSize) + " B clamped to " + std::to_string(word) +
+               " B, the longest response that fits one notification");
+    }
+    const bool paced = _cfg.adaptivePacing || _cfg.interChunkDelayMs > 0;
+    _pacer.reset(_cfg.interChunkDelayMs);
+
+    // clock offset before the transfer, probes during it and a second burst after it give the drift
+    constexpr uint32_t kSyncExchanges = 8;
+    constexpr auto kSyncInterval = std::chrono::milliseconds(50);
+    bool syncing = false;
+    if (_cfg.sequenceIds) {
+        _clock.reset();
+        syncing = syncClock(kSyncExchanges) > 0;
+    }
+    auto lastProbe = std::chrono::steady_clock::now();
+
+    // Windowed pipeline: up to window requests in flight, the next one is released
+    // when the FE44 data of an older one has arrived
+    _pipeline.reset(_cfg.window, AppConstants::REQUEST_TIMEOUT_MS,
+                    2 * (total / word + 1));
+    if (_cfg.adaptivePacing) {
+        _pipeline.setListener(
+            [this](double rttMs, bool windowLimited) { _pacingCtl.onAck(rttMs, windowLimited); },
+            [this]() { _pacingCtl.onLoss(); });
+    }
+
+    constexpr int kMaxRefills = 8;
+    int  refills = 0;
+    bool drained = false;
+    while (_running) {
+        while (sentSoFar < total && _running) {
+            if (!_pipeline.acquire(_running)) break;
+            uint32_t remaining = total - sentSoFar;
+            uint32_t thisChunk = (remaining < word) ? remaining : word;
+            if (_cfg.adaptivePacing) _pacer.setInterval(_pacingCtl.intervalMs(thisChunk));
+            if (paced && !_pacer.wait(_running)) break;
+            const uint32_t id = _pipeline.onSent(thisChunk, thisChunk + overhead);
+            if (sentSoFar == 0) {
+                std::lock_guard<std::mutex> lock(_statsMutex);
+                _stats.firstSend = std::chrono::steady_clock::now();
+            }
+            if (!sendDataToDevice(_cfg.requestType, thisChunk, id)) break;
+            sentSoFar += thisChunk;
+            if (syncing && std::chrono::steady_clock::now() - lastProbe >= kSyncInterval) {
+                probeClock();
+                lastProbe = std::chrono::steady_clock::now();
+            }
+            if (_cfg.adaptivePacing) _pipeline.setTimeout(_pacingCtl.timeoutMs());
+        }
+        drained = _pipeline.drain(_running);
+        if (!drained || !_cfg.adaptivePacing) break;
+
+        // re-request what the MCU dropped, the stream continues where it stopped; responses
+        // of given-up requests may still come and are credited, so wait those out first
+        auto st = _pipeline.stats();
+        if (st.requestsTimedOut + st.requestsLost + st.requestsDropped == 0) break;
+        if (!_pipeline.settle(_running)) { drained = false; break; }
+        st = _pipeline.stats();
+        if (st.bytesCompleted >= _cfg.bytesToRequest) break;
+        if (++refills > kMaxRefills) break;
+        total = sentSoFar + static_cast<uint32_t>(_cfg.bytesToRequest - st.bytesCompleted);
+    }
+    // also after a stalled transfer, the requests that did complete still need the drift
+    if (syncing && _running) syncClock(kSyncExchanges);
+    if (drained) logPipeline();
+    if (paced) logPacer();
+    if (_cfg.adaptivePacing) logPacing();
+    if (drained && _cfg.sequenceIds) logLatency();
+    if (drained) _state = SessionState::Done;
+}
+
+SessionStats DeviceSession::stats() const {
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    SessionStats st = _stats;
+    st.state    = _state;
+    st.pipeline = _pipeline.stats();
+    st.keystreamCache = _crypto.keystreamCacheStats();
+    return st;
+}
+
+void DeviceSession::logPipeline() {
+    if (!_logCb) return;
+    auto st = _pipeline.stats();
+    char buf[192];
+    std::snprintf(buf, sizeof(buf),
+                  "Pipeline: window %u, depth avg %.2f max %u, stall %.2f ms, %llu/%llu done (%llu timed out), %.2f B/s",
+                  st.window, st.avgDepth, st.maxDepth, st.stallMs,
+                  static_cast<unsigned long long>(st.requestsCompleted),
+                  static_cast<unsigned long long>(st.requestsSent),
+                  static_cast<unsigned long long>(st.requestsTimedOut),
+                  st.bytesPerSecond());
+    _logCb(buf);
+    if (_cfg.sequenceIds) {
+        std::snprintf(buf, sizeof(buf),
+                      "Sequence IDs: %llu reordered, %llu lost, %llu late (%llu recovered), %llu stray responses",
+                      static_cast<unsigned long long>(st.reordered), static_cast<unsigned long long>(st.requestsLost),
+                      static_cast<unsigned long long>(st.lateResponses), static_cast<unsigned long long>(st.requestsRecovered),
+                      static_cast<unsigned long long>(st.strayResponses));
+        _logCb(buf);
+    }
+}
+
+void DeviceSession::logPacer() {
+    if (!_logCb) return;
+    auto st = _pacer.stats();
+    char buf[192];
+    std::snprintf(buf, sizeof(buf),
+                  "Pacer: requested %.1f µs, actual %.1f µs (min %.1f max %.1f), jitter %.1f µs, drift %.1f µs, %llu/%llu late",
+                  st.requestedUs, st.meanUs, st.minUs, st.maxUs, st.jitterUs, st.driftUs,
+                  static_cast<unsigned long long>(st.lateGaps), static_cast<unsigned long long>(st.gaps));
+    _logCb(buf);
+}
+
+void DeviceSession::logPacing() {
+    if (!_logCb) return;
+    double converged = _pacingCtl.convergedRateBps();
+    auto traj = _pacingCtl.trajectory();
+    size_t decreases = 0;
+    for (auto const& p : traj) {
+        if (p.event == PacingEvent::DecreaseLoss || p.event == PacingEvent::DecreaseRtt) ++decreases;
+    }
+    char buf[192];
+    std::snprintf(buf, sizeof(buf),
+                  "Adaptive pacing: converged %.2f B/s (start %.2f B/s), %zu rate changes, %zu backoffs, min RTT %.3f ms",
+                  converged, traj.empty() ? 0.0 : traj.front().rateBps, traj.size() - 1, decreases,
+                  traj.empty() ? 0.0 : traj.back().minRttMs);
+    _logCb(buf);
+}
+
+bool DeviceSession::writeSyncRequest() {
+    uint16_t seq;
+    {
+        std::lock_guard<std::mutex> lock(_syncMutex);
+        seq = ++_syncSeq;
+        _syncPending = true;
+        _syncSent = std::chrono::steady_clock::now();
+    }
+    const uint8_t frame[3 + AppConstants::SEQ_HEADER_BYTES] = {
+        static_cast<uint8_t>(AppConstants::SYNC_REQUEST | AppConstants::SEQ_FLAG), 0, 0,
+        static_cast<uint8_t>(seq >> 8), static_cast<uint8_t>(seq)
+    };
+    return _connection->writeRequest(frame);
+}
+
+uint32_t DeviceSession::syncClock(uint32_t exchanges) {
+    uint32_t replies = 0;
+    for (uint32_t i = 0; i < exchanges && _connection; ++i) {
+        if (!writeSyncRequest()) break;
+
+        std::unique_lock<std::mutex> lock(_syncMutex);
+        if (!_syncCv.wait_for(lock, std::chrono::milliseconds(100), [this]() { return !_syncPending; })) {
+            _syncPending = false;
+            break;      // firmware without clock sync, or the link is gone
+        }
+        ++replies;
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    if (replies == 0 && _logCb) _logCb("Clock sync: no reply, latency breakdown unavailable");
+    return replies;
+}
+
+void DeviceSession::probeClock() {
+    if (!_connection) return;
+    {
+        std::lock_guard<std::mutex> lock(_syncMutex);
+        // the previous probe is still on its way, a lost one is given up after the syncClock() timeout
+        if (_syncPending && std::chrono::steady_clock::now() - _syncSent < std::chrono::milliseconds(100)) return;
+    }
+    writeSyncRequest();
+}
+
+void DeviceSession::onSyncReply(std::span<const uint8_t> buf, std::chrono::steady_clock::time_point t4) {
+    auto le32 = [&](size_t at) {
+        return static_cast<uint32_t>(buf[at]) | (static_cast<uint32_t>(buf[at + 1]) << 8) |
+               (static_cast<uint32_t>(buf[at + 2]) << 16) | (static_cast<uint32_t>(buf[at + 3]) << 24);
+    };
+    const uint16_t seq = static_cast<uint16_t>((buf[1] << 8) | buf[2]);
+    {
+        std::lock_guard<std::mutex> lock(_syncMutex);
+        if (!_syncPending || seq != _syncSeq) return;     // a reply we stopped waiting for
+        _clock.addExchange(_syncSent, le32(3), le32(7), t4);
+        _syncPending = false;
+    }
+    _syncCv.notify_all();
+}
+
+std::vector<LatencyBreakdown> DeviceSession::latencyBreakdown() const {
+    return splitLatency(_pipeline.timeline(), _clock, _pipeline.startTime());
+}
+
+LatencySummary DeviceSession::latencySummary() const {
+    return summarizeLatency(latencyBreakdown(), _clock);
+}
+
+void DeviceSession::logLatency() {
+    if (!_logCb || !_clock.valid()) return;
+    auto sum = latencySummary();
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "Clock sync: offset %.1f µs, drift %s, min delay %.1f µs, ±%.1f µs (%u/%u samples)",
+                  sum.clock.offsetUs, describeDrift(sum.clock).c_str(), sum.clock.minDelayUs, sum.clock.residualUs,
+                  sum.clock.used, sum.clock.samples);
+    _logCb(buf);
+    if (sum.requests == 0) return;
+    int n = std::snprintf(buf, sizeof(buf), "Latency (mean µs over %u requests):", sum.requests);
+    for (int p = 0; p < LatencyBreakdown::PartCount && n > 0 && n < static_cast<int>(sizeof(buf)); ++p) {
+        n += std::snprintf(buf + n, sizeof(buf) - n, "%s %s %.1f", p ? "," : "", LatencyBreakdown::partName(p), sum.meanUs[p]);
+    }
+    _logCb(buf);
+}
+
+void DeviceSession::decryptLoop() {
+    std::unique_lock<std::mutex> lock(_decryptMutex);
+    while (true) {
+        _decryptCv.wait(lock, [this]() { return _decryptStop || _ring.head() > _decryptNext; });
+        const bool stopping = _decryptStop;
+        lock.unlock();
+        decryptPending();
+        lock.lock();
+        if (stopping && _ring.head() <= _decryptNext) return;
+    }
+}
+
+void DeviceSession::decryptPending() {
+    const uint64_t head  = _ring.head();
+    const uint32_t slots = _ring.slots();
+    uint64_t overrun = 0;
+    if (head - _decryptNext > slots) {
+        overrun = head - slots - _decryptNext;      // already overwritten
+        _decryptNext = head - slots;
+    }
+
+    uint32_t n = 0;
+    for (uint64_t seq = _decryptNext; seq < head; ++seq, ++n) {
+        PacketView& view = _batchViews[n];
+        BatchPacket& p   = _batch[n];
+        if (!_ring.at(seq, view)) view.data = {};
+        p.in  = view.data;
+        p.out = std::span<uint8_t>(_batchPlain.data() + static_cast<size_t>(n) * PacketRing::SLOT_BYTES,
+                                   PacketRing::SLOT_BYTES);
+    }
+    _decryptNext = head;
+    if (n == 0 && overrun == 0) return;
+
+    auto res = _crypto.decryptBatch(std::span<BatchPacket>(_batch.data(), n));
+
+    // the writer may have lapped the oldest slots while they were decrypted
+    const uint64_t lapped = _ring.head() - (head - n);
+    const uint32_t torn = lapped > slots ? static_cast<uint32_t>(std::min<uint64_t>(lapped - slots, n)) : 0;
+
+    uint64_t failures = overrun, tagFailures = 0, plainBytes = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        const DecryptResult& r = _batch[i].result;
+        if (i < torn || !r) {
+            ++failures;
+            if (i >= torn && r.status == DecryptStatus::TagMismatch) ++tagFailures;
+            continue;
+        }
+        plainBytes += r.length;
+        if (_plainCb) _plainCb(_address, std::span<const uint8_t>(_batch[i].out.data(), r.length), _batchViews[i].rttMs);
+    }
+    if (res.failed && _logCb) {
+        char buf[96];
+        std::snprintf(buf, sizeof(buf), "Decrypt failed for %u of %u packets in a batch", res.failed, n);
+        _logCb(buf);
+    }
+
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    ++_stats.batches;
+    _stats.maxBatch = std::max(_stats.maxBatch, n);
+    _stats.plaintextBytes  += plainBytes;
+    _stats.decryptFailures += failures;
+    _stats.tagFailures     += tagFailures;
+    _stats.ringOverruns    += torn + overrun;
+    _stats.hostDecryptMs   += res.ms;
+}
+
+void DeviceSession::onDecrypted(const DecryptedPacket& packet) {
+    if (packet.result && _plainCb) _plainCb(_address, packet.plain, packet.rttMs);
+    if (!packet.result && _logCb) _logCb(std::string("Decrypt failed: ") + decryptStatusName(packet.result.status));
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    if (packet.result) _stats.plaintextBytes += packet.result.length;
+    else               ++_stats.decryptFailures;
+    if (packet.result.status == DecryptStatus::TagMismatch) ++_stats.tagFailures;
+    _stats.hostDecryptMs += packet.decryptMs;
+}
+
+void DeviceSession::enableDataNotifications() {
+    bool ok = _connection->subscribeData([this](std::span<const uint8_t> value) {
+        const uint64_t allocs0 = AllocCounter::thread();
+        auto end = std::chrono::steady_clock::now();
+
+        // extended responses start with the seq of their request
+        uint32_t seq = RequestPipeline::kNoSeq;
+        if (_cfg.sequenceIds) {
+            if (value.size() < AppConstants::SEQ_HEADER_BYTES) return;     // not a response of ours
+            seq = (static_cast<uint32_t>(value[0]) << 8) | value[1];
+            value = value.subspan(AppConstants::SEQ_HEADER_BYTES);
+        }
+        double diffMs = AppConstants::meastureAllTime
+            ? std::chrono::duration<double, std::milli>(end - _connectedAt).count()
+            : _pipeline.elapsedSinceSent(seq);
+
+        // the only copy of the payload, every stage below reads the ring slot
+        PacketView packet = _ring.push(value, end, diffMs);
+        const bool stored = packet.data.size() == value.size();
+        if (!stored && _logCb) _logCb("Notification of " + std::to_string(value.size()) + " B exceeds the packet slot, dropped");
+
+        if (stored && _dataCb) _dataCb(packet);
+
+        // decrypted later by the pool or the batch thread, which keep their own counters
+        const bool pooled   = stored && _poolStream;
+        const bool deferred = _cfg.decrypt && (_cfg.batchDecrypt || _poolStream);
+        double ms = 0.0;
+        DecryptResult plain{ DecryptStatus::Failed, 0 };
+        if (stored && _cfg.decrypt && !deferred) {
+            auto t0 = std::chrono::steady_clock::now();
+            plain = _crypto.decrypt(packet.data, _plain);
+            ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            if (!plain && _logCb) _logCb(std::string("Decrypt failed: ") + decryptStatusName(plain.status));
+        }
+        if (plain && _plainCb) _plainCb(_address, std::span<const uint8_t>(_plain.data(), plain.length), diffMs);
+        if (pooled) {
+            if (!_pool->submit(_poolStream, packet.seq, packet.data, diffMs)) {
+                std::lock_guard<std::mutex> lock(_statsMutex);
+                ++_stats.decryptFailures;
+            }
+        } else if (stored && deferred) {
+            { std::lock_guard<std::mutex> lock(_decryptMutex); }    // no lost wakeup between check and wait
+            _decryptCv.notify_one();
+        }
+        {
+            const uint64_t allocs = AllocCounter::thread() - allocs0;
+            std::lock_guard<std::mutex> lock(_statsMutex);
+            ++_stats.packets;
+            _stats.bytesReceived += value.size();
+            _stats.lastData = end;
+            if (!stored) ++_stats.oversized;
+            if (_cfg.decrypt && stored && !deferred) {
+                if (plain) _stats.plaintextBytes += plain.length;
+                else       ++_stats.decryptFailures;
+                if (plain.status == DecryptStatus::TagMismatch) ++_stats.tagFailures;
+                _stats.hostDecryptMs += ms;
+            }
+            _stats.handlerAllocations += allocs;
+            if (packet.seq >= kWarmupPackets) _stats.steadyAllocations += allocs;
+        }
+        // a packet that wasn't kept doesn't complete its request
+        if (stored) _pipeline.onResponse(value.size(), seq, end);
+        else        _pipeline.onDropped(seq, end);
+    });
+    if (!ok) {
+        if (_logCb) _logCb("Data-out characteristic not found");
+        return;
+    }
+    if (_logCb) _logCb("Data notifications enabled");
+}
+
+void DeviceSession::enableTimingNotifications() {
+    bool ok = _connection->subscribeTiming([this](std::span<const uint8_t> buf) {
+        if (buf.size() == AppConstants::SYNC_REPLY_BYTES &&
+            buf[0] == (AppConstants::SYNC_REQUEST | AppConstants::SEQ_FLAG)) {
+            onSyncReply(buf, std::chrono::steady_clock::now());
+            return;
+        }
+        if (buf.size() < 4) {
+            if (_logCb) _logCb("Timing: payload too small for uint32");
+            return;
+        }
+
+        uint32_t us =
+            static_cast<uint32_t>(buf[0]) |
+            (static_cast<uint32_t>(buf[1]) << 8) |
+            (static_cast<uint32_t>(buf[2]) << 16) |
+            (static_cast<uint32_t>(buf[3]) << 24);
+
+        double ms = us / 1000.0;
+        if (_cfg.sequenceIds && buf.size() >= 4 + AppConstants::SEQ_HEADER_BYTES) {
+            auto le32 = [&](size_t at) {
+                return static_cast<uint32_t>(buf[at]) | (static_cast<uint32_t>(buf[at + 1]) << 8) |
+                       (static_cast<uint32_t>(buf[at + 2]) << 16) | (static_cast<uint32_t>(buf[at + 3]) << 24);
+            };
+            McuTiming timing;
+            timing.cipherUs = us;
+            if (buf.size() >= AppConstants::TIMING_EXT_BYTES) {
+                timing.stamped = true;
+                timing.rxUs    = le32(6);
+                timing.startUs = le32(10);
+                timing.doneUs  = le32(14);
+            }
+            _pipeline.onMcuTiming((static_cast<uint32_t>(buf[4]) << 8) | buf[5], timing);
+        }
+
+        if (_logCb) {
+            char msg[64];
+            std::snprintf(msg, sizeof(msg),
+                          "Cipher time on MCU: %u µs → %.3f ms", us, ms);
+            _logCb(msg);
+        }
+        {
+            std::lock_guard<std::mutex> lock(_statsMutex);
+            _stats.mcuCipherMs += ms;
+        }
+        if (_cipherCb) {
+            _cipherCb(ms, 1);
+        }
+    });
+    if (!ok) {
+        if (_logCb) _logCb("Timing characteristic not found");
+        return;
+    }
+    if (_logCb) _logCb("Timing notifications enabled");
+}
+
+bool DeviceSession::sendDataToDevice(uint8_t requestType, uint16_t bytesToRequest, uint32_t requestId) {
+    // [requestType][uint16 length], big-endian like DataWriter's default byte order;
+    // extended frames add the low 16 bits of the request ID as seq
+    const uint8_t frame[3 + AppConstants::SEQ_HEADER_BYTES] = {
+        static_cast<uint8_t>(_cfg.sequenceIds ? (requestType | AppConstants::SEQ_FLAG) : requestType),
+        static_cast<uint8_t>(bytesToRequest >> 8),
+        static_cast<uint8_t>(bytesToRequest & 0xFF),
+        static_cast<uint8_t>(requestId >> 8),
+        static_cast<uint8_t>(requestId & 0xFF)
+    };
+    const size_t frameLen = _cfg.sequenceIds ? sizeof(frame) : 3;
+    if (!_connection->writeRequest(std::span<const uint8_t>(frame, frameLen))) {
+        if (_logCb) _logCb("Data-in characteristic not found");
+        return false;
+    }
+    _pipeline.onWritten(requestId);
+
+    if (_logCb) {
+                char logBuf[64];
+                std::snprintf(logBuf, sizeof(logBuf),
+                              "Request #%u sent (bytesToRequest=%u)",
+                              static_cast<unsigned>(requestId), static_cast<unsigned>(bytesToRequest));
+                _logCb(logBuf);
+            }
+    return true;
+}
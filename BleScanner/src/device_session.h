@@ -0,0 +1,214 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef DEVICE_SESSION_H
+#define DEVICE_SESSION_H
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ble_transport.h"
+#include "clock_sync.h"
+#include "congestion_control.h"
+#include "crypto.h"
+#include "decrypt_pool.h"
+#include "latency_breakdown.h"
+#include "pacer.h"
+#include "packet_ring.h"
+#include "request_pipeline.h"
+
+/// Transfer settings of one device session
+struct SessionConfig {
+    uint8_t  requestType       = 0x01;
+    uint32_t bytesToRequest    = 0;
+    uint32_t wordSize          = 244;
+    double   interChunkDelayMs = 0.0;
+    uint32_t window            = 4;
+    bool     adaptivePacing    = false;
+    bool     decrypt           = false;     ///< decrypt in the session with its own CryptoEngine
+    bool     batchDecrypt      = false;     ///< with decrypt: the FE44 handler only stores the packet, the
+                                            ///< session's decrypt thread takes everything that arrived
+                                            ///< since its last wakeup in one CryptoEngine::decryptBatch()
+    bool     sequenceIds       = false;     ///< extended FE43 frames, responses carry the request's seq;
+                                            ///< also syncs the MCU clock for the latency breakdown
+    bool     keystreamCache    = false;     ///< with decrypt: the session's CryptoEngine caches a ring
+                                            ///< slot's worth of keystream (not the shared decrypt pool)
+};
+
+/// Life cycle of a device session
+enum class SessionState { Waiting, Connecting, Transferring, Done, Stopped, Failed };
+
+/// Per-device counters, a snapshot of DeviceSession
+struct SessionStats {
+    using clock = std::chrono::steady_clock;
+
+    uint64_t     address         = 0;
+    std::string  name;
+    SessionState state           = SessionState::Waiting;
+    double       connectMs       = 0.0;   ///< connect + discovery + subscribe
+    uint64_t     packets         = 0;     ///< FE44 notifications
+    uint64_t     bytesReceived   = 0;     ///< FE44 bytes (ciphertext + tags)
+    uint64_t     plaintextBytes  = 0;     ///< decrypted bytes (SessionConfig::decrypt)
+    uint64_t     decryptFailures = 0;
+    uint64_t     tagFailures     = 0;     ///< of those, authentication failures
+    uint64_t     batches         = 0;     ///< decryptBatch() calls (SessionConfig::batchDecrypt)
+    uint32_t     maxBatch        = 0;     ///< most packets in one of them
+    uint64_t     ringOverruns    = 0;     ///< packets overwritten in the ring before they were decrypted
+    KeystreamCacheStats keystreamCache{}; ///< of the session's CryptoEngine (SessionConfig::keystreamCache)
+    double       hostDecryptMs   = 0.0;
+    double       mcuCipherMs     = 0.0;   ///< sum of FE45 reports
+    uint64_t     oversized       = 0;     ///< notifications too long for a PacketRing slot
+    uint64_t     handlerAllocations = 0;  ///< heap allocations in the FE44 handler, callbacks included (see AllocCounter)
+    uint64_t     steadyAllocations  = 0;  ///< of those, after the first kWarmupPackets packets
+    clock::time_point firstSend{};
+    clock::time_point lastData{};
+    PipelineStats pipeline{};
+
+    double elapsedMs() const {
+        return (lastData > firstSend && firstSend != clock::time_point{})
+            ? std::chrono::duration<double, std::milli>(lastData - firstSend).count() : 0.0;
+    }
+    double bytesPerSecond() const { return pipeline.bytesPerSecond(); }
+};
+
+const char* sessionStateName(SessionState state);
+
+/// One connected P2P peripheral: its connection, request pipeline, pacer, pacing controller,
+/// crypto context and counters. The request loop runs on the session's own thread, so a slow
+/// device only slows itself; notifications arrive on the transport's thread for that link.
+class DeviceSession {
+public:
+    using LogCallback    = std::function<void(const std::string&)>;
+    /// Raw FE44 packet in the session's PacketRing (valid during the call)
+    using DataCallback   = std::function<void(const PacketView&)>;
+    /// (address, plaintext, rtt_ms), only with SessionConfig::decrypt; the span is valid during the call
+    using PlainCallback  = std::function<void(uint64_t, std::span<const uint8_t>, double)>;
+    using CipherCallback = std::function<void(double, int)>;
+
+    /// Packets after which the FE44 handler is expected to run without heap allocations
+    static constexpr uint64_t kWarmupPackets = 8;
+
+    DeviceSession(uint64_t address, SessionConfig cfg);
+    ~DeviceSession();
+
+    DeviceSession(const DeviceSession&) = delete;
+    DeviceSession& operator=(const DeviceSession&) = delete;
+
+    /// Hands decryption to a shared worker pool instead (with SessionConfig::decrypt); the
+    /// plaintext callback then runs on a pool worker, still in packet order. Before connect()
+    void setDecryptPool(DecryptPool* pool) { _pool = pool; }
+
+    /// Callbacks must be set before connect()
+    void onLog(LogCallback cb)          { _logCb = std::move(cb); }
+    void onData(DataCallback cb)        { _dataCb = std::move(cb); }
+    void onPlaintext(PlainCallback cb)  { _plainCb = std::move(cb); }
+    void onCipherTime(CipherCallback cb){ _cipherCb = std::move(cb); }
+
+    uint64_t address() const { return _address; }
+    SessionState state() const { return _state; }
+
+    /// Called by the scheduler when the device's advertisement was seen
+    /// @return false if the session was already claimed
+    bool claim();
+
+    /// Connects, discovers the P2P service and enables notifications (blocking)
+    /// @return false on failure, the session is then Failed
+    bool connect(BleTransport& transport);
+
+    /// Runs the request loop on the session's thread
+    /// @param seedRateBps start rate of adaptive pacing (0 = controller default)
+    void startTransfer(double seedRateBps);
+
+    /// Aborts the transfer, joins the session thread and closes the link
+    void stop();
+
+    SessionStats stats() const;
+    PipelineStats pipelineStats() const { return _pipeline.stats(); }
+    const RequestPipeline& pipeline() const { return _pipeline; }
+    const Pacer& pacer() const { return _pacer; }
+    const CongestionController& pacing() const { return _pacingCtl; }
+    PacketRingStats ringStats() const { return _ring.stats(); }
+    const ClockSync& clockSync() const { return _clock; }
+
+    /// Per-request split of the RTT (needs sequenceIds and a firmware answering clock sync)
+    std::vector<LatencyBreakdown> latencyBreakdown() const;
+    LatencySummary latencySummary() const;
+
+private:
+    void transfer();
+    void enableDataNotifications();
+    void enableTimingNotifications();
+    bool sendDataToDevice(uint8_t requestType, uint16_t bytesToRequest, uint32_t requestId);
+    void logGattCache(const BleTransport& transport);
+    void logPipeline();
+    void logPacer();
+    void logPacing();
+    void logLatency();
+    /// Decrypt thread of SessionConfig::batchDecrypt
+    void decryptLoop();
+    void decryptPending();
+    void onDecrypted(const DecryptedPacket& packet);
+    /// NTP-style exchanges over FE43/FE45, one at a time
+    /// @return replies received
+    uint32_t syncClock(uint32_t exchanges);
+    /// One exchange without waiting for the reply, keeps samples coming during a transfer
+    void probeClock();
+    bool writeSyncRequest();
+    void onSyncReply(std::span<const uint8_t> buf, std::chrono::steady_clock::time_point t4);
+
+    const uint64_t  _address;
+    const SessionConfig _cfg;
+
+    std::unique_ptr<BleConnection> _connection;
+    std::thread          _thread;
+    std::atomic<bool>    _running{ false };
+    std::atomic<SessionState> _state{ SessionState::Waiting };
+    RequestPipeline      _pipeline;
+    Pacer                _pacer;
+    CongestionController _pacingCtl;
+    CryptoEngine         _crypto;
+    PacketRing           _ring;       ///< FE44 payloads, written by the notification thread
+    std::array<uint8_t, PacketRing::SLOT_BYTES> _plain{};   ///< decrypt output, reused for every packet
+
+    std::thread             _decryptThread;
+    std::mutex              _decryptMutex;
+    std::condition_variable _decryptCv;
+    bool                    _decryptStop = false;
+    uint64_t                _decryptNext = 0;        ///< ring seq of the next packet to decrypt
+    std::vector<BatchPacket> _batch;                 ///< one entry per ring slot, preallocated
+    std::vector<PacketView>  _batchViews;
+    std::vector<uint8_t>     _batchPlain;            ///< ring slots × SLOT_BYTES of plaintext
+
+    DecryptPool*         _pool = nullptr;
+    DecryptPool::Stream* _poolStream = nullptr;
+    std::chrono::steady_clock::time_point _connectedAt;   ///< RTT base with AppConstants::meastureAllTime
+
+    ClockSync               _clock;
+    std::mutex              _syncMutex;
+    std::condition_variable _syncCv;
+    uint16_t                _syncSeq     = 0;
+    bool                    _syncPending = false;
+    std::chrono::steady_clock::time_point _syncSent{};
+
+    mutable std::mutex   _statsMutex;
+    SessionStats         _stats{};
+
+    LogCallback    _logCb{};
+    DataCallback   _dataCb{};
+    PlainCallback  _plainCb{};
+    CipherCallback _cipherCb{};
+};
+
+#endif //DEVICE_SESSION_H
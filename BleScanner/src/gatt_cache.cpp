@@ -0,0 +1,98 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "gatt_cache.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+GattHandleCache::GattHandleCache(std::string path)
+    : _path(std::move(path)) {
+    load();
+}
+
+bool GattHandleCache::lookup(uint64_t address, GattHandles& out) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entries.find(address);
+    if (it == _entries.end()) return false;
+    out = it->second;
+    return true;
+}
+
+void GattHandleCache::store(uint64_t address, const GattHandles& handles) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entries.find(address);
+    if (it != _entries.end() && it->second == handles) return;
+    _entries[address] = handles;
+    save();
+}
+
+void GattHandleCache::invalidate(uint64_t address) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_entries.erase(address) > 0) save();
+}
+
+void GattHandleCache::recordDiscovery(bool cached, double ms) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (cached) {
+        ++_stats.cachedDiscoveries;
+        _stats.cachedDiscoveryMs += ms;
+    } else {
+        ++_stats.uncachedDiscoveries;
+        _stats.uncachedDiscoveryMs += ms;
+    }
+}
+
+void GattHandleCache::recordStale() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.staleEntries;
+}
+
+void GattHandleCache::recordInvalidation() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.invalidations;
+}
+
+void GattHandleCache::recordLookupCost(double ms) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.lookupMs = ms;
+}
+
+void GattHandleCache::recordChunkWrite() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.chunkLookupsAvoided;
+}
+
+GattCacheStats GattHandleCache::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+// File format: one device per line, "<address hex> <service> <fe43> <fe44> <fe45>"
+void GattHandleCache::load() {
+    if (_path.empty()) return;
+    std::ifstream in(_path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        uint64_t address = 0;
+        unsigned service = 0, dataIn = 0, dataOut = 0, timing = 0;
+        if (!(ss >> std::hex >> address >> service >> dataIn >> dataOut >> timing)) continue;
+        GattHandles h{ static_cast<uint16_t>(service), static_cast<uint16_t>(dataIn),
+                       static_cast<uint16_t>(dataOut), static_cast<uint16_t>(timing) };
+        if (h.valid()) _entries[address] = h;
+    }
+}
+
+void GattHandleCache::save() const {
+    if (_path.empty()) return;
+    std::ofstream out(_path, std::ios::trunc);
+    for (auto const& [address, h] : _entries) {
+        char buf[96];
+        std::snprintf(buf, sizeof(buf), "%012llX %04X %04X %04X %04X\n",
+                      static_cast<unsigned long long>(address),
+                      h.service, h.dataIn, h.dataOut, h.timing);
+        out << buf;
+    }
+}
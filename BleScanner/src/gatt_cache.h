@@ -0,0 +1,78 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef GATT_CACHE_H
+#define GATT_CACHE_H
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// Attribute handles of the P2P service resolved during discovery
+struct GattHandles {
+    uint16_t service = 0;   ///< FE40 service start handle
+    uint16_t dataIn  = 0;   ///< FE43 value handle
+    uint16_t dataOut = 0;   ///< FE44 value handle
+    uint16_t timing  = 0;   ///< FE45 value handle
+
+    bool valid() const { return service && dataIn && dataOut && timing; }
+    bool operator==(const GattHandles&) const = default;
+};
+
+/// Counters showing what the handle cache saves
+struct GattCacheStats {
+    uint32_t uncachedDiscoveries = 0;   ///< full (uncached) service discoveries
+    uint32_t cachedDiscoveries   = 0;   ///< reconnects served from persisted handles
+    uint32_t staleEntries        = 0;   ///< persisted handles that no longer matched the device
+    uint32_t invalidations       = 0;   ///< disconnects / service-changed indications
+    uint64_t chunkLookupsAvoided = 0;   ///< FE43 writes that reused the session handle
+    double   uncachedDiscoveryMs = 0.0; ///< total time of uncached discoveries
+    double   cachedDiscoveryMs   = 0.0; ///< total time of cached discoveries
+    double   lookupMs            = 0.0; ///< last measured cost of one uncached characteristic lookup
+
+    /// Connect time saved by cached discoveries, relative to the average uncached one
+    double connectSavedMs() const {
+        if (uncachedDiscoveries == 0) return 0.0;
+        double avg = uncachedDiscoveryMs / uncachedDiscoveries;
+        return avg * cachedDiscoveries - cachedDiscoveryMs;
+    }
+    /// Time the per-chunk characteristic lookups would have cost
+    double chunkSavedMs() const { return lookupMs * static_cast<double>(chunkLookupsAvoided); }
+};
+
+/// Per-address cache of P2P attribute handles, persisted to a small text file
+/// so reconnects can skip uncached discovery. Thread safe.
+class GattHandleCache {
+public:
+    /// @param path file used for persistence, empty = in-memory only
+    explicit GattHandleCache(std::string path);
+
+    /// @return true and fills out if handles for the address are known
+    bool lookup(uint64_t address, GattHandles& out) const;
+    /// Stores (and persists) freshly discovered handles
+    void store(uint64_t address, const GattHandles& handles);
+    /// Drops the entry, e.g. after a service-changed indication
+    void invalidate(uint64_t address);
+
+    void recordDiscovery(bool cached, double ms);
+    void recordStale();
+    void recordInvalidation();
+    void recordLookupCost(double ms);
+    void recordChunkWrite();
+
+    GattCacheStats stats() const;
+
+private:
+    void load();
+    void save() const;
+
+    std::string _path;
+    mutable std::mutex _mutex;
+    std::unordered_map<uint64_t, GattHandles> _entries;
+    GattCacheStats _stats{};
+};
+
+#endif //GATT_CACHE_H
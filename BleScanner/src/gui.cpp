@@ -13,7 +13,7 @@ void renderControls(GuiState& state,
 
     // — Encryption method selection —
     ImGui::Text("Select encryption method:");
-    if (ImGui::BeginCombo("##reqCombo", AppConstants::REQUEST_LIST[state.selectedRequest].first.c_str())) {
+    if (ImGui::BeginCombo("##reqCombo", AppConstants::REQUEST_LIST[state.selectedRequest].name)) {
         for (int i = 0; i < (int)AppConstants::REQUEST_LIST.size(); ++i) {
             bool selected = (i == state.selectedRequest);
             if (state.selectedRequest == 0) {
@@ -22,9 +22,9 @@ void renderControls(GuiState& state,
             else {
                 state.wordSize = 400;
             }
-            if (ImGui::Selectable(AppConstants::REQUEST_LIST[i].first.c_str(), selected)) {
+            if (ImGui::Selectable(AppConstants::REQUEST_LIST[i].name, selected)) {
                 state.selectedRequest = i;
-                auto method = AppConstants::REQUEST_LIST[i].first;
+                auto method = AppConstants::REQUEST_LIST[i].name;
             }
             if (selected)
                 ImGui::SetItemDefaultFocus();
@@ -45,12 +45,30 @@ void renderControls(GuiState& state,
         }
         ImGui::EndCombo();
     }
+#ifdef _WIN32
+    ImGui::Checkbox("Simulated peripheral", &state.useSimulator);
+#endif
+    ImGui::Checkbox("Multiple devices", &state.multiDevice);
+    if (state.multiDevice) {
+        state.deviceChecked.resize(AppConstants::DEVICE_LIST.size(), 0);
+        for (int i = 0; i < (int)AppConstants::DEVICE_LIST.size(); ++i) {
+            bool checked = state.deviceChecked[i] != 0;
+            ImGui::PushID(i);
+            if (ImGui::Checkbox(AppConstants::DEVICE_LIST[i].first.c_str(), &checked)) {
+                state.deviceChecked[i] = checked ? 1 : 0;
+            }
+            ImGui::PopID();
+        }
+        ImGui::Checkbox("Batch decrypt", &state.batchDecrypt);
+    }
 
     ImGui::Text("Requested [B]");
     ImGui::SameLine();
     ImGui::Text("Word size [B]");
     ImGui::SameLine();
     ImGui::Text("Delay [ms]");
+    ImGui::SameLine();
+    ImGui::Text("In flight");
 
     ImGui::PushItemWidth(100);
     ImGui::InputInt("##reqBytes", &state.requestedBytes);
@@ -60,13 +78,40 @@ void renderControls(GuiState& state,
     ImGui::SameLine();
     ImGui::InputInt("##wordSize", &state.wordSize);
     if (state.wordSize < 1)             state.wordSize = 1;
-    if (state.wordSize > max_data_stm_size)
-        state.wordSize = max_data_stm_size;
+    // one response per notification
+    const int maxWord = static_cast<int>(AppConstants::maxWordSize(AppConstants::REQUEST_LIST[state.selectedRequest].code));
+    if (state.wordSize > maxWord)       state.wordSize = maxWord;
 
     ImGui::SameLine();
+    ImGui::BeginDisabled(state.adaptivePacing);     // the controller picks the spacing
     ImGui::InputDouble("##delayMs", &state.interChunkDelayMs, 0.5f, 1.0f, "%.1f");
     if (state.interChunkDelayMs < 0) state.interChunkDelayMs = 0;
+    ImGui::EndDisabled();
+
+    ImGui::SameLine();
+    ImGui::InputInt("##window", &state.pipelineWindow);
+    if (state.pipelineWindow < 1)  state.pipelineWindow = 1;
+    if (state.pipelineWindow > 64) state.pipelineWindow = 64;
     ImGui::PopItemWidth();
+    ImGui::Checkbox("Adaptive pacing", &state.adaptivePacing);
+    ImGui::SameLine();
+    ImGui::Checkbox("Sequence IDs", &state.sequenceIds);
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Extended request frames, needs firmware that echoes the seq");
+    ImGui::SliderInt("Decrypt workers", &state.decryptWorkers, 0, 8);
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("0 = decrypt on the notification thread");
+    if (!state.multiDevice) {
+        const auto mode = static_cast<DecryptMode>(state.decryptMode);
+        if (ImGui::BeginCombo("Received packets", decryptModeName(mode))) {
+            for (auto m : { DecryptMode::Full, DecryptMode::VerifyOnly, DecryptMode::Lazy }) {
+                bool selected = (m == mode);
+                if (ImGui::Selectable(decryptModeName(m), selected)) state.decryptMode = static_cast<int>(m);
+                if (selected)
+                    ImGui::SetItemDefaultFocus();
+            }
+            ImGui::EndCombo();
+        }
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Verify only / lazy skip the plaintext of long runs (no decrypt workers)");
+    }
 
     if (ImGui::Button("Start BLE", ImVec2(-1, 0))) {
         onStart();
@@ -88,11 +133,58 @@ void renderControls(GuiState& state,
     ImGui::End();
 }
 
-void renderResults(const GuiState& state)
+void renderResults(const GuiState& state,
+                   std::function<void()> onDecryptPending)
 {
     ImGui::Begin("Results", nullptr, ImGuiWindowFlags_NoCollapse);
 
+    if (state.multiDevice) {
+        const auto& agg = state.aggregate;
+        ImGui::Text("Devices: %u, connected %u, done %u, failed %u", agg.devices, agg.connected, agg.done, agg.failed);
+        ImGui::Text("Aggregate: %.2f kB/s (sum of devices %.2f kB/s), %llu packets, %llu decrypt failures",
+                    agg.bytesPerSecond() / 1024.0, agg.sumDeviceBytesPerSecond / 1024.0,
+                    static_cast<unsigned long long>(agg.packets),
+                    static_cast<unsigned long long>(agg.decryptFailures));
+        if (ImGui::BeginTable("Sessions", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY)) {
+            ImGui::TableSetupColumn("Address");
+            ImGui::TableSetupColumn("State");
+            ImGui::TableSetupColumn("Bytes");
+            ImGui::TableSetupColumn("kB/s");
+            ImGui::TableSetupColumn("RTT [ms]");
+            ImGui::TableSetupColumn("MCU [ms]");
+            ImGui::TableHeadersRow();
+            for (auto const& st : state.sessions) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::Text("%012llX", static_cast<unsigned long long>(st.address));
+                ImGui::TableNextColumn(); ImGui::Text("%s", sessionStateName(st.state));
+                ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(st.plaintextBytes));
+                ImGui::TableNextColumn(); ImGui::Text("%.2f", st.bytesPerSecond() / 1024.0);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", st.pipeline.avgRttMs);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", st.mcuCipherMs);
+            }
+            ImGui::EndTable();
+        }
+        ImGui::End();
+        return;
+    }
+
     ImGui::Text("Message:");
+    switch (static_cast<DecryptMode>(state.decryptMode)) {
+      case DecryptMode::VerifyOnly:
+        ImGui::SameLine();
+        ImGui::Text("%llu B authenticated, plaintext not kept", static_cast<unsigned long long>(state.verifiedBytes));
+        break;
+      case DecryptMode::Lazy:
+        ImGui::SameLine();
+        ImGui::BeginDisabled(state.lazyPending == 0);
+        if (ImGui::SmallButton("Decrypt")) onDecryptPending();
+        ImGui::EndDisabled();
+        ImGui::SameLine();
+        ImGui::Text("%zu packets still encrypted", state.lazyPending);
+        break;
+      case DecryptMode::Full:
+        break;
+    }
     ImGui::BeginChild("TransMsgBox", ImVec2(0, 100), true);
     ImGui::TextWrapped("%s", state.lastMessage.c_str());
     ImGui::EndChild();
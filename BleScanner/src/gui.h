@@ -9,10 +9,12 @@
 
 #include <functional>
 #include <string>
+#include <vector>
 #include "ble_manager.h"    // for AppState
 #include "constants.h"      // for REQUEST_LIST, DEVICE_LIST
+#include "crypto.h"         // for DecryptMode
 
-constexpr int max_data_stm_size = 50000;
+constexpr int max_data_stm_size = static_cast<int>(AppConstants::MAX_DATA_STM_SIZE);
 
 /// GUI state – selected indexes, last message, and timing info
 struct GuiState {
@@ -25,7 +27,20 @@ struct GuiState {
     int requestedBytes;
     int wordSize;
     double interChunkDelayMs;
+    int pipelineWindow;
+    bool adaptivePacing;
+    bool sequenceIds;                       ///< extended request frames (firmware echoes the seq)
     int countOfBlocks;
+    bool useSimulator;
+    bool multiDevice;                       ///< one session per checked device
+    bool batchDecrypt;                      ///< sessions decrypt in batches on their own thread
+    int decryptWorkers;                     ///< shared decrypt pool size, 0 = decrypt inline
+    int decryptMode;                        ///< DecryptMode of the single-device path
+    uint64_t verifiedBytes;                 ///< DecryptMode::VerifyOnly: authenticated plaintext bytes
+    size_t lazyPending;                     ///< DecryptMode::Lazy: packets still ciphertext, refreshed every frame
+    std::vector<uint8_t> deviceChecked;     ///< per DEVICE_LIST entry
+    std::vector<SessionStats> sessions;     ///< refreshed every frame in multi-device mode
+    AggregateStats aggregate;
 };
 
 /// Initializes a GuiState structure (optional if using default-initialized members)
@@ -39,7 +54,24 @@ inline void initGuiState(GuiState& s) {
     s.requestedBytes        = 250;
     s.wordSize              = 250;
     s.interChunkDelayMs     = 0;
+    s.pipelineWindow        = 4;
+    s.adaptivePacing        = false;
+    s.sequenceIds           = false;
     s.countOfBlocks         = 0;
+    s.multiDevice           = false;
+    s.batchDecrypt          = false;
+    s.decryptWorkers        = 0;
+    s.decryptMode           = static_cast<int>(DecryptMode::Full);
+    s.verifiedBytes         = 0;
+    s.lazyPending           = 0;
+    s.deviceChecked.assign(AppConstants::DEVICE_LIST.size(), 0);
+    s.sessions.clear();
+    s.aggregate             = AggregateStats{};
+#ifdef _WIN32
+    s.useSimulator          = false;
+#else
+    s.useSimulator          = true;     // WinRT backend is Windows only
+#endif
 }
 
 /// Renders the "Controls" window: device & protocol selection + action buttons
@@ -49,8 +81,11 @@ void renderControls(GuiState& state,
                     std::function<void()> onStart,
                     std::function<void()> onStop);
 
-/// Renders the "Results" window: displays the last message and transfer timing
-void renderResults(const GuiState& state);
+/// Renders the "Results" window: displays the last message and transfer timing,
+/// or the per-device table and aggregate throughput in multi-device mode
+/// - onDecryptPending() will be called when the lazy mode's ciphertext is to be shown
+void renderResults(const GuiState& state,
+                   std::function<void()> onDecryptPending);
 
 /// Renders the status bar at the bottom of the screen based on the current state
 void renderStatusBar(AppState state);
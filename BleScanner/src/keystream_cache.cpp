@@ -0,0 +1,102 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "keystream_cache.h"
+#include "cpu_features.h"
+#include "aead_tag.h"
+
+#include <cstring>
+
+#if BLE_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+#if BLE_X86
+/// Ascending addresses, each chunk loaded before it is stored, so out may start before in
+BLE_TARGET("avx2") void avx2Xor(const uint8_t* in, const uint8_t* ks, uint8_t* out, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        const __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ks + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_xor_si256(v, k));
+    }
+    for (; i < len; ++i) out[i] = in[i] ^ ks[i];
+}
+#endif
+
+/// out = in XOR ks
+void xorKeystream(const uint8_t* in, const uint8_t* ks, uint8_t* out, size_t len) {
+#if BLE_X86
+    if (cpuFeatures().avx2) {
+        avx2Xor(in, ks, out, len);
+        return;
+    }
+#endif
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v, k;
+        std::memcpy(&v, in + i, 8);
+        std::memcpy(&k, ks + i, 8);
+        v ^= k;
+        std::memcpy(out + i, &v, 8);
+    }
+    for (; i < len; ++i) out[i] = in[i] ^ ks[i];
+}
+
+} // namespace
+
+void KeystreamCache::build(const ChaCha20::State& chacha, AesGcm::Key& gcm, const uint8_t nonce[12], size_t bytes) {
+    clear();
+    if (bytes == 0) return;
+
+    ChaCha20::State st = chacha;
+    st.w[12] = 0;
+    std::memset(_polyKey, 0, sizeof(_polyKey));
+    ChaCha20::xorStream(st, _polyKey, _polyKey, sizeof(_polyKey));
+    st.w[12] = 1;
+    _chacha.assign(bytes, 0);
+    ChaCha20::xorStream(st, _chacha.data(), _chacha.data(), bytes);
+
+    if (AesGcm::padsSupported()) {
+        _gcmPads.assign(bytes, 0);
+        AesGcm::makePads(gcm, nonce, _gcmTagMask, _gcmPads.data(), bytes);
+    }
+    _bytes = bytes;
+}
+
+void KeystreamCache::clear() {
+    _bytes = 0;
+    std::vector<uint8_t>().swap(_chacha);
+    std::vector<uint8_t>().swap(_gcmPads);
+    std::memset(_polyKey, 0, sizeof(_polyKey));
+    std::memset(_gcmTagMask, 0, sizeof(_gcmTagMask));
+}
+
+void KeystreamCache::xorChaCha(const uint8_t* in, uint8_t* out, size_t len) const {
+    xorKeystream(in, _chacha.data(), out, len);
+}
+
+bool KeystreamCache::decryptChaChaPoly(const uint8_t tag[16], const uint8_t* ct, size_t len, uint8_t* out) const {
+    // in place the plaintext lands on the tag
+    uint8_t expected[16];
+    std::memcpy(expected, tag, sizeof(expected));
+
+    Poly1305::Mac mac(_polyKey);
+    mac.update(ct, len);
+    uint8_t computed[16];
+    AeadTag::finishPoly1305(mac, len, computed);
+    if (!AeadTag::equal(computed, expected, sizeof(expected))) {
+        if (len > 0) std::memset(out, 0, len);
+        return false;
+    }
+    xorKeystream(ct, _chacha.data(), out, len);
+    return true;
+}
+
+bool KeystreamCache::decryptGcm(AesGcm::Key& key, const uint8_t* ct, size_t len, const uint8_t tag[16],
+                                uint8_t* out) const {
+    return AesGcm::decryptWithPads(key, _gcmTagMask, _gcmPads.data(), ct, len, tag, out);
+}
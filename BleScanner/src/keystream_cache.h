@@ -0,0 +1,49 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef KEYSTREAM_CACHE_H
+#define KEYSTREAM_CACHE_H
+#pragma once
+
+#include "aes_gcm_simd.h"
+#include "chacha20_simd.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Keystream of the fixed KEY / NONCE response protocol. Every FE44 packet starts over at
+/// the same ChaCha20 counter and the same GCM J0, so packet n's keystream is a prefix of
+/// packet m's: computed once per key, a decrypt is a XOR (plus Poly1305 / GHASH for the tag).
+/// Only valid while the nonce stays fixed; CryptoEngine drops it for per-packet nonces.
+class KeystreamCache {
+public:
+    /// Computes bytes of keystream per algorithm: ChaCha20 from block 1 (0x01 and 0x02 share
+    /// it) plus the Poly1305 key of block 0, and the GCM pads when AesGcm::padsSupported()
+    void build(const ChaCha20::State& chacha, AesGcm::Key& gcm, const uint8_t nonce[12], size_t bytes);
+    void clear();
+
+    bool   ready() const { return _bytes > 0; }
+    bool   covers(size_t len) const { return len <= _bytes; }
+    bool   gcmCached() const { return !_gcmPads.empty(); }
+    size_t bytes() const { return _bytes; }
+    /// Heap bytes held
+    size_t footprint() const { return _chacha.capacity() + _gcmPads.capacity(); }
+
+    /// 0x01: out = in XOR keystream (covers(len), out may equal in)
+    void xorChaCha(const uint8_t* in, uint8_t* out, size_t len) const;
+    /// 0x02: Poly1305 with the cached key, then the XOR (out may equal ct or start before it);
+    /// out is zeroed on a tag mismatch
+    bool decryptChaChaPoly(const uint8_t tag[16], const uint8_t* ct, size_t len, uint8_t* out) const;
+    /// 0x03: GHASH, then the XOR with the cached pads (gcmCached()); out is zeroed on a mismatch
+    bool decryptGcm(AesGcm::Key& key, const uint8_t* ct, size_t len, const uint8_t tag[16], uint8_t* out) const;
+
+private:
+    size_t               _bytes = 0;
+    std::vector<uint8_t> _chacha;           ///< ChaCha20 keystream from block 1
+    uint8_t              _polyKey[32]{};    ///< ChaCha20 block 0
+    std::vector<uint8_t> _gcmPads;          ///< E(J0 + 1) …
+    uint8_t              _gcmTagMask[16]{}; ///< E(J0)
+};
+
+#endif //KEYSTREAM_CACHE_H
@@ -0,0 +1,89 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "latency_breakdown.h"
+#include <algorithm>
+#include <fstream>
+
+double LatencyBreakdown::totalUs() const {
+    double sum = 0.0;
+    for (double v : us) sum += v;
+    return sum;
+}
+
+const char* LatencyBreakdown::partName(int part) {
+    switch (part) {
+        case HostSend:    return "host send";
+        case AirOut:      return "air out";
+        case McuQueue:    return "MCU queue";
+        case McuCipher:   return "MCU cipher";
+        case AirBack:     return "air back";
+        case HostProcess: return "host";
+    }
+    return "?";
+}
+
+std::vector<LatencyBreakdown> splitLatency(const std::vector<RequestRecord>& timeline, const ClockSync& sync,
+                                           std::chrono::steady_clock::time_point start) {
+    using clock = std::chrono::steady_clock;
+    std::vector<LatencyBreakdown> out;
+    if (!sync.valid()) return out;
+
+    auto at = [&](double ms) {
+        return start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::milli>(ms));
+    };
+    auto us = [](clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); };
+
+    for (auto const& r : timeline) {
+        if (r.outcome != RequestOutcome::Completed || !r.mcu.stamped || r.writtenMs < 0.0 || r.rxMs < 0.0) continue;
+        const auto written  = at(r.writtenMs);
+        const auto received = at(r.rxMs);
+        const auto mcuRx    = sync.toHost(r.mcu.rxUs, written);
+        const auto mcuDone  = sync.toHost(r.mcu.doneUs, received);
+
+        LatencyBreakdown b;
+        b.id = r.id;
+        b.us[LatencyBreakdown::HostSend]    = (r.writtenMs - r.sentMs) * 1000.0;
+        b.us[LatencyBreakdown::AirOut]      = us(mcuRx - written);
+        b.us[LatencyBreakdown::McuQueue]    = sync.mcuToHostUs(static_cast<int32_t>(r.mcu.startUs - r.mcu.rxUs));
+        b.us[LatencyBreakdown::McuCipher]   = sync.mcuToHostUs(static_cast<int32_t>(r.mcu.doneUs - r.mcu.startUs));
+        b.us[LatencyBreakdown::AirBack]     = us(received - mcuDone);
+        b.us[LatencyBreakdown::HostProcess] = (r.doneMs - r.rxMs) * 1000.0;
+        out.push_back(b);
+    }
+    return out;
+}
+
+LatencySummary summarizeLatency(const std::vector<LatencyBreakdown>& parts, const ClockSync& sync) {
+    LatencySummary sum;
+    sum.clock    = sync.stats();
+    sum.requests = static_cast<uint32_t>(parts.size());
+    if (parts.empty()) return sum;
+
+    std::vector<double> values(parts.size());
+    for (int p = 0; p < LatencyBreakdown::PartCount; ++p) {
+        double total = 0.0;
+        for (size_t i = 0; i < parts.size(); ++i) {
+            values[i] = parts[i].us[p];
+            total += values[i];
+        }
+        std::sort(values.begin(), values.end());
+        sum.meanUs[p] = total / parts.size();
+        sum.p50Us[p]  = values[values.size() / 2];
+        sum.p99Us[p]  = values[static_cast<size_t>(0.99 * (values.size() - 1))];
+    }
+    return sum;
+}
+
+bool writeLatencyCsv(const std::vector<LatencyBreakdown>& parts, const std::string& path) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "id,host_send_us,air_out_us,mcu_queue_us,mcu_cipher_us,air_back_us,host_process_us,total_us\n";
+    for (auto const& b : parts) {
+        out << b.id;
+        for (double v : b.us) out << ',' << v;
+        out << ',' << b.totalUs() << '\n';
+    }
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,51 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef LATENCY_BREAKDOWN_H
+#define LATENCY_BREAKDOWN_H
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "clock_sync.h"
+#include "request_pipeline.h"
+
+/// Where one request's round trip went, µs; the parts add up to the request's RTT
+struct LatencyBreakdown {
+    enum Part { HostSend, AirOut, McuQueue, McuCipher, AirBack, HostProcess, PartCount };
+
+    uint32_t id = 0;
+    std::array<double, PartCount> us{};
+
+    double totalUs() const;
+    static const char* partName(int part);
+};
+
+/// Mean / median / p99 of every part over a transfer
+struct LatencySummary {
+    uint32_t requests = 0;          ///< completed requests with MCU stamps
+    std::array<double, LatencyBreakdown::PartCount> meanUs{};
+    std::array<double, LatencyBreakdown::PartCount> p50Us{};
+    std::array<double, LatencyBreakdown::PartCount> p99Us{};
+    ClockSyncStats clock{};
+};
+
+/// Splits every completed request that carries MCU clock stamps (sequence IDs + clock sync):
+/// host send = write call, air out = written → MCU received (clock mapped), MCU queue and
+/// MCU cipher from the MCU's own stamps, air back = cipher done → notification arrived,
+/// host processing = notification arrived → completion (decrypt + callbacks).
+/// @param start RequestPipeline::startTime() of the transfer
+std::vector<LatencyBreakdown> splitLatency(const std::vector<RequestRecord>& timeline, const ClockSync& sync,
+                                           std::chrono::steady_clock::time_point start);
+
+LatencySummary summarizeLatency(const std::vector<LatencyBreakdown>& parts, const ClockSync& sync);
+
+/// CSV: id,host_send_us,air_out_us,mcu_queue_us,mcu_cipher_us,air_back_us,host_process_us,total_us
+bool writeLatencyCsv(const std::vector<LatencyBreakdown>& parts, const std::string& path);
+
+#endif //LATENCY_BREAKDOWN_H
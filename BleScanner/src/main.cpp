@@ -3,9 +3,15 @@
 #include "constants.h"
 #include "util.h"
 #include "crypto.h"
+#include "ciphertext_log.h"
+#include "decrypt_pool.h"
 #include "ble_manager.h"
 #include "gui.h"
 #include "console.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
 
 // ImGui + GLFW
 #include "imgui.h"
@@ -13,15 +19,19 @@
 #include "imgui_impl_opengl3.h"
 #include <GLFW/glfw3.h>
 
+#ifdef _WIN32
 // WinRT + Windows
 #include <winrt/base.h>
 #include <windows.h>
+#endif
 
 int main()
 {
     // 1) Initialize WinRT and console handler
+#ifdef _WIN32
     init_apartment(winrt::apartment_type::multi_threaded);
     SetConsoleCtrlHandler(ConsoleHandler, TRUE);
+#endif
 
     // 2) Initialize GLFW and create window
     if (!glfwInit()) return -1;
@@ -44,7 +54,16 @@ int main()
     initGuiState(guiState);
 
     CryptoEngine crypto;
+    // request type of the current run, taken from the GUI selection once at onStart
+    uint8_t      requestType = AppConstants::REQUEST_LIST[0].code;
     BleManager   ble;
+    // single device with decrypt workers: the notification thread only submits, the
+    // plaintext comes back in packet order
+    std::unique_ptr<DecryptPool> pool;
+    // DecryptMode::Lazy: packets wait here until the Results window asks for the plaintext
+    CiphertextLog ciphertextLog;
+    DecryptPool::Stream*         poolStream = nullptr;
+    TransportKind transportKind = TransportKind::WinRt;
 
     // 5) Register callbacks from BleManager
     ble.onLog([&](auto const& msg){
@@ -59,27 +78,58 @@ int main()
         guiState.countOfBlocks += countOfBlocks;
     });
 
-    ble.onData([&](const std::vector<uint8_t>& packet, double rtt){
-        console.AddLog("Notification received, RTT = %.2f ms", rtt);
+    // the packet itself is a view into the session's ring, the plaintext goes to the stack
+    ble.onData([&](const PacketView& packet){
+        // sessions decrypt with their own engines, see the Results table
+        if (guiState.multiDevice) return;
+        console.AddLog("Notification received, RTT = %.2f ms", packet.rttMs);
+        if (poolStream) {
+            guiState.lastTransferTimeMs = packet.rttMs;
+            if (!pool->submit(poolStream, packet.seq, packet.data, packet.rttMs)) console.AddLog("Decrypt pool rejected a packet");
+            return;
+        }
+        // long runs: no plaintext, only the tag checked or the ciphertext kept for later
+        switch (static_cast<DecryptMode>(guiState.decryptMode)) {
+          case DecryptMode::Lazy:
+            ciphertextLog.append(packet.data);
+            guiState.lastTransferTimeMs = packet.rttMs;
+            return;
+          case DecryptMode::VerifyOnly: {
+            DecryptResult res = crypto.verify(packet.data);
+            if (!res) {
+                console.AddLog("Verify failed: %s", decryptStatusName(res.status));
+                return;
+            }
+            guiState.verifiedBytes += res.length;
+            guiState.lastTransferTimeMs = packet.rttMs;
+            return;
+          }
+          case DecryptMode::Full:
+            break;
+        }
 
-        crypto.init(AppConstants::REQUEST_LIST[guiState.selectedRequest].second);
-        double ms = 0.0;
-        auto plain = crypto.decrypt(packet, ms);
+        uint8_t plain[PacketRing::SLOT_BYTES];
+        auto t0 = std::chrono::steady_clock::now();
+        DecryptResult res = crypto.decrypt(packet.data, plain);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
 
-        std::string gibberish;
-        gibberish.reserve(packet.size());
-        for (uint8_t b : packet) {
-            if (b >= 0x20 && b < 0x7F)
-                gibberish += static_cast<char>(b);
-            else
-                gibberish += '.';
+        char gibberish[PacketRing::SLOT_BYTES + 1];
+        size_t n = 0;
+        for (uint8_t b : packet.data) {
+            gibberish[n++] = (b >= 0x20 && b < 0x7F) ? static_cast<char>(b) : '.';
         }
-        console.AddLog("Encrypted text: %s", gibberish.c_str());
+        gibberish[n] = '\0';
+        console.AddLog("Encrypted text: %s", gibberish);
 
-        std::string s(plain.begin(), plain.end());
-        console.AddLog("Decrypted text: %s. Duration %.5f ms.", s.c_str(), ms);
-        guiState.lastMessage += s;
-        guiState.lastTransferTimeMs = rtt;
+        if (!res) {
+            console.AddLog("Decrypt failed: %s (%llu tag failures so far)", decryptStatusName(res.status),
+                           static_cast<unsigned long long>(crypto.counters(requestType).tagFailures));
+            return;
+        }
+        console.AddLog("Decrypted text: %.*s. Duration %.5f ms.",
+                       static_cast<int>(res.length), reinterpret_cast<const char*>(plain), ms);
+        guiState.lastMessage.append(reinterpret_cast<const char*>(plain), res.length);
+        guiState.lastTransferTimeMs = packet.rttMs;
     });
 
     while (!glfwWindowShouldClose(window)) {
@@ -94,27 +144,118 @@ int main()
             // onStart:
             [&](){
                 guiState.appState = AppState::Scanning;
+                requestType = AppConstants::REQUEST_LIST[guiState.selectedRequest].code;
+                // contexts stay keyed, this only binds onData's decrypt to the suite
+                crypto.init(requestType);
+                ciphertextLog.reset(requestType);
+                ciphertextLog.reserve(static_cast<size_t>(guiState.requestedBytes) * 2,
+                                      static_cast<size_t>(guiState.requestedBytes) * 2 / std::max(guiState.wordSize, 1) + 1);
+                guiState.verifiedBytes = 0;
+                // the previous run's sessions are stopped, nothing submits to the old stream anymore
+                if (poolStream) pool->closeStream(poolStream);
+                poolStream = nullptr;
+                const auto workers = static_cast<uint32_t>(guiState.decryptWorkers);
+                ble.setDecryptWorkers(workers);
+                if (!guiState.multiDevice && workers > 0 && guiState.decryptMode == static_cast<int>(DecryptMode::Full)) {
+                    if (!pool || pool->workers() != workers) pool = std::make_unique<DecryptPool>(workers);
+                    poolStream = pool->openStream(AppConstants::DEVICE_LIST[guiState.selectedDevice].second,
+                                                  requestType,
+                                                  [&](const DecryptedPacket& p) {
+                        if (!p.result) {
+                            console.AddLog("Decrypt failed: %s", decryptStatusName(p.result.status));
+                            return;
+                        }
+                        console.AddLog("Decrypted text: %.*s. Duration %.5f ms (worker %u).",
+                                       static_cast<int>(p.plain.size()), reinterpret_cast<const char*>(p.plain.data()),
+                                       p.decryptMs, p.worker);
+                        guiState.lastMessage.append(reinterpret_cast<const char*>(p.plain.data()), p.plain.size());
+                    });
+                }
+                // Keep the transport (and its GATT handle cache) unless the backend changes
+                auto kind = guiState.useSimulator ? TransportKind::Simulated : TransportKind::WinRt;
+                if (kind != transportKind) {
+                    ble.setTransport(createTransport(kind));
+                    transportKind = kind;
+                }
+                if (guiState.multiDevice) {
+                    std::vector<uint64_t> addresses;
+                    for (size_t i = 0; i < guiState.deviceChecked.size(); ++i) {
+                        if (guiState.deviceChecked[i]) addresses.push_back(AppConstants::DEVICE_LIST[i].second);
+                    }
+                    if (addresses.empty()) {
+                        console.AddLog("No device checked");
+                        guiState.appState = AppState::Ready;
+                        return;
+                    }
+                    SessionConfig cfg;
+                    cfg.requestType       = requestType;
+                    cfg.bytesToRequest    = static_cast<uint32_t>(guiState.requestedBytes);
+                    cfg.wordSize          = static_cast<uint32_t>(guiState.wordSize);
+                    cfg.interChunkDelayMs = guiState.interChunkDelayMs;
+                    cfg.window            = static_cast<uint32_t>(guiState.pipelineWindow);
+                    cfg.adaptivePacing    = guiState.adaptivePacing;
+                    cfg.sequenceIds       = guiState.sequenceIds;
+                    cfg.decrypt           = true;
+                    cfg.batchDecrypt      = guiState.batchDecrypt;
+                    ble.startSessions(addresses, cfg);
+                    return;
+                }
                 ble.startScan(
                     AppConstants::DEVICE_LIST[guiState.selectedDevice].second,
-                    AppConstants::REQUEST_LIST[guiState.selectedRequest].second,
+                    requestType,
                     static_cast<uint32_t>(guiState.requestedBytes),
                     static_cast<uint32_t>(guiState.wordSize),
-                    guiState.interChunkDelayMs
+                    guiState.interChunkDelayMs,
+                    static_cast<uint32_t>(guiState.pipelineWindow),
+                    guiState.adaptivePacing,
+                    guiState.sequenceIds
                 );
             },
             // onStop:
             [&](){
-                auto bytes = guiState.lastMessage.size();
+                if (guiState.multiDevice) {
+                    console.AddLog("________________________________________________");
+                    for (auto const& st : ble.sessionStats()) {
+                        console.AddLog("%012llX %-12s %llu B plaintext, %.2f kB/s, RTT %.3f ms, %llu decrypt failures (%llu tag)",
+                                       static_cast<unsigned long long>(st.address), sessionStateName(st.state),
+                                       static_cast<unsigned long long>(st.plaintextBytes), st.bytesPerSecond() / 1024.0,
+                                       st.pipeline.avgRttMs, static_cast<unsigned long long>(st.decryptFailures),
+                                       static_cast<unsigned long long>(st.tagFailures));
+                    }
+                    ble.stopScan();     // logs the aggregate line
+                    console.AddLog("________________________________________________");
+                    return;
+                }
+                if (poolStream) pool->drain(poolStream);     // lastMessage complete and in order
+                uint64_t bytes = guiState.lastMessage.size();
+                switch (static_cast<DecryptMode>(guiState.decryptMode)) {
+                  case DecryptMode::VerifyOnly: bytes = guiState.verifiedBytes; break;
+                  case DecryptMode::Lazy:       bytes = ciphertextLog.plainBytes(); break;
+                  case DecryptMode::Full:       break;
+                }
                 auto timeMs = guiState.lastTransferTimeMs + guiState.lastCipherTimeMs;
                 double count = guiState.countOfBlocks;
                 double countExpected = guiState.requestedBytes / guiState.wordSize;
                 double cipherTime = guiState.lastCipherTimeMs;
 
                 console.AddLog("________________________________________________");
-                console.AddLog("Transferred bytes: %d B", guiState.lastMessage.size());
+                console.AddLog("Transferred bytes: %llu B (%s)", static_cast<unsigned long long>(bytes),
+                               decryptModeName(static_cast<DecryptMode>(guiState.decryptMode)));
                 console.AddLog("Transferred time: %.3f ms (%.3f µs, %.3f s)", guiState.lastTransferTimeMs, guiState.lastTransferTimeMs * 1000, guiState.lastTransferTimeMs / 1000);
 
-                if (count < countExpected) {
+                auto latency = ble.latencySummary();
+                if (latency.requests > 0) {
+                    // measured per request with the synced MCU clock, no need to extrapolate
+                    console.AddLog("Clock sync: offset %.1f µs, drift %s, ±%.1f µs (%u/%u samples)",
+                                   latency.clock.offsetUs, describeDrift(latency.clock).c_str(), latency.clock.residualUs,
+                                   latency.clock.used, latency.clock.samples);
+                    for (int p = 0; p < LatencyBreakdown::PartCount; ++p) {
+                        console.AddLog("  %-12s mean %9.1f µs  p50 %9.1f µs  p99 %9.1f µs", LatencyBreakdown::partName(p),
+                                       latency.meanUs[p], latency.p50Us[p], latency.p99Us[p]);
+                    }
+                    console.AddLog("Latency breakdown of %u requests %s", latency.requests,
+                                   ble.writeLatencyBreakdown("latency_breakdown.csv") ? "→ latency_breakdown.csv" : "(not written)");
+                } else if (count < countExpected) {
                     console.AddLog("Expected rounds: %.1f Actual rounds: %.1f", countExpected, count);
                     cipherTime = (cipherTime / count) * countExpected;
                     console.AddLog("Estimated cipher time: %.5f ms (%.5f µs, %.3f s)", cipherTime, cipherTime * 1000, cipherTime / 1000);
@@ -130,17 +271,58 @@ int main()
                     double speedBps = bytes / (timeMs / 1000);
                     console.AddLog("Transfer speed: %.2f B/s (%.2f kB/s, %.2f kb/s)", speedBps, speedBps / 1024.0, speedBps * 8 / 1000);
                 }
+                auto pipe = ble.pipelineStats();
+                if (pipe.requestsSent > 0) {
+                    console.AddLog("In flight: avg %.2f max %u (window %u), stall %.3f ms, pipeline speed %.2f B/s",
+                                   pipe.avgDepth, pipe.maxDepth, pipe.window, pipe.stallMs, pipe.bytesPerSecond());
+                    console.AddLog("Requests: %llu completed, RTT avg %.3f ms, %llu timed out, %llu lost, %llu reordered, timeline %s",
+                                   static_cast<unsigned long long>(pipe.requestsCompleted), pipe.avgRttMs,
+                                   static_cast<unsigned long long>(pipe.requestsTimedOut),
+                                   static_cast<unsigned long long>(pipe.requestsLost),
+                                   static_cast<unsigned long long>(pipe.reordered),
+                                   ble.writeRequestTimeline("request_timeline.csv") ? "request_timeline.csv" : "not written");
+                }
+                auto spacing = ble.pacer().stats();
+                if (spacing.gaps > 0) {
+                    console.AddLog("Send spacing: requested %.1f µs, actual %.1f µs (min %.1f max %.1f), jitter %.1f µs, drift %.1f µs, histogram %s",
+                                   spacing.requestedUs, spacing.meanUs, spacing.minUs, spacing.maxUs,
+                                   spacing.jitterUs, spacing.driftUs,
+                                   ble.pacer().writeCsv("spacing_histogram.csv") ? "spacing_histogram.csv" : "not written");
+                }
+                if (guiState.adaptivePacing && pipe.requestsSent > 0) {
+                    char path[32];
+                    std::snprintf(path, sizeof(path), "pacing_0x%02X.csv",
+                                  requestType);
+                    console.AddLog("Adaptive pacing: converged %.2f B/s, %llu requests timed out, trajectory %s %s",
+                                   ble.pacing().convergedRateBps(),
+                                   static_cast<unsigned long long>(pipe.requestsTimedOut), path,
+                                   ble.pacing().writeCsv(path) ? "written" : "not written");
+                }
                 console.AddLog("________________________________________________");
 
                 ble.stopScan();
                 guiState.lastMessage.clear();
+                guiState.verifiedBytes      = 0;
                 guiState.lastTransferTimeMs = 0.0;
                 guiState.lastCipherTimeMs   = 0.0;
             }
         );
 
         // c) Render Results, Console, and StatusBar
-        renderResults(guiState);
+        if (guiState.multiDevice) {
+            guiState.sessions  = ble.sessionStats();
+            guiState.aggregate = ble.aggregateStats();
+        }
+        guiState.lazyPending = ciphertextLog.pending();
+        renderResults(guiState,
+            // onDecryptPending: the lazy mode's ciphertext, now that it is looked at
+            [&](){
+                auto r = ciphertextLog.decryptPending(crypto, [&](std::span<const uint8_t> plain) {
+                    guiState.lastMessage.append(reinterpret_cast<const char*>(plain.data()), plain.size());
+                });
+                console.AddLog("Decrypted %u packets on demand in %.3f ms, %u failed", r.ok + r.failed, r.ms, r.failed);
+            }
+        );
         console.Draw("BLE Console");
         renderStatusBar(guiState.appState);
 
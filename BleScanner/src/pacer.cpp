@@ -0,0 +1,147 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "pacer.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+namespace {
+    double toUs(std::chrono::steady_clock::duration d) {
+        return std::chrono::duration<double, std::micro>(d).count();
+    }
+
+    std::chrono::steady_clock::duration fromUs(double us) {
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::micro>(us));
+    }
+}
+
+//––– SpacingHistogram –––//
+
+void SpacingHistogram::add(double errorUs) {
+    auto it = std::lower_bound(edgesUs.begin(), edgesUs.end(), errorUs);
+    ++counts[static_cast<size_t>(it - edgesUs.begin())];
+}
+
+uint64_t SpacingHistogram::total() const {
+    uint64_t n = 0;
+    for (auto c : counts) n += c;
+    return n;
+}
+
+//––– Pacer –––//
+
+void Pacer::reset(double intervalMs) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _intervalUs = std::max(0.0, intervalMs * 1000.0);
+    _deadline = _lastSend = clock::time_point{};
+    _stats = PacerStats{};
+    _requestedSumUs = _actualSumUs = _errSqSumUs = 0.0;
+    _onTimeGaps = 0;
+}
+
+void Pacer::setInterval(double intervalMs) {
+    double us = std::max(0.0, intervalMs * 1000.0);
+    // shift the pending deadline so the new spacing applies to this gap already,
+    // keeping whatever the schedule owes from the previous gap
+    if (_deadline != clock::time_point{}) _deadline += fromUs(us - _intervalUs);
+    _intervalUs = us;
+}
+
+bool Pacer::wait(const std::atomic<bool>& running) {
+    if (_deadline == clock::time_point{}) {
+        // first send of the schedule
+        auto now = clock::now();
+        _deadline = now + fromUs(_intervalUs);
+        _lastSend = now;
+        return running;
+    }
+
+    auto now = clock::now();
+    const auto deadline = _deadline;
+    // behind by less than a gap: send now and keep the schedule, the next gap is shorter
+    const bool late = now > deadline + fromUs(_intervalUs);
+
+    // coarse part: OS sleep until `slack` before the deadline, learning how much it oversleeps
+    while (now < deadline && running) {
+        double leftUs = toUs(deadline - now);
+        if (leftUs <= _slackUs) break;
+        double askUs = std::min(leftUs - _slackUs, 10000.0);    // stay responsive to stop
+        auto before = clock::now();
+        std::this_thread::sleep_for(fromUs(askUs));
+        now = clock::now();
+        double overUs = toUs(now - before) - askUs;
+        _slackUs = std::clamp(std::max(overUs * 1.25, _slackUs * 0.99), 50.0, 20000.0);
+    }
+    if (!running) return false;
+
+    // fine part: spin to the deadline
+    auto spinFrom = clock::now();
+    while ((now = clock::now()) < deadline) {
+        std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stats.spinUs += toUs(now - spinFrom);
+    }
+    record(now, late);
+
+    // absolute schedule; a late send re-anchors instead of bursting
+    _deadline = (late ? now : deadline) + fromUs(_intervalUs);
+    _lastSend = now;
+    return running;
+}
+
+void Pacer::record(clock::time_point sentAt, bool late) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    // nominal spacing, so on-time errors telescope to the lateness of the last send
+    const double actualUs    = toUs(sentAt - _lastSend);
+    const double requestedUs = _intervalUs;
+    const double errUs       = actualUs - requestedUs;
+
+    auto& st = _stats;
+    st.minUs = st.gaps ? std::min(st.minUs, actualUs) : actualUs;
+    st.maxUs = st.gaps ? std::max(st.maxUs, actualUs) : actualUs;
+    st.meanUs      = (st.meanUs * st.gaps + actualUs) / (st.gaps + 1);
+    st.requestedUs = (st.requestedUs * st.gaps + requestedUs) / (st.gaps + 1);
+    ++st.gaps;
+    st.histogram.add(errUs);
+
+    if (late) {
+        ++st.lateGaps;
+        return;
+    }
+    ++_onTimeGaps;
+    _requestedSumUs += requestedUs;
+    _actualSumUs    += actualUs;
+    _errSqSumUs     += errUs * errUs;
+    st.driftUs  = _actualSumUs - _requestedSumUs;
+    double mean = st.driftUs / _onTimeGaps;
+    st.jitterUs = std::sqrt(std::max(0.0, _errSqSumUs / _onTimeGaps - mean * mean));
+}
+
+PacerStats Pacer::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+bool Pacer::writeCsv(const std::string& path) const {
+    auto st = stats();
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+    out << "bin_lo_us,bin_hi_us,count\n";
+    const auto& edges = SpacingHistogram::edgesUs;
+    for (size_t i = 0; i < st.histogram.counts.size(); ++i) {
+        if (i == 0) out << "-inf";
+        else        out << edges[i - 1];
+        out << ',';
+        if (i < edges.size()) out << edges[i];
+        else                  out << "inf";
+        out << ',' << st.histogram.counts[i] << '\n';
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef PACER_H
+#define PACER_H
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/// Histogram of send spacing error (actual - requested) in µs
+struct SpacingHistogram {
+    /// Upper bin edges; the last bin collects everything above the last edge
+    static constexpr std::array<double, 16> edgesUs = {
+        -1000, -200, -50, -20, -10, -5, 0, 5, 10, 20, 50, 200, 1000, 5000, 20000, 100000
+    };
+    std::array<uint64_t, edgesUs.size() + 1> counts{};
+
+    void add(double errorUs);
+    uint64_t total() const;
+};
+
+/// Spacing statistics of one paced transfer
+struct PacerStats {
+    uint64_t gaps        = 0;     ///< measured send-to-send gaps
+    uint64_t lateGaps    = 0;     ///< gaps more than one interval late (sender blocked elsewhere), restart the schedule
+    double   requestedUs = 0.0;   ///< mean requested spacing
+    double   meanUs      = 0.0;   ///< mean actual spacing
+    double   minUs       = 0.0;
+    double   maxUs       = 0.0;
+    double   jitterUs    = 0.0;   ///< standard deviation of (actual - requested) over on-time gaps
+    double   driftUs     = 0.0;   ///< accumulated actual - requested over on-time gaps (schedule drift)
+    double   spinUs      = 0.0;   ///< total time spent spinning before deadlines
+    SpacingHistogram histogram{};
+};
+
+/// Paces FE43 requests against absolute deadlines: sleeps coarsely until shortly before
+/// the deadline, then spins. The next deadline is the previous one plus the interval, so
+/// per-send errors don't add up. A send more than one gap late (the window was full) starts
+/// a new schedule instead of bursting to catch up. wait() and setInterval() are called from
+/// the sending thread only, intervalMs() and stats() may be read from any thread.
+class Pacer {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// Starts a new schedule, the first wait() returns immediately
+    void reset(double intervalMs);
+
+    /// Spacing for the following sends (adaptive pacing changes it on the fly)
+    void setInterval(double intervalMs);
+    double intervalMs() const { return _intervalUs / 1000.0; }
+
+    /// Blocks until the next send deadline
+    /// @return false if running went false meanwhile
+    bool wait(const std::atomic<bool>& running);
+
+    PacerStats stats() const;
+
+    /// Writes the spacing histogram as CSV (bin_lo_us,bin_hi_us,count)
+    bool writeCsv(const std::string& path) const;
+
+private:
+    void record(clock::time_point sentAt, bool late);
+
+    std::atomic<double> _intervalUs{ 0.0 };      ///< written by the sending thread, intervalMs() reads it from any
+    double            _slackUs    = 200.0;   ///< learned oversleep of the OS sleep, spin this long
+    clock::time_point _deadline{};
+    clock::time_point _lastSend{};
+    mutable std::mutex _mutex;
+    PacerStats        _stats{};
+    double            _requestedSumUs = 0.0;
+    double            _actualSumUs    = 0.0;
+    double            _errSqSumUs     = 0.0;
+    uint64_t          _onTimeGaps     = 0;
+};
+
+#endif //PACER_H
@@ -0,0 +1,66 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "packet_ring.h"
+#include <cstring>
+
+PacketRing::PacketRing(uint32_t slots) {
+    uint32_t n = 1;
+    while (n < slots) n <<= 1;
+    _slots.resize(n);
+    _mask = n - 1;
+}
+
+PacketView PacketRing::push(std::span<const uint8_t> payload, std::chrono::steady_clock::time_point rxTime, double rttMs) {
+    PacketView view;
+    view.rxTime = rxTime;
+    view.rttMs  = rttMs;
+    const uint64_t seq = _next.load(std::memory_order_relaxed);
+    if (payload.size() > SLOT_BYTES) {
+        _oversized.fetch_add(1, std::memory_order_relaxed);
+        view.seq = seq;
+        return view;
+    }
+    Slot& slot  = _slots[seq & _mask];
+    slot.seq    = seq;
+    slot.rxTime = rxTime;
+    slot.rttMs  = rttMs;
+    slot.length = static_cast<uint32_t>(payload.size());
+    if (!payload.empty()) std::memcpy(slot.bytes.data(), payload.data(), payload.size());
+
+    view.seq  = seq;
+    _next.store(seq + 1, std::memory_order_release);
+    view.data = std::span<const uint8_t>(slot.bytes.data(), slot.length);
+    return view;
+}
+
+bool PacketRing::at(uint64_t seq, PacketView& out) const {
+    if (seq >= _next.load(std::memory_order_acquire)) return false;
+    const Slot& slot = _slots[seq & _mask];
+    if (slot.seq != seq) return false;
+    out.seq    = slot.seq;
+    out.rxTime = slot.rxTime;
+    out.rttMs  = slot.rttMs;
+    out.data   = std::span<const uint8_t>(slot.bytes.data(), slot.length);
+    return true;
+}
+
+void PacketRing::clear() {
+    for (auto& slot : _slots) {
+        slot.seq    = ~0ull;
+        slot.length = 0;
+    }
+    _next = 0;
+    _oversized = 0;
+}
+
+PacketRingStats PacketRing::stats() const {
+    PacketRingStats st;
+    st.slots     = static_cast<uint32_t>(_slots.size());
+    st.slotBytes = SLOT_BYTES;
+    st.pushed    = _next.load(std::memory_order_relaxed);
+    st.oversized = _oversized.load(std::memory_order_relaxed);
+    st.wraps     = st.pushed / _slots.size();
+    return st;
+}
@@ -0,0 +1,77 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/// One received notification as seen by the downstream stages; `data` points into the
+/// ring slot and stays valid until the ring wraps around to that slot again
+struct PacketView {
+    uint64_t seq   = 0;                              ///< 0, 1, 2, … per session
+    std::chrono::steady_clock::time_point rxTime{};  ///< taken when the notification arrived
+    double   rttMs = 0.0;                            ///< since its request was sent (-1 = no matching request)
+    std::span<const uint8_t> data{};
+};
+
+/// Counters of a PacketRing
+struct PacketRingStats {
+    uint32_t slots     = 0;
+    uint32_t slotBytes = 0;
+    uint64_t pushed    = 0;     ///< notifications copied in
+    uint64_t oversized = 0;     ///< notifications longer than a slot, dropped
+    uint64_t wraps     = 0;     ///< times the writer came back to slot 0
+};
+
+/// Preallocated ring of fixed-size packet slots. Each notification payload is copied
+/// exactly once, into the next slot, together with its receive time and sequence index;
+/// everything after that works on spans into the slot. Single writer (the link's
+/// notification thread); readers of older packets must not lag more than `slots` behind.
+class PacketRing {
+public:
+    /// Max ATT attribute value, the longest notification a link can deliver
+    static constexpr uint32_t SLOT_BYTES = 512;
+
+    explicit PacketRing(uint32_t slots = 128);
+
+    /// Copies the payload into the next slot
+    /// @return view of the slot, empty data if the payload didn't fit (counted as oversized)
+    PacketView push(std::span<const uint8_t> payload, std::chrono::steady_clock::time_point rxTime, double rttMs);
+
+    /// Packet with the given sequence index, if it has not been overwritten yet
+    bool at(uint64_t seq, PacketView& out) const;
+
+    /// Sequence index the next packet will get (= packets pushed so far)
+    uint64_t head() const { return _next.load(std::memory_order_acquire); }
+
+    uint32_t slots() const { return static_cast<uint32_t>(_slots.size()); }
+
+    /// Forgets all packets, sequence indices restart at 0 (no reallocation)
+    void clear();
+
+    PacketRingStats stats() const;
+
+private:
+    struct Slot {
+        uint64_t seq = 0;
+        std::chrono::steady_clock::time_point rxTime{};
+        double   rttMs = 0.0;
+        uint32_t length = 0;
+        alignas(64) std::array<uint8_t, SLOT_BYTES> bytes{};
+    };
+
+    std::vector<Slot> _slots;
+    uint32_t _mask = 0;
+    std::atomic<uint64_t> _next{ 0 };          ///< written by the notification thread only
+    std::atomic<uint64_t> _oversized{ 0 };
+};
+
+#endif //PACKET_RING_H
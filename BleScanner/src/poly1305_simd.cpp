@@ -0,0 +1,434 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "poly1305_simd.h"
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include <mbedtls/poly1305.h>
+
+#if BLE_X86
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER) && !defined(__SIZEOF_INT128__)
+#include <intrin.h>
+#endif
+
+namespace Poly1305 {
+
+namespace {
+
+/// AVX2 pays for its lane setup and final combine from 64 blocks (1 kB) on
+constexpr size_t kAvx2MinBlocks = 64;
+constexpr uint64_t kMask26 = 0x3ffffff;
+
+std::atomic<int> g_forced{ -1 };
+
+inline uint64_t le64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+inline void store64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+//––– 128-bit arithmetic: unsigned __int128 where the compiler has it, _umul128 on MSVC –––//
+
+struct U128 {
+    uint64_t lo, hi;
+};
+
+inline U128 mul(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 p = static_cast<unsigned __int128>(a) * b;
+    return { static_cast<uint64_t>(p), static_cast<uint64_t>(p >> 64) };
+#elif defined(_M_X64)
+    U128 r;
+    r.lo = _umul128(a, b, &r.hi);
+    return r;
+#else
+    return { a * b, __umulh(a, b) };
+#endif
+}
+
+inline U128 add(U128 a, U128 b) {
+    const uint64_t lo = a.lo + b.lo;
+    return { lo, a.hi + b.hi + (lo < a.lo) };
+}
+
+inline U128 add(U128 a, uint64_t b) {
+    const uint64_t lo = a.lo + b;
+    return { lo, a.hi + (lo < b) };
+}
+
+//––– Scalar: radix 2^64, h = h2·2^128 + h1·2^64 + h0 –––//
+
+void scalarBlocks(uint64_t h[3], const uint64_t r[2], const uint8_t* p, size_t count, uint64_t hibit) {
+    const uint64_t r0 = r[0], r1 = r[1];
+    const uint64_t s1 = r1 + (r1 >> 2);     // 5·r1 / 4, exact since clamping cleared r1's low 2 bits
+    uint64_t h0 = h[0], h1 = h[1], h2 = h[2];
+    for (; count > 0; --count, p += 16) {
+        // h += m (plus the 2^128 pad bit)
+        const U128 a0 = add(U128{ h0, 0 }, le64(p));
+        const U128 a1 = add(add(U128{ h1, 0 }, a0.hi), le64(p + 8));
+        h0 = a0.lo;
+        h1 = a1.lo;
+        h2 += a1.hi + hibit;
+
+        // h *= r; the 2^130 wrap folds in as ·5/4 on the r1 terms
+        const U128 d0 = add(mul(h0, r0), mul(h1, s1));
+        U128 d1 = add(add(mul(h0, r1), mul(h1, r0)), h2 * s1);
+        h2 *= r0;
+        h0 = d0.lo;
+        d1 = add(d1, d0.hi);
+        h1 = d1.lo;
+        h2 += d1.hi;
+
+        // partial reduction: h = (h mod 2^130) + 5·(h >> 130)
+        uint64_t c = (h2 >> 2) + (h2 & ~uint64_t(3));
+        h2 &= 3;
+        h0 += c;
+        c = h0 < c;
+        h1 += c;
+        c = h1 < c;
+        h2 += c;
+    }
+    h[0] = h0; h[1] = h1; h[2] = h2;
+}
+
+//––– Radix 2^26 (five limbs), the AVX2 kernel's representation –––//
+
+void toLimbs(const uint64_t h[3], uint64_t l[5]) {
+    l[0] = h[0] & kMask26;
+    l[1] = (h[0] >> 26) & kMask26;
+    l[2] = ((h[0] >> 52) | (h[1] << 12)) & kMask26;
+    l[3] = (h[1] >> 14) & kMask26;
+    l[4] = (h[1] >> 40) | (h[2] << 24);
+}
+
+/// Carries until l0 … l3 < 2^26 (l4 may keep a bit above, like the scalar h2)
+void carryLimbs(uint64_t l[5]) {
+    uint64_t c;
+    for (int i = 0; i < 4; ++i) { c = l[i] >> 26; l[i] &= kMask26; l[i + 1] += c; }
+    c = l[4] >> 26; l[4] &= kMask26; l[0] += c * 5;
+    for (int i = 0; i < 4; ++i) { c = l[i] >> 26; l[i] &= kMask26; l[i + 1] += c; }
+}
+
+void fromLimbs(uint64_t l[5], uint64_t h[3]) {
+    carryLimbs(l);
+    h[0] = l[0] | (l[1] << 26) | (l[2] << 52);
+    h[1] = (l[2] >> 12) | (l[3] << 14) | (l[4] << 40);
+    h[2] = l[4] >> 24;
+}
+
+/// a·b mod 2^130 - 5 (partially reduced), for the powers of r
+void mulLimbs(const uint64_t a[5], const uint64_t b[5], uint64_t out[5]) {
+    const uint64_t s1 = b[1] * 5, s2 = b[2] * 5, s3 = b[3] * 5, s4 = b[4] * 5;
+    uint64_t d[5];
+    d[0] = a[0] * b[0] + a[1] * s4   + a[2] * s3   + a[3] * s2   + a[4] * s1;
+    d[1] = a[0] * b[1] + a[1] * b[0] + a[2] * s4   + a[3] * s3   + a[4] * s2;
+    d[2] = a[0] * b[2] + a[1] * b[1] + a[2] * b[0] + a[3] * s4   + a[4] * s3;
+    d[3] = a[0] * b[3] + a[1] * b[2] + a[2] * b[1] + a[3] * b[0] + a[4] * s4;
+    d[4] = a[0] * b[4] + a[1] * b[3] + a[2] * b[2] + a[3] * b[1] + a[4] * b[0];
+    carryLimbs(d);
+    std::copy(d, d + 5, out);
+}
+
+#if BLE_X86
+
+//––– AVX2: lane j accumulates blocks j, j+4, j+8 … (lanes = lanes·r^4 + next 4 blocks), and
+//    finish multiplies lane j by r^(4-j) so the lane sum is the sequential result. The lanes
+//    live in the Mac between updates, so a message fed in tiles is combined only once –––//
+
+/// a·b + c·d + … over the low 32 bits of each 64-bit lane
+BLE_TARGET("avx2") inline __m256i dot5(__m256i a0, __m256i b0, __m256i a1, __m256i b1, __m256i a2, __m256i b2,
+                                       __m256i a3, __m256i b3, __m256i a4, __m256i b4) {
+    __m256i d = _mm256_mul_epu32(a0, b0);
+    d = _mm256_add_epi64(d, _mm256_mul_epu32(a1, b1));
+    d = _mm256_add_epi64(d, _mm256_mul_epu32(a2, b2));
+    d = _mm256_add_epi64(d, _mm256_mul_epu32(a3, b3));
+    return _mm256_add_epi64(d, _mm256_mul_epu32(a4, b4));
+}
+
+/// d = h·r in every lane, s = 5·r
+BLE_TARGET("avx2") inline void mulLanes(const __m256i h[5], const __m256i r[5], const __m256i s[5], __m256i d[5]) {
+    d[0] = dot5(h[0], r[0], h[1], s[4], h[2], s[3], h[3], s[2], h[4], s[1]);
+    d[1] = dot5(h[0], r[1], h[1], r[0], h[2], s[4], h[3], s[3], h[4], s[2]);
+    d[2] = dot5(h[0], r[2], h[1], r[1], h[2], r[0], h[3], s[4], h[4], s[3]);
+    d[3] = dot5(h[0], r[3], h[1], r[2], h[2], r[1], h[3], r[0], h[4], s[4]);
+    d[4] = dot5(h[0], r[4], h[1], r[3], h[2], r[2], h[3], r[1], h[4], r[0]);
+}
+
+/// groups × 64 bytes (4 full blocks each) into the lanes; `started` = false takes the
+/// first group without the multiply (the lanes then hold only the carried-in h)
+BLE_TARGET("avx2") void avx2Groups(uint64_t lanes[5][4], const uint32_t pow[4][5], const uint8_t* p,
+                                   size_t groups, bool started) {
+    const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(kMask26));
+    const __m256i pad  = _mm256_set1_epi64x(1ll << 24);
+    __m256i r4[5], s4[5], acc[5], d[5];
+    for (int i = 0; i < 5; ++i) {
+        r4[i]  = _mm256_set1_epi64x(pow[3][i]);
+        s4[i]  = _mm256_set1_epi64x(5ll * pow[3][i]);
+        acc[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes[i]));
+    }
+
+    for (; groups > 0; --groups, p += 64) {
+        if (started) {
+            mulLanes(acc, r4, s4, d);
+            // carry every limb back under 2^26 (+ a little) for the next multiply
+            __m256i c;
+            for (int i = 0; i < 4; ++i) {
+                c = _mm256_srli_epi64(d[i], 26);
+                d[i] = _mm256_and_si256(d[i], mask);
+                d[i + 1] = _mm256_add_epi64(d[i + 1], c);
+            }
+            c = _mm256_srli_epi64(d[4], 26);
+            d[4] = _mm256_and_si256(d[4], mask);
+            d[0] = _mm256_add_epi64(d[0], _mm256_add_epi64(c, _mm256_slli_epi64(c, 2)));
+            c = _mm256_srli_epi64(d[0], 26);
+            d[0] = _mm256_and_si256(d[0], mask);
+            d[1] = _mm256_add_epi64(d[1], c);
+            for (int i = 0; i < 5; ++i) acc[i] = d[i];
+        }
+        started = true;
+
+        // blocks 0 … 3 into lanes 0 … 3 as 64-bit halves, then 26-bit limbs
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        const __m256i lo = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+        const __m256i hi = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8);
+        acc[0] = _mm256_add_epi64(acc[0], _mm256_and_si256(lo, mask));
+        acc[1] = _mm256_add_epi64(acc[1], _mm256_and_si256(_mm256_srli_epi64(lo, 26), mask));
+        acc[2] = _mm256_add_epi64(acc[2], _mm256_and_si256(
+                     _mm256_or_si256(_mm256_srli_epi64(lo, 52), _mm256_slli_epi64(hi, 12)), mask));
+        acc[3] = _mm256_add_epi64(acc[3], _mm256_and_si256(_mm256_srli_epi64(hi, 14), mask));
+        acc[4] = _mm256_add_epi64(acc[4], _mm256_or_si256(_mm256_srli_epi64(hi, 40), pad));
+    }
+    for (int i = 0; i < 5; ++i) _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes[i]), acc[i]);
+}
+
+/// h = Σ lane j · r^(4-j)
+BLE_TARGET("avx2") void avx2Combine(const uint64_t lanes[5][4], const uint32_t pow[4][5], uint64_t h[3]) {
+    __m256i rl[5], sl[5], acc[5], d[5];
+    for (int i = 0; i < 5; ++i) {
+        rl[i]  = _mm256_setr_epi64x(pow[3][i], pow[2][i], pow[1][i], pow[0][i]);
+        sl[i]  = _mm256_setr_epi64x(5ll * pow[3][i], 5ll * pow[2][i], 5ll * pow[1][i], 5ll * pow[0][i]);
+        acc[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes[i]));
+    }
+    mulLanes(acc, rl, sl, d);
+
+    // lane sum, each limb < 2^62
+    uint64_t l[5];
+    for (int i = 0; i < 5; ++i) {
+        alignas(32) uint64_t t[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(t), d[i]);
+        l[i] = t[0] + t[1] + t[2] + t[3];
+    }
+    fromLimbs(l, h);
+}
+
+#endif // BLE_X86
+
+} // namespace
+
+const char* kernelName(Kernel kernel) {
+    switch (kernel) {
+      case Kernel::Scalar: return "scalar";
+      case Kernel::Avx2:   return "AVX2";
+    }
+    return "?";
+}
+
+bool kernelSupported(Kernel kernel) {
+    switch (kernel) {
+      case Kernel::Scalar: return true;
+      case Kernel::Avx2:   return BLE_X86 && cpuFeatures().avx2;
+    }
+    return false;
+}
+
+Kernel bestKernel() {
+    static const Kernel best = kernelSupported(Kernel::Avx2) ? Kernel::Avx2 : Kernel::Scalar;
+    return best;
+}
+
+Kernel activeKernel() {
+    const int forced = g_forced.load(std::memory_order_relaxed);
+    return forced < 0 ? bestKernel() : static_cast<Kernel>(forced);
+}
+
+void forceKernel(Kernel kernel) {
+    g_forced.store(static_cast<int>(kernelSupported(kernel) ? kernel : Kernel::Scalar), std::memory_order_relaxed);
+}
+
+void resetKernel() {
+    g_forced.store(-1, std::memory_order_relaxed);
+}
+
+Mac::Mac(const uint8_t key[32]) : Mac(activeKernel(), key) {}
+
+Mac::Mac(Kernel kernel, const uint8_t key[32]) : _kernel(kernelSupported(kernel) ? kernel : Kernel::Scalar) {
+    _r[0] = le64(key)      & 0x0ffffffc0fffffffull;
+    _r[1] = le64(key + 8)  & 0x0ffffffc0ffffffcull;
+    _s[0] = le64(key + 16);
+    _s[1] = le64(key + 24);
+}
+
+size_t Mac::blocks(const uint8_t* data, size_t count) {
+#if BLE_X86
+    if (_kernel == Kernel::Avx2 && (_lanesActive || count >= kAvx2MinBlocks)) {
+        if (!_lanesActive) {
+            // r^1 … r^4 only once a message is long enough to need them
+            const uint64_t r[3] = { _r[0], _r[1], 0 };
+            uint64_t p[4][5];
+            toLimbs(r, p[0]);
+            for (int k = 1; k < 4; ++k) mulLimbs(p[k - 1], p[0], p[k]);
+            for (int k = 0; k < 4; ++k)
+                for (int i = 0; i < 5; ++i) _pow[k][i] = static_cast<uint32_t>(p[k][i]);
+            // h so far goes into lane 0 and is added to the first block there
+            uint64_t l[5];
+            toLimbs(_h, l);
+            for (int i = 0; i < 5; ++i) {
+                _lanes[i][0] = l[i];
+                _lanes[i][1] = _lanes[i][2] = _lanes[i][3] = 0;
+            }
+        }
+        const size_t groups = count / 4;
+        if (groups > 0) {
+            avx2Groups(_lanes, _pow, data, groups, _lanesActive);
+            _lanesActive = true;
+        }
+        return groups * 4;
+    }
+#endif
+    scalarBlocks(_h, _r, data, count, 1);
+    return count;
+}
+
+void Mac::update(const uint8_t* data, size_t len) {
+    // with the lanes on, bytes are buffered up to a whole group of 4 blocks
+    if (_buffered > 0) {
+        const size_t unit = _lanesActive ? 64 : 16;
+        const size_t n = std::min(len, unit - _buffered);
+        std::memcpy(_buf + _buffered, data, n);
+        _buffered += n;
+        data += n;
+        len  -= n;
+        if (_buffered < unit) return;
+        blocks(_buf, unit / 16);
+        _buffered = 0;
+    }
+    if (len >= 16) {
+        const size_t n = blocks(data, len / 16);
+        data += n * 16;
+        len  -= n * 16;
+    }
+    if (len > 0) {
+        std::memcpy(_buf, data, len);
+        _buffered = len;
+    }
+}
+
+void Mac::padToBlock() {
+    const size_t partial = _buffered % 16;
+    if (partial == 0) return;
+    std::memset(_buf + _buffered, 0, 16 - partial);
+    _buffered += 16 - partial;
+    if (!_lanesActive || _buffered == 64) {
+        blocks(_buf, _buffered / 16);
+        _buffered = 0;
+    }
+}
+
+void Mac::finish(uint8_t tag[16]) {
+#if BLE_X86
+    if (_lanesActive) {
+        avx2Combine(_lanes, _pow, _h);
+        _lanesActive = false;
+    }
+#endif
+    // whole blocks left in the buffer, then a short last block that carries its pad bit
+    // as a 0x01 byte instead of 2^128
+    const size_t whole = _buffered / 16, partial = _buffered % 16;
+    scalarBlocks(_h, _r, _buf, whole, 1);
+    if (partial > 0) {
+        uint8_t last[16] = {};
+        std::memcpy(last, _buf + whole * 16, partial);
+        last[partial] = 1;
+        scalarBlocks(_h, _r, last, 1, 0);
+    }
+    _buffered = 0;
+    uint64_t h0 = _h[0], h1 = _h[1];
+
+    // h - p = h + 5 - 2^130: take it when that doesn't go negative (no branch on h)
+    uint64_t g0 = h0 + 5;
+    uint64_t c  = g0 < 5;
+    uint64_t g1 = h1 + c;
+    c = g1 < c;
+    const uint64_t g2 = _h[2] + c;
+    const uint64_t mask = 0 - (g2 >> 2);
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+
+    // tag = (h + s) mod 2^128
+    h0 += _s[0];
+    c = h0 < _s[0];
+    h1 += _s[1] + c;
+    store64(tag, h0);
+    store64(tag + 8, h1);
+}
+
+void mac(const uint8_t key[32], const uint8_t* msg, size_t len, uint8_t tag[16]) {
+    Mac m(key);
+    m.update(msg, len);
+    m.finish(tag);
+}
+
+bool selfTest() {
+    if (mbedtls_poly1305_self_test(0) != 0) return false;
+
+    // the last key has the largest r clamping allows, against an all-0xff message
+    uint8_t keys[3][32];
+    uint32_t seed = 0x12345678;
+    for (int k = 0; k < 2; ++k)
+        for (auto& b : keys[k]) b = static_cast<uint8_t>((seed = seed * 1664525 + 1013904223) >> 24);
+    std::fill(std::begin(keys[2]), std::end(keys[2]), 0xff);
+
+    std::vector<uint8_t> msg(4096 + 64);
+    // the 1100 and 2048 pieces switch the AVX2 lanes on, the small ones then run through them
+    const size_t splits[] = { 1, 15, 1100, 16, 17, 63, 64, 2048, 100, 200 };
+    for (int k = 0; k < 3; ++k) {
+        for (size_t i = 0; i < msg.size(); ++i)
+            msg[i] = k == 2 ? 0xff : static_cast<uint8_t>((seed = seed * 1664525 + 1013904223) >> 24);
+        for (Kernel kernel : { Kernel::Scalar, Kernel::Avx2 }) {
+            if (!kernelSupported(kernel)) continue;
+            for (size_t len = 0; len <= msg.size(); len += (len < 300 ? 1 : 37)) {
+                uint8_t ref[16], got[16];
+                mbedtls_poly1305_mac(keys[k], msg.data(), len, ref);
+
+                Mac whole(kernel, keys[k]);
+                whole.update(msg.data(), len);
+                whole.finish(got);
+                if (std::memcmp(ref, got, 16) != 0) return false;
+
+                Mac pieces(kernel, keys[k]);
+                for (size_t off = 0, s = 0; off < len; ++s) {
+                    const size_t n = std::min(splits[s % std::size(splits)], len - off);
+                    pieces.update(msg.data() + off, n);
+                    off += n;
+                }
+                pieces.finish(got);
+                if (std::memcmp(ref, got, 16) != 0) return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace Poly1305
@@ -0,0 +1,70 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef POLY1305_SIMD_H
+#define POLY1305_SIMD_H
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Poly1305 (RFC 8439) one-time authenticator in the project's crypto layer: a scalar kernel
+/// on 64-bit limbs (64×64→128 multiplies) and an AVX2 kernel that runs 4 blocks per step
+/// in 4 lanes with the precomputed powers r^1 … r^4, picked at runtime from cpuFeatures().
+/// Tags are identical to mbedtls_poly1305_mac(); the vendored mbedTLS stays untouched.
+namespace Poly1305 {
+
+enum class Kernel : uint8_t { Scalar, Avx2 };
+
+const char* kernelName(Kernel kernel);
+bool kernelSupported(Kernel kernel);
+
+/// Best kernel of this CPU
+Kernel bestKernel();
+
+/// Kernel new Macs use: bestKernel() unless forced
+Kernel activeKernel();
+
+/// Forces a kernel (benchmarks, cross-checks); an unsupported one means Scalar
+void forceKernel(Kernel kernel);
+void resetKernel();
+
+/// Incremental MAC over one message; the kernel is fixed at construction. Updates of any
+/// size give the same tag, tiles of a long message keep the AVX2 lanes running
+class Mac {
+public:
+    explicit Mac(const uint8_t key[32]);
+    Mac(Kernel kernel, const uint8_t key[32]);
+
+    void update(const uint8_t* data, size_t len);
+    /// Zero bytes up to the next 16-byte boundary (AEAD padding)
+    void padToBlock();
+    void finish(uint8_t tag[16]);
+
+private:
+    /// Full blocks; with the AVX2 lanes on only whole groups of 4 are taken
+    /// @return blocks consumed
+    size_t blocks(const uint8_t* data, size_t count);
+
+    Kernel   _kernel;
+    uint64_t _r[2], _s[2];          ///< clamped r and the final addend s
+    uint64_t _h[3]{};               ///< accumulator, radix 2^64, partially reduced
+    uint32_t _pow[4][5]{};          ///< r^1 … r^4, radix 2^26 (AVX2)
+    uint64_t _lanes[5][4]{};        ///< AVX2 accumulators, [limb][lane]
+    bool     _lanesActive = false;
+    uint8_t  _buf[64]{};
+    size_t   _buffered = 0;
+};
+
+/// One-shot tag of msg
+void mac(const uint8_t key[32], const uint8_t* msg, size_t len, uint8_t tag[16]);
+
+/// mbedtls_poly1305_self_test() (the RFC 8439 vectors) for the reference, then every
+/// supported kernel against it for 0 … 4 kB, in one piece and split into uneven updates
+/// @return false on the first mismatch
+bool selfTest();
+
+} // namespace Poly1305
+
+#endif //POLY1305_SIMD_H
@@ -0,0 +1,370 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "request_pipeline.h"
+#include <algorithm>
+#include <fstream>
+
+namespace {
+    double toMs(std::chrono::steady_clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    const char* outcomeName(RequestOutcome o) {
+        switch (o) {
+            case RequestOutcome::Outstanding: return "outstanding";
+            case RequestOutcome::Completed:   return "completed";
+            case RequestOutcome::TimedOut:    return "timeout";
+            case RequestOutcome::Lost:        return "lost";
+            case RequestOutcome::Dropped:     return "dropped";
+        }
+        return "?";
+    }
+}
+
+void RequestPipeline::reset(uint32_t window, double timeoutMs, size_t expectedRequests) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _outstanding.clear();
+    _overtaken.clear();
+    _late.clear();
+    _window  = (window < 1) ? 1 : window;
+    _timeout = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::milli>(timeoutMs));
+    _lateWindow = _timeout;
+    _aborted = false;
+    _stats   = PipelineStats{};
+    _stats.window = _window;
+    _firstSend = _lastComplete = _depthSince = clock::time_point{};
+    _depthIntegralMs = 0.0;
+    _rttSumMs = 0.0;
+    _nextId = 0;
+    _timeline.clear();
+    _timeline.reserve(expectedRequests);
+}
+
+void RequestPipeline::setListener(CompleteCallback onComplete, TimeoutCallback onTimeout) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _completeCb = std::move(onComplete);
+    _timeoutCb  = std::move(onTimeout);
+}
+
+void RequestPipeline::setTimeout(double timeoutMs) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _timeout = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::milli>(timeoutMs));
+}
+
+void RequestPipeline::accountDepthLocked(clock::time_point now) {
+    if (_depthSince != clock::time_point{}) {
+        _depthIntegralMs += toMs(now - _depthSince) * static_cast<double>(_outstanding.size());
+    }
+    _depthSince = now;
+}
+
+double RequestPipeline::sinceFirstMs(clock::time_point t) const {
+    return toMs(t - _firstSend);
+}
+
+void RequestPipeline::completeLocked(Requests::iterator it, clock::time_point now) {
+    accountDepthLocked(now);
+    const bool windowLimited = _outstanding.size() >= _window;
+    if (it != _outstanding.begin()) {
+        _timeline[it->id].reordered = true;
+        ++_stats.reordered;
+        for (auto older = _outstanding.begin(); older != it; ++older) ++older->overtaken;
+    }
+    const Outstanding req = *it;
+    _outstanding.erase(it);
+    creditLocked(req, now, true, windowLimited);
+
+    // in-order link: a request overtaken several times was probably dropped by the peripheral,
+    // it frees its slot now but counts as lost only if its data doesn't come by the timeout
+    while (!_outstanding.empty() && _outstanding.front().overtaken >= kLossThreshold) {
+        _overtaken.push_back(_outstanding.front());
+        _outstanding.pop_front();
+    }
+}
+
+void RequestPipeline::creditLocked(const Outstanding& req, clock::time_point now, bool ack, bool windowLimited) {
+    const double rttMs = toMs(now - req.sentAt);
+    RequestRecord& rec = _timeline[req.id];
+    rec.doneMs  = sinceFirstMs(now);
+    rec.outcome = RequestOutcome::Completed;
+    _stats.bytesCompleted += req.requestBytes;
+    _rttSumMs += rttMs;
+    ++_stats.requestsCompleted;
+    _lastComplete = now;
+    if (ack && _completeCb) _completeCb(rttMs, windowLimited);
+}
+
+void RequestPipeline::giveUpLocked(Outstanding req, clock::time_point now, RequestOutcome outcome) {
+    RequestRecord& rec = _timeline[req.id];
+    rec.doneMs  = sinceFirstMs(now);
+    rec.outcome = outcome;
+    _stats.bytesTimedOut += req.requestBytes;
+    switch (outcome) {
+        case RequestOutcome::Lost:    ++_stats.requestsLost; break;
+        case RequestOutcome::Dropped: ++_stats.requestsDropped; break;
+        default:                      ++_stats.requestsTimedOut; break;
+    }
+    // a dropped response did come back: nothing late to wait for, and the link is not congested
+    if (outcome == RequestOutcome::Dropped) return;
+    req.givenUpAt = now;
+    _late.push_back(req);
+    if (_timeoutCb) _timeoutCb();
+}
+
+bool RequestPipeline::addLocked(Requests& list, Requests::iterator it, size_t bytes, clock::time_point rxTime) {
+    RequestRecord& rec = _timeline[it->id];
+    if (rec.firstByteMs < 0.0) rec.firstByteMs = sinceFirstMs(rxTime);
+    rec.rxMs = sinceFirstMs(rxTime);
+    it->received += static_cast<uint32_t>(bytes);
+    if (it->received < it->expected) return false;
+    list.erase(it);
+    return true;
+}
+
+void RequestPipeline::expireLocked(clock::time_point now) {
+    while (!_outstanding.empty() && now - _outstanding.front().sentAt > _timeout) {
+        accountDepthLocked(now);
+        const Outstanding req = _outstanding.front();
+        _outstanding.pop_front();
+        giveUpLocked(req, now, RequestOutcome::TimedOut);
+    }
+    while (!_overtaken.empty() && now - _overtaken.front().sentAt > _timeout) {
+        const Outstanding req = _overtaken.front();
+        _overtaken.pop_front();
+        giveUpLocked(req, now, RequestOutcome::Lost);
+    }
+    while (!_late.empty() && now - _late.front().givenUpAt > _lateWindow) _late.pop_front();
+}
+
+bool RequestPipeline::resolveLocked(uint32_t seq, uint32_t& id) const {
+    if (_nextId == 0) return false;
+    const uint32_t last = _nextId - 1;
+    const uint32_t back = static_cast<uint16_t>(static_cast<uint16_t>(last) - static_cast<uint16_t>(seq));
+    if (back > last) return false;
+    id = last - back;
+    return true;
+}
+
+std::deque<RequestPipeline::Outstanding>::iterator RequestPipeline::findLocked(uint32_t seq) {
+    if (seq == kNoSeq) return _outstanding.begin();
+    uint32_t id;
+    if (!resolveLocked(seq, id)) return _outstanding.end();
+    return findId(_outstanding, id);
+}
+
+RequestPipeline::Requests::iterator RequestPipeline::findId(Requests& list, uint32_t id) {
+    return std::find_if(list.begin(), list.end(), [id](const Outstanding& r) { return r.id == id; });
+}
+
+bool RequestPipeline::acquire(const std::atomic<bool>& running) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_outstanding.size() < _window) return running && !_aborted;
+
+    auto t0 = clock::now();
+    while (running && !_aborted) {
+        auto now = clock::now();
+        expireLocked(now);
+        if (_outstanding.size() < _window) break;
+        // short waits so a stop request or an expired slot is noticed
+        _cv.wait_for(lock, std::chrono::milliseconds(10));
+    }
+    _stats.stallMs += toMs(clock::now() - t0);
+    return running && !_aborted;
+}
+
+uint32_t RequestPipeline::onSent(uint32_t requestBytes, uint32_t responseBytes) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto now = clock::now();
+    if (_firstSend == clock::time_point{}) _firstSend = now;
+    expireLocked(now);
+    accountDepthLocked(now);
+    const uint32_t id = _nextId++;
+    _outstanding.push_back(Outstanding{ id, now, requestBytes, responseBytes, 0, 0 });
+    RequestRecord rec;
+    rec.id           = id;
+    rec.requestBytes = requestBytes;
+    rec.sentMs       = sinceFirstMs(now);
+    _timeline.push_back(rec);
+    ++_stats.requestsSent;
+    if (_outstanding.size() > _stats.maxDepth) {
+        _stats.maxDepth = static_cast<uint32_t>(_outstanding.size());
+    }
+    return id;
+}
+
+void RequestPipeline::onWritten(uint32_t id) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (id < _timeline.size()) _timeline[id].writtenMs = sinceFirstMs(clock::now());
+}
+
+double RequestPipeline::elapsedSinceSent(uint32_t seq) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const clock::time_point now = clock::now();
+    if (seq == kNoSeq) {
+        return _outstanding.empty() ? -1.0 : toMs(now - _outstanding.front().sentAt);
+    }
+    uint32_t id;
+    if (!resolveLocked(seq, id)) return -1.0;
+    // also answers for requests already given up, so late data still gets its real RTT
+    return toMs(now - _firstSend) - _timeline[id].sentMs;
+}
+
+void RequestPipeline::onResponse(size_t bytes, uint32_t seq, clock::time_point rxTime) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto now = clock::now();
+        if (rxTime == clock::time_point{}) rxTime = now;
+        if (seq != kNoSeq) {
+            // all bytes belong to one request
+            auto it = findLocked(seq);
+            uint32_t id = 0;
+            const bool known = it == _outstanding.end() && resolveLocked(seq, id);
+            Requests::iterator other;
+            if (known && (other = findId(_overtaken, id)) != _overtaken.end()) {
+                // overtaken but not lost after all: a reordered completion
+                const Outstanding req = *other;
+                if (addLocked(_overtaken, other, bytes, rxTime)) creditLocked(req, now, true, false);
+            } else if (known && (other = findId(_late, id)) != _late.end()) {
+                // given up too early: the request completes after all, no second ack for pacing
+                ++_stats.lateResponses;
+                const Outstanding req = *other;
+                if (addLocked(_late, other, bytes, rxTime)) {
+                    if (_timeline[id].outcome == RequestOutcome::Lost) --_stats.requestsLost;
+                    else                                               --_stats.requestsTimedOut;
+                    _stats.bytesTimedOut -= req.requestBytes;
+                    ++_stats.requestsRecovered;
+                    creditLocked(req, now, false, false);
+                }
+            } else if (it == _outstanding.end()) {
+                if (known && (_timeline[id].outcome == RequestOutcome::TimedOut ||
+                              _timeline[id].outcome == RequestOutcome::Lost)) {
+                    ++_stats.lateResponses;
+                } else {
+                    ++_stats.strayResponses;
+                }
+            } else {
+                RequestRecord& rec = _timeline[it->id];
+                if (rec.firstByteMs < 0.0) rec.firstByteMs = sinceFirstMs(rxTime);
+                rec.rxMs = sinceFirstMs(rxTime);
+                it->received += static_cast<uint32_t>(bytes);
+                if (it->received >= it->expected) completeLocked(it, now);
+            }
+        }
+        while (seq == kNoSeq && bytes > 0 && !_outstanding.empty()) {
+            auto& front = _outstanding.front();
+            RequestRecord& rec = _timeline[front.id];
+            if (rec.firstByteMs < 0.0) rec.firstByteMs = sinceFirstMs(rxTime);
+            rec.rxMs = sinceFirstMs(rxTime);
+            uint32_t missing = front.expected - front.received;
+            uint32_t take = (bytes < missing) ? static_cast<uint32_t>(bytes) : missing;
+            front.received += take;
+            bytes -= take;
+            if (front.received >= front.expected) completeLocked(_outstanding.begin(), now);
+        }
+    }
+    _cv.notify_all();
+}
+
+void RequestPipeline::onDropped(uint32_t seq, clock::time_point rxTime) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto now = clock::now();
+        if (rxTime == clock::time_point{}) rxTime = now;
+        auto it = findLocked(seq);
+        uint32_t id = 0;
+        Requests::iterator other;
+        if (it != _outstanding.end()) {
+            accountDepthLocked(now);
+            const Outstanding req = *it;
+            _outstanding.erase(it);
+            _timeline[req.id].rxMs = sinceFirstMs(rxTime);
+            giveUpLocked(req, now, RequestOutcome::Dropped);
+        } else if (seq != kNoSeq && resolveLocked(seq, id) && (other = findId(_overtaken, id)) != _overtaken.end()) {
+            const Outstanding req = *other;
+            _overtaken.erase(other);
+            _timeline[req.id].rxMs = sinceFirstMs(rxTime);
+            giveUpLocked(req, now, RequestOutcome::Dropped);
+        } else {
+            ++_stats.strayResponses;
+        }
+    }
+    _cv.notify_all();
+}
+
+void RequestPipeline::onMcuTiming(uint32_t seq, const McuTiming& timing) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t id;
+    if (!resolveLocked(seq, id)) return;
+    _timeline[id].mcuUs = timing.cipherUs;
+    _timeline[id].mcu   = timing;
+}
+
+RequestPipeline::clock::time_point RequestPipeline::startTime() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _firstSend;
+}
+
+bool RequestPipeline::drain(const std::atomic<bool>& running) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (running && !_aborted) {
+        expireLocked(clock::now());
+        if (_outstanding.empty() && _overtaken.empty()) return true;
+        _cv.wait_for(lock, std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+bool RequestPipeline::settle(const std::atomic<bool>& running) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (running && !_aborted) {
+        expireLocked(clock::now());
+        if (_outstanding.empty() && _overtaken.empty() && _late.empty()) return true;
+        _cv.wait_for(lock, std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+void RequestPipeline::abort() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _aborted = true;
+    }
+    _cv.notify_all();
+}
+
+uint32_t RequestPipeline::inFlight() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return static_cast<uint32_t>(_outstanding.size());
+}
+
+PipelineStats RequestPipeline::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    PipelineStats st = _stats;
+    if (_firstSend != clock::time_point{} && _lastComplete > _firstSend) {
+        st.elapsedMs = toMs(_lastComplete - _firstSend);
+        double spanMs = toMs(_depthSince - _firstSend);
+        if (spanMs > 0.0) st.avgDepth = _depthIntegralMs / spanMs;
+    }
+    if (st.requestsCompleted > 0) st.avgRttMs = _rttSumMs / st.requestsCompleted;
+    return st;
+}
+
+std::vector<RequestRecord> RequestPipeline::timeline() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _timeline;
+}
+
+bool RequestPipeline::writeTimelineCsv(const std::string& path) const {
+    auto records = timeline();
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "id,bytes,sent_ms,written_ms,first_byte_ms,rx_ms,done_ms,rtt_ms,mcu_us,outcome,reordered\n";
+    for (auto const& r : records) {
+        out << r.id << ',' << r.requestBytes << ',' << r.sentMs << ',' << r.writtenMs << ',' << r.firstByteMs << ','
+            << r.rxMs << ',' << r.doneMs << ',' << r.rttMs() << ',' << r.mcuUs << ',' << outcomeName(r.outcome) << ','
+            << (r.reordered ? 1 : 0) << '\n';
+    }
+    return static_cast<bool>(out);
+}
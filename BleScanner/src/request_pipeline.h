@@ -0,0 +1,210 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef REQUEST_PIPELINE_H
+#define REQUEST_PIPELINE_H
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Statistics of one windowed transfer
+struct PipelineStats {
+    uint32_t window            = 0;     ///< configured max requests in flight
+    uint64_t requestsSent      = 0;
+    uint64_t requestsCompleted = 0;
+    uint64_t requestsTimedOut  = 0;     ///< released without their FE44 data
+    uint64_t requestsLost      = 0;     ///< overtaken by kLossThreshold newer responses, then timed out (sequence IDs only)
+    uint64_t requestsDropped   = 0;     ///< response arrived but could not be kept (see onDropped())
+    uint64_t reordered         = 0;     ///< completed while an older request was still outstanding
+    uint64_t lateResponses     = 0;     ///< responses for requests already timed out / lost
+    uint64_t requestsRecovered = 0;     ///< timed out / lost, then completed by late responses (counted as completed)
+    uint64_t strayResponses    = 0;     ///< duplicates and sequence numbers never sent
+    uint32_t maxDepth          = 0;     ///< max requests in flight
+    double   avgDepth          = 0.0;   ///< time-weighted average requests in flight
+    double   stallMs           = 0.0;   ///< time the sender waited for a free slot
+    double   elapsedMs         = 0.0;   ///< first send → last completion
+    uint64_t bytesCompleted    = 0;     ///< requested (plaintext) bytes of completed requests
+    uint64_t bytesTimedOut     = 0;     ///< requested bytes of timed out, lost and dropped requests
+    double   avgRttMs          = 0.0;   ///< request sent → last response byte
+
+    double bytesPerSecond() const {
+        return (elapsedMs > 0.0) ? bytesCompleted / (elapsedMs / 1000.0) : 0.0;
+    }
+};
+
+/// What happened to a request
+enum class RequestOutcome : uint8_t { Outstanding, Completed, TimedOut, Lost, Dropped };
+
+/// FE45 report of an extended request: cipher time and raw MCU clock stamps
+struct McuTiming {
+    double   cipherUs = 0.0;
+    bool     stamped  = false;      ///< the stamps below were sent (extended timing frame)
+    uint32_t rxUs     = 0;          ///< request received
+    uint32_t startUs  = 0;          ///< cipher started (left the MCU queue)
+    uint32_t doneUs   = 0;          ///< cipher done, response handed to the radio
+};
+
+/// One request of a transfer; times are ms since the transfer's first send
+struct RequestRecord {
+    uint32_t id           = 0;
+    uint32_t requestBytes = 0;
+    double   sentMs       = 0.0;     ///< registered, right before the write
+    double   writtenMs    = -1.0;    ///< write call returned
+    double   firstByteMs  = -1.0;    ///< first FE44 bytes credited to it (-1 = none)
+    double   rxMs         = -1.0;    ///< notification completing it arrived
+    double   doneMs       = -1.0;    ///< completed (host processing included) / given up
+    double   mcuUs        = -1.0;    ///< FE45 cipher time reported for it (sequence IDs only)
+    McuTiming mcu{};
+    RequestOutcome outcome = RequestOutcome::Outstanding;
+    bool     reordered    = false;
+
+    double rttMs() const { return (outcome == RequestOutcome::Completed) ? doneMs - sentMs : -1.0; }
+};
+
+/// Keeps up to `window` FE43 requests in flight and records every request's timeline.
+/// Requests get consecutive IDs; with sequence IDs on the wire (low 16 bits echoed in
+/// the responses) data is credited to its own request, so RTT is exact even out of order,
+/// and a request overtaken by kLossThreshold newer completions gives its window slot up
+/// early; it only counts as lost if its data hasn't come by the timeout. Without them data
+/// is credited to the oldest outstanding request (responses come back in order). Requests
+/// without complete data after the timeout are released as well. Their data is still
+/// credited if it comes within the late window, reset()'s timeout (see settle()).
+/// Thread safe: the sender calls acquire()/onSent(), the notification thread calls onResponse().
+class RequestPipeline {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// onResponse()/elapsedSinceSent() without a sequence number: oldest outstanding request
+    static constexpr uint32_t kNoSeq = 0xFFFFFFFFu;
+    /// Newer completions after which an outstanding request leaves the window (lost if it times out)
+    static constexpr uint32_t kLossThreshold = 3;
+
+    /// (rtt_ms, windowLimited) - windowLimited: the window was full when the request completed
+    using CompleteCallback = std::function<void(double, bool)>;
+    using TimeoutCallback  = std::function<void()>;
+
+    /// Starts a new transfer
+    /// @param window    max requests in flight (min 1)
+    /// @param timeoutMs a request without complete response after this long is dropped
+    /// @param expectedRequests timeline capacity reserved up front (no growth on the hot path)
+    void reset(uint32_t window, double timeoutMs, size_t expectedRequests = 0);
+
+    /// Completion/timeout hooks for pacing, invoked with the pipeline lock held
+    /// (must not call back into the pipeline)
+    void setListener(CompleteCallback onComplete, TimeoutCallback onTimeout);
+
+    /// Changes the request timeout of the running transfer (the late window stays the reset() timeout)
+    void setTimeout(double timeoutMs);
+
+    /// Blocks until a slot is free
+    /// @return false if running went false or abort() was called
+    bool acquire(const std::atomic<bool>& running);
+
+    /// Registers a request that is about to be written
+    /// @param requestBytes  payload bytes requested
+    /// @param responseBytes bytes expected on FE44 (payload + tag)
+    /// @return request ID (0, 1, 2, … per transfer), its low 16 bits are the wire sequence number
+    uint32_t onSent(uint32_t requestBytes, uint32_t responseBytes);
+
+    /// The write of request `id` returned
+    void onWritten(uint32_t id);
+
+    /// Time since the request that response bytes belong to was sent, -1 if there is none
+    /// @param seq wire sequence number of the response, kNoSeq = oldest outstanding request
+    double elapsedSinceSent(uint32_t seq = kNoSeq) const;
+
+    /// Credits notification bytes to the request with the given wire sequence number,
+    /// or to the oldest outstanding request (kNoSeq)
+    /// @param rxTime when the notification arrived (default: now)
+    void onResponse(size_t bytes, uint32_t seq = kNoSeq, clock::time_point rxTime = {});
+
+    /// A response arrived but the receiver couldn't keep it (e.g. longer than a packet slot):
+    /// its request (by wire sequence number, or the oldest outstanding one) is given up as
+    /// Dropped, its bytes are not credited and the pacing listener is not told of a loss
+    void onDropped(uint32_t seq = kNoSeq, clock::time_point rxTime = {});
+
+    /// Attaches an FE45 report to the request with the given wire sequence number
+    void onMcuTiming(uint32_t seq, const McuTiming& timing);
+
+    /// Host time of the transfer's first send (timeline times are relative to it)
+    clock::time_point startTime() const;
+
+    /// Waits until nothing is in flight (overtaken requests included)
+    /// @return false on abort/stop
+    bool drain(const std::atomic<bool>& running);
+
+    /// After drain(): waits until the late responses of timed out / lost requests have come
+    /// (and are credited) or their late window has passed, so stats() shows what is missing
+    /// @return false on abort/stop
+    bool settle(const std::atomic<bool>& running);
+
+    /// Wakes up a blocked acquire()/drain()
+    void abort();
+
+    uint32_t inFlight() const;
+    PipelineStats stats() const;
+
+    /// Every request of the current/last transfer in send order
+    std::vector<RequestRecord> timeline() const;
+
+    /// Writes the timeline as CSV (id,bytes,sent_ms,written_ms,first_byte_ms,rx_ms,done_ms,rtt_ms,mcu_us,outcome,reordered)
+    bool writeTimelineCsv(const std::string& path) const;
+
+private:
+    struct Outstanding {
+        uint32_t id;
+        clock::time_point sentAt;
+        uint32_t requestBytes;
+        uint32_t expected;
+        uint32_t received;
+        uint32_t overtaken;         ///< newer requests completed before this one
+        clock::time_point givenUpAt{};
+    };
+    using Requests = std::deque<Outstanding>;
+
+    void accountDepthLocked(clock::time_point now);
+    void expireLocked(clock::time_point now);
+    void completeLocked(Requests::iterator it, clock::time_point now);
+    /// Books a request whose data is complete; ack = tell the pacing listener
+    void creditLocked(const Outstanding& req, clock::time_point now, bool ack, bool windowLimited);
+    /// Books a request as not answered (erased from its list by the caller)
+    void giveUpLocked(Outstanding req, clock::time_point now, RequestOutcome outcome);
+    /// Adds response bytes to a request of _overtaken / _late, true when that completed it
+    bool addLocked(Requests& list, Requests::iterator it, size_t bytes, clock::time_point rxTime);
+    /// Full request ID of a wire sequence number (the latest ID sent with these low bits)
+    bool resolveLocked(uint32_t seq, uint32_t& id) const;
+    std::deque<Outstanding>::iterator findLocked(uint32_t seq);
+    static Requests::iterator findId(Requests& list, uint32_t id);
+    double sinceFirstMs(clock::time_point t) const;
+
+    mutable std::mutex      _mutex;
+    std::condition_variable _cv;
+    std::deque<Outstanding> _outstanding;
+    Requests                _overtaken;     ///< out of the window, not yet timed out (sequence IDs only)
+    Requests                _late;          ///< given up, data still credited until givenUpAt + _lateWindow
+    uint32_t                _window    = 1;
+    clock::duration         _timeout{};
+    clock::duration         _lateWindow{};  ///< reset()'s timeout, kept when setTimeout() tightens _timeout
+    bool                    _aborted   = false;
+    PipelineStats           _stats{};
+    CompleteCallback        _completeCb{};
+    TimeoutCallback         _timeoutCb{};
+    clock::time_point       _firstSend{};
+    clock::time_point       _lastComplete{};
+    clock::time_point       _depthSince{};
+    double                  _depthIntegralMs = 0.0;
+    double                  _rttSumMs        = 0.0;
+    uint32_t                _nextId          = 0;
+    std::vector<RequestRecord> _timeline;
+};
+
+#endif //REQUEST_PIPELINE_H
@@ -0,0 +1,340 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "sim_peripheral.h"
+#include "constants.h"         // KEY, NONCE
+#include "chacha20_simd.h"     // ChaCha12/8 and HChaCha20, mbedTLS has neither
+#include "crc32c.h"
+#include <mbedtls/ccm.h>
+#include <mbedtls/chacha20.h>
+#include <mbedtls/chachapoly.h>
+#include <mbedtls/gcm.h>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    constexpr char kPattern[] = "Lorem ipsum dolor sit amet, consectetur adipiscing elit. ";
+    constexpr size_t kPatternLen = sizeof(kPattern) - 1;
+    constexpr size_t kTagLen = 16;
+
+    /// MCU time for one response of requestType. Cost relative to ChaCha20 (SimConfig's
+    /// cipherFixedUs / cipherNsPerByte), rough ratios of the firmware's software ciphers on
+    /// the Cortex-M4: ChaCha cost follows the rounds, Poly1305 adds ~35 % per byte and a key
+    /// block, XChaCha one more HChaCha20 block, AES-256 ~2.2× and AES-128 ~1.6× ChaCha20 per
+    /// byte, GHASH ~1.3×, CCM two AES passes (CTR and CBC-MAC)
+    double mcuCipherUs(const SimConfig& cfg, uint8_t requestType, size_t length) {
+        const double blockUs = 64 * cfg.cipherNsPerByte / 1000.0;    // one ChaCha20 block
+        double fixedUs = cfg.cipherFixedUs, perByte = 1.0;
+        switch (requestType) {
+          case 0x00: return cfg.crcNsPerByte * length / 1000.0;        // CRC unit, no setup
+          case 0x01: break;
+          case 0x04: perByte = 0.1 + 0.9 * 12.0 / 20.0; break;
+          case 0x05: perByte = 0.1 + 0.9 * 8.0 / 20.0;  break;
+          case 0x02: perByte = 1.35; fixedUs += blockUs;       break;
+          case 0x06: perByte = 1.35; fixedUs += 2 * blockUs;   break;
+          case 0x03: perByte = 2.2 + 1.3; fixedUs += 4 * blockUs; break;   // key schedule, H and its tables
+          case 0x07: perByte = 1.6 + 1.3; fixedUs += 3 * blockUs; break;
+          case 0x08: perByte = 2 * 2.2;   fixedUs += 2 * blockUs; break;   // B0 and the tag block
+          default: break;
+        }
+        return fixedUs + perByte * cfg.cipherNsPerByte * length / 1000.0;
+    }
+}
+
+SimPeripheral::SimPeripheral(uint64_t address, std::string name, SimConfig cfg)
+    : _address(address), _name(std::move(name)), _cfg(cfg), _powerUp(clock::now()) {
+    _thread = std::thread([this]() { run(); });
+}
+
+SimPeripheral::~SimPeripheral() {
+    stop();
+}
+
+void SimPeripheral::setDataCallback(NotifyCallback cb) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _dataCb = std::move(cb);
+}
+
+void SimPeripheral::setTimingCallback(NotifyCallback cb) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _timingCb = std::move(cb);
+}
+
+void SimPeripheral::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_stop) return;
+        _stop = true;
+        _dataCb = nullptr;
+        _timingCb = nullptr;
+    }
+    _cv.notify_all();
+    if (_thread.joinable()) _thread.join();
+}
+
+void SimPeripheral::fillPlaintext(std::span<uint8_t> buf, uint64_t offset) {
+    for (size_t i = 0; i < buf.size(); ++i) {
+        buf[i] = static_cast<uint8_t>(kPattern[(offset + i) % kPatternLen]);
+    }
+}
+
+bool SimPeripheral::isPlaintext(std::span<const uint8_t> buf) {
+    for (size_t phase = 0; phase < kPatternLen; ++phase) {
+        size_t i = 0;
+        while (i < buf.size() && buf[i] == static_cast<uint8_t>(kPattern[(phase + i) % kPatternLen])) ++i;
+        if (i == buf.size()) return true;
+    }
+    return false;
+}
+
+std::vector<uint8_t> SimPeripheral::encryptResponse(uint8_t requestType, std::span<const uint8_t> plain) {
+    std::vector<uint8_t> out;
+    switch (requestType) {
+      case 0x00: {
+        // plaintext baseline, CRC32C little-endian after it
+        const uint32_t crc = Crc32c::compute(plain.data(), plain.size());
+        out.assign(plain.begin(), plain.end());
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(crc >> (8 * i)));
+        break;
+      }
+
+      case 0x01: {
+        // ChaCha20, counter starts at 1 like the firmware
+        out.resize(plain.size());
+        mbedtls_chacha20_crypt(AppConstants::KEY.data(), AppConstants::NONCE.data(),
+                               1, plain.size(), plain.data(), out.data());
+        break;
+      }
+
+      case 0x02: {
+        // ChaCha20-Poly1305, tag first
+        out.resize(kTagLen + plain.size());
+        mbedtls_chachapoly_context ctx;
+        mbedtls_chachapoly_init(&ctx);
+        mbedtls_chachapoly_setkey(&ctx, AppConstants::KEY.data());
+        mbedtls_chachapoly_encrypt_and_tag(&ctx, plain.size(), AppConstants::NONCE.data(),
+                                           nullptr, 0, plain.data(),
+                                           out.data() + kTagLen, out.data());
+        mbedtls_chachapoly_free(&ctx);
+        break;
+      }
+
+      case 0x03:
+      case 0x07: {
+        // AES-256-GCM / AES-128-GCM (first half of the key), tag last
+        const unsigned keyBits = requestType == 0x07 ? 128 : 256;
+        out.resize(plain.size() + kTagLen);
+        mbedtls_gcm_context ctx;
+        mbedtls_gcm_init(&ctx);
+        mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, AppConstants::KEY.data(), keyBits);
+        mbedtls_gcm_crypt_and_tag(&ctx, MBEDTLS_GCM_ENCRYPT, plain.size(),
+                                  AppConstants::NONCE.data(), AppConstants::NONCE.size(),
+                                  nullptr, 0, plain.data(), out.data(),
+                                  kTagLen, out.data() + plain.size());
+        mbedtls_gcm_free(&ctx);
+        break;
+      }
+
+      case 0x04:
+      case 0x05: {
+        // ChaCha12 / ChaCha8, otherwise like 0x01; the portable kernel stands in for the firmware
+        out.resize(plain.size());
+        const auto st = ChaCha20::makeState(AppConstants::KEY.data(), AppConstants::NONCE.data(), 1,
+                                            requestType == 0x04 ? 12 : 8);
+        ChaCha20::xorStream(ChaCha20::Kernel::Scalar, st, plain.data(), out.data(), plain.size());
+        break;
+      }
+
+      case 0x06: {
+        // XChaCha20-Poly1305: 0x02 under the HChaCha20 subkey with nonce 0 || XNONCE[16..24], tag first
+        uint8_t subkey[32];
+        uint8_t nonce[12] = {};
+        ChaCha20::hchacha20(AppConstants::KEY.data(), AppConstants::XNONCE.data(), subkey);
+        std::memcpy(nonce + 4, AppConstants::XNONCE.data() + 16, 8);
+        out.resize(kTagLen + plain.size());
+        mbedtls_chachapoly_context ctx;
+        mbedtls_chachapoly_init(&ctx);
+        mbedtls_chachapoly_setkey(&ctx, subkey);
+        mbedtls_chachapoly_encrypt_and_tag(&ctx, plain.size(), nonce, nullptr, 0, plain.data(),
+                                           out.data() + kTagLen, out.data());
+        mbedtls_chachapoly_free(&ctx);
+        break;
+      }
+
+      case 0x08: {
+        // AES-256-CCM, tag last
+        out.resize(plain.size() + kTagLen);
+        mbedtls_ccm_context ctx;
+        mbedtls_ccm_init(&ctx);
+        mbedtls_ccm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, AppConstants::KEY.data(),
+                           (unsigned)AppConstants::KEY.size() * 8);
+        mbedtls_ccm_encrypt_and_tag(&ctx, plain.size(), AppConstants::NONCE.data(), AppConstants::NONCE.size(),
+                                    nullptr, 0, plain.data(), out.data(), out.data() + plain.size(), kTagLen);
+        mbedtls_ccm_free(&ctx);
+        break;
+      }
+
+      default:
+        break;
+    }
+    return out;
+}
+
+GattHandles SimPeripheral::handles() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    // FE40 service declaration followed by FE41..FE45, each with a value handle (+ CCCD for notify)
+    return GattHandles{
+        _handleBase,
+        static_cast<uint16_t>(_handleBase + 7),     // FE43
+        static_cast<uint16_t>(_handleBase + 9),     // FE44
+        static_cast<uint16_t>(_handleBase + 12),    // FE45
+    };
+}
+
+void SimPeripheral::setServiceChangedCallback(std::function<void()> cb) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _serviceChangedCb = std::move(cb);
+}
+
+uint32_t SimPeripheral::mcuClock(clock::time_point t) const {
+    const double us = std::chrono::duration<double, std::micro>(t - _powerUp).count();
+    return static_cast<uint32_t>(static_cast<uint64_t>(_cfg.mcuClockOffsetUs + us * (1.0 + _cfg.mcuClockDriftPpm * 1e-6)));
+}
+
+bool SimPeripheral::onWrite(uint16_t handle, std::span<const uint8_t> frame) {
+    if (handle != handles().dataIn) return false;
+    if (frame.size() < 3) return true;
+    const auto written = clock::now();
+    const auto latency = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double, std::micro>(_cfg.linkLatencyUs));
+
+    // clock sync is answered by the BLE event handler right away, it doesn't queue behind requests
+    if (frame[0] == (AppConstants::SYNC_REQUEST | AppConstants::SEQ_FLAG) && frame.size() >= 5) {
+        const auto received = written + latency;
+        const auto replied  = received + std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double, std::micro>(_cfg.syncTurnaroundUs));
+        const uint32_t t2 = mcuClock(received), t3 = mcuClock(replied);
+        std::vector<uint8_t> reply = {
+            frame[0], frame[3], frame[4],
+            static_cast<uint8_t>(t2), static_cast<uint8_t>(t2 >> 8), static_cast<uint8_t>(t2 >> 16), static_cast<uint8_t>(t2 >> 24),
+            static_cast<uint8_t>(t3), static_cast<uint8_t>(t3 >> 8), static_cast<uint8_t>(t3 >> 16), static_cast<uint8_t>(t3 >> 24)
+        };
+        schedule(replied + latency, Channel::Timing, std::move(reply));
+        return true;
+    }
+
+    std::function<void()> serviceChanged;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_requests;
+        if (_cfg.serviceChangedEvery && _requests % _cfg.serviceChangedEvery == 0) {
+            // firmware update style change: the whole table moves
+            _handleBase = static_cast<uint16_t>(_handleBase + 0x10);
+            serviceChanged = _serviceChangedCb;
+        }
+    }
+
+    const bool tagged    = (frame[0] & AppConstants::SEQ_FLAG) != 0;
+    uint8_t  requestType = static_cast<uint8_t>(frame[0] & ~AppConstants::SEQ_FLAG);
+    uint16_t length      = static_cast<uint16_t>((frame[1] << 8) | frame[2]);
+    if (!findSuite(requestType)) return true;   // firmware ignores unknown requests
+    if (tagged && frame.size() < 3 + AppConstants::SEQ_HEADER_BYTES) return true;
+    const uint16_t seq = tagged ? static_cast<uint16_t>((frame[3] << 8) | frame[4]) : 0;
+
+    // MCU serves one request at a time, the link drains responses at serviceBytesPerSec
+    // whole µs like the firmware's timer, rounded up so the sub-µs CRC of 0x00 isn't reported as 0
+    const double cipherUs = std::ceil(mcuCipherUs(_cfg, requestType, length));
+    double serviceUs = cipherUs;
+    if (_cfg.serviceBytesPerSec > 0.0) serviceUs += 1e6 * length / _cfg.serviceBytesPerSec;
+    const auto service = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double, std::micro>(serviceUs));
+
+    clock::time_point done, start, arrivedAt;
+    uint64_t offset;
+    bool held = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto arrived = written + latency;
+        while (!_queuedStarts.empty() && _queuedStarts.front() <= arrived) _queuedStarts.pop_front();
+        if (_cfg.mcuQueueDepth && _queuedStarts.size() >= _cfg.mcuQueueDepth) {
+            ++_dropped;     // RX buffer full, the request is lost
+            return true;
+        }
+        arrivedAt    = arrived;
+        start        = (arrived > _mcuFreeAt) ? arrived : _mcuFreeAt;
+        done         = start + service;
+        _mcuFreeAt   = done;
+        _queuedStarts.push_back(start);
+        offset   = _served;
+        _served += length;
+        held = _cfg.reorderEvery && (++_accepted % _cfg.reorderEvery == 0);
+    }
+
+    std::vector<uint8_t> plain(length);
+    fillPlaintext(plain, offset);
+    auto response = encryptResponse(requestType, plain);
+
+    uint32_t us = static_cast<uint32_t>(cipherUs);
+    std::vector<uint8_t> timing = {
+        static_cast<uint8_t>(us), static_cast<uint8_t>(us >> 8),
+        static_cast<uint8_t>(us >> 16), static_cast<uint8_t>(us >> 24)
+    };
+    if (tagged) {
+        const uint8_t header[AppConstants::SEQ_HEADER_BYTES] = { static_cast<uint8_t>(seq >> 8), static_cast<uint8_t>(seq) };
+        response.insert(response.begin(), header, header + AppConstants::SEQ_HEADER_BYTES);
+        timing.insert(timing.end(), header, header + AppConstants::SEQ_HEADER_BYTES);
+        const auto cipherDone = start + std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double, std::micro>(cipherUs));
+        for (uint32_t t : { mcuClock(arrivedAt), mcuClock(start), mcuClock(cipherDone) }) {
+            const uint8_t le[4] = { static_cast<uint8_t>(t), static_cast<uint8_t>(t >> 8),
+                                    static_cast<uint8_t>(t >> 16), static_cast<uint8_t>(t >> 24) };
+            timing.insert(timing.end(), le, le + 4);
+        }
+    }
+    auto due = done + latency;
+    if (held) {
+        due += std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::micro>(_cfg.reorderDelayUs));
+    }
+    schedule(due, Channel::Data, std::move(response));
+    schedule(due, Channel::Timing, std::move(timing));
+
+    if (serviceChanged) serviceChanged();
+    return true;
+}
+
+uint64_t SimPeripheral::droppedRequests() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _dropped;
+}
+
+void SimPeripheral::schedule(clock::time_point due, Channel channel, std::vector<uint8_t> payload) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_stop) return;
+        _events.push(Event{ due, _order++, channel, std::move(payload) });
+    }
+    _cv.notify_all();
+}
+
+void SimPeripheral::run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stop) {
+        if (_events.empty()) {
+            _cv.wait(lock);
+            continue;
+        }
+        auto due = _events.top().due;
+        if (clock::now() < due) {
+            _cv.wait_until(lock, due);
+            continue;
+        }
+        Event ev = std::move(const_cast<Event&>(_events.top()));
+        _events.pop();
+        NotifyCallback cb = (ev.channel == Channel::Data) ? _dataCb : _timingCb;
+
+        lock.unlock();
+        if (cb) cb(ev.payload);
+        lock.lock();
+    }
+}
@@ -0,0 +1,134 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef SIM_PERIPHERAL_H
+#define SIM_PERIPHERAL_H
+#pragma once
+
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "gatt_cache.h"
+
+/// Timing model of the simulated STM32WB P2P server
+struct SimConfig {
+    double   advertIntervalMs = 100.0;   ///< advertising interval of every simulated device
+    double   linkLatencyUs    = 3750.0;  ///< one-way over-the-air latency (half of a 7.5 ms connection interval)
+    double   cipherFixedUs    = 25.0;    ///< MCU ChaCha20 setup cost per request, other suites scale from it
+    double   cipherNsPerByte  = 120.0;   ///< MCU ChaCha20 cost per response byte, other suites scale from it
+    double   crcNsPerByte     = 4.0;     ///< MCU CRC32C cost per byte of a plaintext (0x00) response, CRC unit
+    uint32_t seed             = 1;       ///< seed for RSSI noise, keeps runs reproducible
+    uint32_t discoveryRoundTrips = 3;    ///< ATT round trips of an uncached discovery (services, characteristics, descriptors)
+    uint32_t serviceChangedEvery = 0;    ///< send a service-changed indication after this many requests (0 = never)
+    double   serviceBytesPerSec  = 0.0;  ///< sustained response rate of MCU + link, adds length / rate per request (0 = unlimited)
+    uint32_t mcuQueueDepth       = 0;    ///< requests the MCU can buffer while busy, further ones are dropped (0 = unlimited)
+    uint32_t bystanders          = 0;    ///< extra non-connectable advertisers per advertising interval (busy lab)
+    uint32_t reorderEvery        = 0;    ///< hold back every n-th response by reorderDelayUs (0 = in order)
+    double   reorderDelayUs      = 20000.0;
+    double   mcuClockOffsetUs    = 1.5e9;    ///< MCU µs counter at power-up, relative to the host clock (wraps at 2^32)
+    double   mcuClockDriftPpm    = 40.0;     ///< MCU crystal error
+    double   syncTurnaroundUs    = 30.0;     ///< MCU time between receiving a sync request and replying
+};
+
+/// In-process model of the STM32 P2P peripheral speaking the FE40 protocol:
+/// FE43 request = [requestType][uint16 big-endian length],
+/// FE44 response = ciphertext encrypted with AppConstants::KEY / NONCE,
+/// FE45 response = uint32 little-endian MCU cipher time in µs.
+/// Extended requests ([requestType | SEQ_FLAG][uint16 length][uint16 seq], big-endian) get
+/// the seq echoed in front of the FE44 ciphertext; their FE45 report carries the seq and the
+/// MCU clock stamps (see AppConstants::TIMING_EXT_BYTES). Clock sync requests are answered on FE45.
+class SimPeripheral {
+public:
+    using NotifyCallback = std::function<void(std::span<const uint8_t>)>;
+
+    SimPeripheral(uint64_t address, std::string name, SimConfig cfg);
+    ~SimPeripheral();
+
+    uint64_t address() const { return _address; }
+    const std::string& name() const { return _name; }
+
+    /// Callbacks are invoked from the peripheral's delivery thread
+    void setDataCallback(NotifyCallback cb);
+    void setTimingCallback(NotifyCallback cb);
+
+    /// Current attribute table of the P2P service (moves after a service change)
+    GattHandles handles() const;
+
+    /// Called from the writer's thread when the peripheral indicates Service Changed
+    void setServiceChangedCallback(std::function<void()> cb);
+
+    /// Handles a write to the given attribute handle; writes to anything but FE43 are dropped
+    /// @return false if the handle is not the current FE43 value handle
+    bool onWrite(uint16_t handle, std::span<const uint8_t> frame);
+
+    /// Requests dropped because the MCU queue was full
+    uint64_t droppedRequests() const;
+
+    /// Drops pending notifications and stops the delivery thread
+    void stop();
+
+    /// Encrypts plaintext the same way the firmware does for the given request type
+    /// (0x00 = plain||le32 CRC32C, 0x01/0x04/0x05 = ct, 0x02/0x06 = tag||ct, 0x03/0x07/0x08 = ct||tag).
+    /// Returns an empty vector for unknown types.
+    static std::vector<uint8_t> encryptResponse(uint8_t requestType, std::span<const uint8_t> plain);
+
+    /// Fills buf with the deterministic plaintext pattern starting at the given stream offset
+    static void fillPlaintext(std::span<uint8_t> buf, uint64_t offset);
+
+    /// true if buf is a piece of the plaintext pattern at any stream offset
+    /// (integrity check for responses that may arrive out of order)
+    static bool isPlaintext(std::span<const uint8_t> buf);
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    enum class Channel { Data, Timing };
+    struct Event {
+        clock::time_point    due;
+        uint64_t             order;
+        Channel              channel;
+        std::vector<uint8_t> payload;
+        bool operator>(const Event& o) const {
+            return due != o.due ? due > o.due : order > o.order;
+        }
+    };
+
+    void run();
+    /// Free running 32-bit MCU µs counter at host time t
+    uint32_t mcuClock(clock::time_point t) const;
+    void schedule(clock::time_point due, Channel channel, std::vector<uint8_t> payload);
+
+    uint64_t    _address;
+    std::string _name;
+    SimConfig   _cfg;
+
+    mutable std::mutex      _mutex;
+    std::condition_variable _cv;
+    std::priority_queue<Event, std::vector<Event>, std::greater<>> _events;
+    NotifyCallback          _dataCb{};
+    NotifyCallback          _timingCb{};
+    std::function<void()>   _serviceChangedCb{};
+    clock::time_point       _mcuFreeAt{};
+    std::deque<clock::time_point> _queuedStarts;    ///< start times of accepted requests, for the queue bound
+    uint64_t                _dropped = 0;
+    uint16_t                _handleBase = 0x000C;
+    uint32_t                _requests   = 0;
+    uint64_t                _order  = 0;
+    uint64_t                _served = 0;
+    uint64_t                _accepted = 0;
+    clock::time_point       _powerUp;
+    bool                    _stop   = false;
+    std::thread             _thread;
+};
+
+#endif //SIM_PERIPHERAL_H
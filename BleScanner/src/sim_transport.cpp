@@ -0,0 +1,175 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#include "sim_transport.h"
+#include "constants.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace {
+    /// P2P service characteristics as reported by the STM32WB firmware
+    struct SimCharacteristic { uint16_t shortUuid; uint32_t properties; };
+    constexpr SimCharacteristic kCharacteristics[] = {
+        { AppConstants::LED_SHORT_UUID,           0x0A },   // read | write
+        { AppConstants::BUTTON_NOTIFY_SHORT_UUID, 0x10 },   // notify
+        { AppConstants::DATA_IN_SHORT_UUID,       0x04 },   // write without response
+        { AppConstants::DATA_OUT_SHORT_UUID,      0x10 },   // notify
+        { AppConstants::DATA_OUT_TIME_SHORT_UUID, 0x10 },   // notify
+    };
+}
+
+//––– SimConnection –––//
+
+SimConnection::SimConnection(std::unique_ptr<SimPeripheral> peripheral, GattHandleCache& cache, const SimConfig& cfg)
+    : _peripheral(std::move(peripheral)), _cache(cache), _cfg(cfg) {
+    _peripheral->setServiceChangedCallback([this]() {
+        if (_stale.exchange(true)) return;
+        _cache.invalidate(_peripheral->address());
+        _cache.recordInvalidation();
+    });
+}
+
+SimConnection::~SimConnection() {
+    close();
+}
+
+std::string SimConnection::name() const {
+    return _peripheral ? _peripheral->name() : std::string();
+}
+
+void SimConnection::roundTrips(uint32_t count) const {
+    std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(2.0 * _cfg.linkLatencyUs * count));
+}
+
+bool SimConnection::discover(std::vector<BleCharacteristicInfo>& characteristics) {
+    if (!_peripheral) return false;
+    auto t0 = std::chrono::steady_clock::now();
+    auto elapsedMs = [&t0]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    };
+
+    GattHandles persisted;
+    bool known = _cache.lookup(_peripheral->address(), persisted);
+    if (known && persisted == _peripheral->handles()) {
+        _handles = persisted;
+        _cache.recordDiscovery(true, elapsedMs());
+    } else {
+        if (known) _cache.recordStale();
+        roundTrips(_cfg.discoveryRoundTrips);
+        _handles = _peripheral->handles();
+        _cache.recordDiscovery(false, elapsedMs());
+        _cache.store(_peripheral->address(), _handles);
+        if (_cache.stats().lookupMs == 0.0) {
+            // one characteristic-by-UUID lookup, what the send loop used to pay per chunk
+            auto t1 = std::chrono::steady_clock::now();
+            roundTrips(1);
+            _cache.recordLookupCost(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t1).count());
+        }
+    }
+
+    for (auto const& c : kCharacteristics) {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "{0000%04x-8e22-4541-9d4c-21edae82ed19}", c.shortUuid);
+        characteristics.push_back(BleCharacteristicInfo{ buf, c.properties });
+    }
+    return true;
+}
+
+bool SimConnection::subscribeData(NotifyCallback cb) {
+    if (!_peripheral) return false;
+    _peripheral->setDataCallback(std::move(cb));
+    return true;
+}
+
+bool SimConnection::subscribeTiming(NotifyCallback cb) {
+    if (!_peripheral) return false;
+    _peripheral->setTimingCallback(std::move(cb));
+    return true;
+}
+
+bool SimConnection::writeRequest(std::span<const uint8_t> frame) {
+    if (!_peripheral) return false;
+    if (_stale.exchange(false)) {
+        std::vector<BleCharacteristicInfo> characteristics;
+        discover(characteristics);
+    }
+    if (!_peripheral->onWrite(_handles.dataIn, frame)) return false;
+    _cache.recordChunkWrite();
+    return true;
+}
+
+void SimConnection::close() {
+    if (!_peripheral) return;
+    _peripheral->stop();
+    _peripheral.reset();
+}
+
+//––– SimTransport –––//
+
+SimTransport::SimTransport(SimConfig cfg, std::vector<std::pair<std::string, uint64_t>> devices,
+                           std::string gattCacheFile)
+    : _cfg(cfg), _cache(std::move(gattCacheFile)), _devices(std::move(devices)) {
+    if (_devices.empty()) _devices = AppConstants::DEVICE_LIST;
+}
+
+SimTransport::~SimTransport() {
+    stopWatcher();
+}
+
+void SimTransport::startWatcher(AdvertCallback cb) {
+    stopWatcher();
+    _advertising = true;
+    _advertThread = std::thread([this, cb = std::move(cb)]() {
+        std::mt19937 rng(_cfg.seed);
+        std::uniform_int_distribution<int> noise(-6, 6);
+        const auto interval = std::chrono::duration<double, std::milli>(_cfg.advertIntervalMs);
+        auto next = std::chrono::steady_clock::now();
+
+        while (_advertising) {
+            for (size_t i = 0; i < _devices.size() && _advertising; ++i) {
+                BleAdvertisement adv;
+                adv.address = _devices[i].second;
+                adv.rssi    = static_cast<int16_t>(-55 - 4 * static_cast<int>(i % 8) + noise(rng));
+                cb(adv);
+            }
+            // phones, beacons and other boards around the bench
+            for (uint32_t i = 0; i < _cfg.bystanders && _advertising; ++i) {
+                BleAdvertisement adv;
+                adv.address = 0xC0FFEE000000ull + i;
+                adv.rssi    = static_cast<int16_t>(-70 - static_cast<int>(i % 20) + noise(rng));
+                cb(adv);
+            }
+            next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+            std::this_thread::sleep_until(next);
+        }
+    });
+}
+
+void SimTransport::stopWatcher() {
+    _advertising = false;
+    if (_advertThread.joinable()) _advertThread.join();
+}
+
+void SimTransport::setDeviceConfig(uint64_t address, const SimConfig& cfg) {
+    std::lock_guard<std::mutex> lock(_overridesMutex);
+    _overrides[address] = cfg;
+}
+
+SimConfig SimTransport::configFor(uint64_t address) const {
+    std::lock_guard<std::mutex> lock(_overridesMutex);
+    auto it = _overrides.find(address);
+    return (it != _overrides.end()) ? it->second : _cfg;
+}
+
+std::unique_ptr<BleConnection> SimTransport::connect(uint64_t address) {
+    for (auto const& [name, addr] : _devices) {
+        if (addr == address) {
+            SimConfig cfg = configFor(address);
+            return std::make_unique<SimConnection>(std::make_unique<SimPeripheral>(address, name, cfg),
+                                                   _cache, cfg);
+        }
+    }
+    return nullptr;
+}
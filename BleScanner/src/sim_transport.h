@@ -0,0 +1,82 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef SIM_TRANSPORT_H
+#define SIM_TRANSPORT_H
+#pragma once
+
+#include "ble_transport.h"
+#include "sim_peripheral.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/// Connection to an in-process SimPeripheral
+class SimConnection : public BleConnection {
+public:
+    SimConnection(std::unique_ptr<SimPeripheral> peripheral, GattHandleCache& cache, const SimConfig& cfg);
+    ~SimConnection() override;
+
+    std::string name() const override;
+    bool discover(std::vector<BleCharacteristicInfo>& characteristics) override;
+    bool subscribeData(NotifyCallback cb) override;
+    bool subscribeTiming(NotifyCallback cb) override;
+    bool writeRequest(std::span<const uint8_t> frame) override;
+    void close() override;
+
+private:
+    /// Models ATT round trips on the simulated link
+    void roundTrips(uint32_t count) const;
+
+    std::unique_ptr<SimPeripheral> _peripheral;
+    GattHandleCache&  _cache;
+    SimConfig         _cfg;
+    GattHandles       _handles{};
+    std::atomic<bool> _stale{ false };
+};
+
+/// Simulated BLE backend: advertises a set of P2P peripherals and connects to them in-process.
+/// Builds and runs on any platform, used for regression runs and benchmarks.
+class SimTransport : public BleTransport {
+public:
+    /// @param cfg      timing model shared by all simulated devices
+    /// @param devices  advertised devices (defaults to AppConstants::DEVICE_LIST)
+    /// @param gattCacheFile persisted handle cache, empty = in-memory only
+    explicit SimTransport(SimConfig cfg = {},
+                          std::vector<std::pair<std::string, uint64_t>> devices = {},
+                          std::string gattCacheFile = {});
+    ~SimTransport() override;
+
+    std::string name() const override { return "Simulator"; }
+    bool radioEnabled() override { return true; }
+    void startWatcher(AdvertCallback cb) override;
+    void stopWatcher() override;
+    std::unique_ptr<BleConnection> connect(uint64_t address) override;
+    const GattHandleCache* gattCache() const override { return &_cache; }
+
+    const SimConfig& config() const { return _cfg; }
+
+    /// Timing model for one device instead of the shared one (e.g. a slow board in the rack),
+    /// applies to connections made afterwards
+    void setDeviceConfig(uint64_t address, const SimConfig& cfg);
+
+private:
+    SimConfig configFor(uint64_t address) const;
+
+    SimConfig _cfg;
+    mutable std::mutex _overridesMutex;
+    std::map<uint64_t, SimConfig> _overrides;
+    GattHandleCache _cache;
+    std::vector<std::pair<std::string, uint64_t>> _devices;
+    std::thread       _advertThread;
+    std::atomic<bool> _advertising{ false };
+};
+
+#endif //SIM_TRANSPORT_H
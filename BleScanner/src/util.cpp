@@ -9,6 +9,7 @@
 #include <locale>
 #include <cwchar>
 
+#ifdef _WIN32
 BOOL WINAPI ConsoleHandler(DWORD signal)
 {
     if (signal == CTRL_C_EVENT){
@@ -30,6 +31,7 @@ std::wstring GuidToString(winrt::guid const& id)
     );
     return std::wstring(buf);
 }
+#endif
 
 void SetupStyle()
 {
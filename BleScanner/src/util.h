@@ -6,16 +6,20 @@
 #define UTIL_H
 #pragma once
 
+#ifdef _WIN32
 #include <windows.h>            // for ConsoleHandler
 #include <winrt/base.h>         // for winrt::guid
+#endif
 #include <string>
 #include <atomic>
 
+#ifdef _WIN32
 /// Console handler for CTRL+C and other signals
 BOOL WINAPI ConsoleHandler(DWORD signal);
 
 /// Converts a winrt::guid to a std::wstring representation
 std::wstring GuidToString(winrt::guid const& id);
+#endif
 
 /// Applies global ImGui style (colors, rounding, padding, etc.)
 void SetupStyle();
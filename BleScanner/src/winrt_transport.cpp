@@ -0,0 +1,272 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+#include "winrt_transport.h"
+#include "constants.h"
+#include <winrt/Windows.Devices.Radios.h>
+#include <winrt/Windows.Storage.Streams.h>
+#include <winrt/Windows.Foundation.h>
+#include <winrt/Windows.Foundation.Collections.h>
+#include <windows.h>
+#include <chrono>
+#include <thread>
+
+using namespace winrt;
+using namespace Windows::Devices::Bluetooth;
+using namespace Windows::Devices::Bluetooth::Advertisement;
+using namespace Windows::Devices::Bluetooth::GenericAttributeProfile;
+using namespace Windows::Storage::Streams;
+using namespace Windows::Devices::Radios;
+using namespace Windows::Foundation;
+using namespace Windows::Foundation::Collections;
+
+//––– WinRtConnection –––//
+
+namespace {
+    double elapsedMs(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    }
+}
+
+WinRtConnection::WinRtConnection(BluetoothLEDevice device, GattHandleCache& cache)
+    : _device(std::move(device)), _cache(cache) {
+    _address = _device.BluetoothAddress();
+
+    // Any of these makes the session handles unusable
+    _servicesChangedToken = _device.GattServicesChanged([this](auto const&, auto const&) {
+        invalidateSession(true);
+    });
+    _statusToken = _device.ConnectionStatusChanged([this](BluetoothLEDevice const& dev, auto const&) {
+        if (dev.ConnectionStatus() == BluetoothConnectionStatus::Disconnected) {
+            invalidateSession(false);
+        }
+    });
+}
+
+WinRtConnection::~WinRtConnection() {
+    close();
+}
+
+std::string WinRtConnection::name() const {
+    std::wstring name = _device.Name().c_str();
+    return std::string(name.begin(), name.end());
+}
+
+bool WinRtConnection::resolve(BluetoothCacheMode mode, std::vector<BleCharacteristicInfo>& characteristics) {
+    auto sr = _device.GetGattServicesForUuidAsync(AppConstants::P2P_SERVICE_UUID, mode).get();
+    if (sr.Status() != GattCommunicationStatus::Success) return false;
+    auto svcs = sr.Services();
+    if (svcs.Size() == 0) return false;
+    _service = svcs.GetAt(0);
+
+    auto all = _service.GetCharacteristicsAsync(mode).get();
+    if (all.Status() != GattCommunicationStatus::Success) return false;
+
+    GattHandles handles;
+    handles.service = _service.AttributeHandle();
+    for (auto const& c : all.Characteristics()) {
+        // convert winrt::guid to std::wstring and then to UTF-8
+        std::wstring wuuid = winrt::to_hstring(c.Uuid()).c_str();
+        BleCharacteristicInfo info;
+        info.uuid.assign(wuuid.begin(), wuuid.end());
+        info.properties = static_cast<uint32_t>(c.CharacteristicProperties());
+        characteristics.push_back(std::move(info));
+
+        if (c.Uuid() == AppConstants::DATA_IN_CHARACTERISTIC_UUID) {
+            _dataInChar = c;
+            handles.dataIn = c.AttributeHandle();
+        } else if (c.Uuid() == AppConstants::DATA_OUT_CHARACTERISTIC_UUID) {
+            _dataOutChar = c;
+            handles.dataOut = c.AttributeHandle();
+        } else if (c.Uuid() == AppConstants::DATA_OUT_TIME_CHARACTERISTIC_UUID) {
+            _timingChar = c;
+            handles.timing = c.AttributeHandle();
+        }
+    }
+    _handles = handles;
+    return true;
+}
+
+bool WinRtConnection::discover(std::vector<BleCharacteristicInfo>& characteristics) {
+    auto t0 = std::chrono::steady_clock::now();
+
+    // Reconnect: trust the system cache if it still matches the persisted handles
+    GattHandles persisted;
+    if (_cache.lookup(_address, persisted)) {
+        if (resolve(BluetoothCacheMode::Cached, characteristics) && _handles == persisted) {
+            _cache.recordDiscovery(true, elapsedMs(t0));
+            return true;
+        }
+        _cache.recordStale();
+        characteristics.clear();
+        t0 = std::chrono::steady_clock::now();
+    }
+
+    if (!resolve(BluetoothCacheMode::Uncached, characteristics)) return false;
+    _cache.recordDiscovery(false, elapsedMs(t0));
+    if (_handles.valid()) _cache.store(_address, _handles);
+
+    // Cost of the lookup the send loop used to do for every chunk
+    if (_cache.stats().lookupMs == 0.0) {
+        auto t1 = std::chrono::steady_clock::now();
+        _service.GetCharacteristicsForUuidAsync(AppConstants::DATA_IN_CHARACTERISTIC_UUID,
+                                                BluetoothCacheMode::Uncached).get();
+        _cache.recordLookupCost(elapsedMs(t1));
+    }
+    return true;
+}
+
+bool WinRtConnection::attachData() {
+    if (!_dataOutChar) return false;
+    _dataOutToken = _dataOutChar.ValueChanged([this](auto const&, auto const& args) {
+        // read the IBuffer in place, the session copies it once into its packet ring
+        IBuffer value = args.CharacteristicValue();
+        if (_dataCb) _dataCb(std::span<const uint8_t>(value.data(), value.Length()));
+    });
+    _dataOutChar.WriteClientCharacteristicConfigurationDescriptorAsync(
+        GattClientCharacteristicConfigurationDescriptorValue::Notify).get();
+    return true;
+}
+
+bool WinRtConnection::attachTiming() {
+    if (!_timingChar) return false;
+    _timingToken = _timingChar.ValueChanged([this](auto const&, auto const& args) {
+        DataReader reader = DataReader::FromBuffer(args.CharacteristicValue());
+        std::vector<uint8_t> buf(reader.UnconsumedBufferLength());
+        reader.ReadBytes(buf);
+        if (_timingCb) _timingCb(buf);
+    });
+    _timingChar.WriteClientCharacteristicConfigurationDescriptorAsync(
+        GattClientCharacteristicConfigurationDescriptorValue::Notify).get();
+    return true;
+}
+
+bool WinRtConnection::subscribeData(NotifyCallback cb) {
+    _dataCb = std::move(cb);
+    return attachData();
+}
+
+bool WinRtConnection::subscribeTiming(NotifyCallback cb) {
+    _timingCb = std::move(cb);
+    return attachTiming();
+}
+
+void WinRtConnection::detachNotifications() {
+    if (_dataOutChar) {
+        _dataOutChar.ValueChanged(_dataOutToken);
+        _dataOutChar = nullptr;
+    }
+    if (_timingChar) {
+        _timingChar.ValueChanged(_timingToken);
+        _timingChar = nullptr;
+    }
+}
+
+void WinRtConnection::invalidateSession(bool servicesChanged) {
+    // Called on WinRT threads, the actual re-discovery happens on the next write
+    if (_stale.exchange(true)) return;
+    if (servicesChanged) _cache.invalidate(_address);
+    _cache.recordInvalidation();
+}
+
+bool WinRtConnection::refresh() {
+    detachNotifications();
+    _dataInChar = nullptr;
+    if (_service) {
+        _service.Close();
+        _service = nullptr;
+    }
+    std::vector<BleCharacteristicInfo> characteristics;
+    if (!discover(characteristics)) return false;
+    if (_dataCb) attachData();
+    if (_timingCb) attachTiming();
+    return true;
+}
+
+bool WinRtConnection::writeRequest(std::span<const uint8_t> frame) {
+    if (_stale.exchange(false) && !refresh()) return false;
+    if (!_dataInChar) return false;
+
+    DataWriter writer;
+    writer.WriteBytes(array_view<const uint8_t>(frame.data(), frame.data() + frame.size()));
+    auto buf = writer.DetachBuffer();
+
+    // Don't block the sender, the request pipeline decides when the next write may go
+    ++_writes->pending;
+    auto op = _dataInChar.WriteValueAsync(buf, GattWriteOption::WriteWithoutResponse);
+    op.Completed([writes = _writes](auto const& async, AsyncStatus status) {
+        if (status != AsyncStatus::Completed || async.GetResults() != GattCommunicationStatus::Success) {
+            ++writes->failed;
+        }
+        --writes->pending;
+    });
+    _cache.recordChunkWrite();
+    return true;
+}
+
+void WinRtConnection::close() {
+    if (!_device) return;
+    // Give queued writes a chance to reach the device before it is closed. Only a courtesy:
+    // their completion handlers hold _writes, not this, so a late one is harmless.
+    for (int i = 0; i < 100 && _writes->pending > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    _device.GattServicesChanged(_servicesChangedToken);
+    _device.ConnectionStatusChanged(_statusToken);
+    // unregister notifications
+    detachNotifications();
+    _dataInChar = nullptr;
+    if (_service) {
+        _service.Close();
+        _service = nullptr;
+    }
+    _device.Close();
+    _device = nullptr;
+}
+
+//––– WinRtTransport –––//
+
+WinRtTransport::WinRtTransport()
+    : _cache(AppConstants::GATT_CACHE_FILE) {
+}
+
+WinRtTransport::~WinRtTransport() {
+    stopWatcher();
+}
+
+void WinRtTransport::initThread() {
+    init_apartment(apartment_type::multi_threaded);
+}
+
+bool WinRtTransport::radioEnabled() {
+    auto radios = Radio::GetRadiosAsync().get();
+    for (auto const& r : radios) {
+        if (r.Kind() == RadioKind::Bluetooth && r.State() == RadioState::On) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WinRtTransport::startWatcher(AdvertCallback cb) {
+    _watcher = BluetoothLEAdvertisementWatcher();
+    _watcher.Received([cb = std::move(cb)](auto const&, auto const& args) {
+        BleAdvertisement adv;
+        adv.address = args.BluetoothAddress();
+        adv.rssi    = args.RawSignalStrengthInDBm();
+        cb(adv);
+    });
+    _watcher.Start();
+}
+
+void WinRtTransport::stopWatcher() {
+    if (!_watcher) return;
+    _watcher.Stop();
+    _watcher = nullptr;
+}
+
+std::unique_ptr<BleConnection> WinRtTransport::connect(uint64_t address) {
+    auto dev = BluetoothLEDevice::FromBluetoothAddressAsync(address).get();
+    if (!dev) return nullptr;
+    return std::make_unique<WinRtConnection>(dev, _cache);
+}
@@ -0,0 +1,89 @@
+//
+// Created by pepiv on 17.10.2026.
+//
+
+#ifndef WINRT_TRANSPORT_H
+#define WINRT_TRANSPORT_H
+#pragma once
+
+#include "ble_transport.h"
+#include "gatt_cache.h"
+
+#include <atomic>
+#include <memory>
+
+#include <winrt/base.h>
+#include <winrt/Windows.Devices.Bluetooth.h>
+#include <winrt/Windows.Devices.Bluetooth.Advertisement.h>
+#include <winrt/Windows.Devices.Bluetooth.GenericAttributeProfile.h>
+
+/// GATT connection backed by Windows.Devices.Bluetooth
+class WinRtConnection : public BleConnection {
+public:
+    WinRtConnection(winrt::Windows::Devices::Bluetooth::BluetoothLEDevice device, GattHandleCache& cache);
+    ~WinRtConnection() override;
+
+    std::string name() const override;
+    bool discover(std::vector<BleCharacteristicInfo>& characteristics) override;
+    bool subscribeData(NotifyCallback cb) override;
+    bool subscribeTiming(NotifyCallback cb) override;
+    bool writeRequest(std::span<const uint8_t> frame) override;
+    uint64_t failedWrites() const override { return _writes->failed; }
+    void close() override;
+
+private:
+    /// Resolves service + characteristics with the given cache mode and fills _handles
+    bool resolve(winrt::Windows::Devices::Bluetooth::BluetoothCacheMode mode,
+                 std::vector<BleCharacteristicInfo>& characteristics);
+    /// Re-discovers after invalidation and re-attaches notification handlers
+    bool refresh();
+    bool attachData();
+    bool attachTiming();
+    void detachNotifications();
+    void invalidateSession(bool servicesChanged);
+
+    /// Write counters, shared with the WriteValueAsync completion handlers so a completion
+    /// that comes after close() (or after the connection is gone) touches only this
+    struct WriteState {
+        std::atomic<uint32_t> pending{ 0 };
+        std::atomic<uint64_t> failed{ 0 };
+    };
+
+    winrt::Windows::Devices::Bluetooth::BluetoothLEDevice _device{ nullptr };
+    winrt::Windows::Devices::Bluetooth::GenericAttributeProfile::GattDeviceService _service{ nullptr };
+    winrt::Windows::Devices::Bluetooth::GenericAttributeProfile::GattCharacteristic _dataInChar{ nullptr };
+    winrt::Windows::Devices::Bluetooth::GenericAttributeProfile::GattCharacteristic _dataOutChar{ nullptr };
+    winrt::Windows::Devices::Bluetooth::GenericAttributeProfile::GattCharacteristic _timingChar{ nullptr };
+    winrt::event_token    _dataOutToken{};
+    winrt::event_token    _timingToken{};
+    winrt::event_token    _servicesChangedToken{};
+    winrt::event_token    _statusToken{};
+    GattHandleCache&      _cache;
+    GattHandles           _handles{};
+    uint64_t              _address = 0;
+    std::atomic<bool>     _stale{ false };
+    std::shared_ptr<WriteState> _writes = std::make_shared<WriteState>();
+    NotifyCallback        _dataCb{};
+    NotifyCallback        _timingCb{};
+};
+
+/// BLE backend using BluetoothLEAdvertisementWatcher + BluetoothLEDevice
+class WinRtTransport : public BleTransport {
+public:
+    WinRtTransport();
+    ~WinRtTransport() override;
+
+    std::string name() const override { return "WinRT"; }
+    void initThread() override;
+    bool radioEnabled() override;
+    void startWatcher(AdvertCallback cb) override;
+    void stopWatcher() override;
+    std::unique_ptr<BleConnection> connect(uint64_t address) override;
+    const GattHandleCache* gattCache() const override { return &_cache; }
+
+private:
+    GattHandleCache _cache;
+    winrt::Windows::Devices::Bluetooth::Advertisement::BluetoothLEAdvertisementWatcher _watcher{ nullptr };
+};
+
+#endif //WINRT_TRANSPORT_H